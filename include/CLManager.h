@@ -43,6 +43,29 @@ namespace yune
     class CLManager
     {
         public:
+            /** \brief Stage kernels of a wavefront rendering program, created by name besides the rendering kernel (which accumulates the paths). */
+            enum WavefrontKernel
+            {
+                WF_GENERATE,
+                WF_EXTEND,
+                WF_SHADE_DIFFUSE,
+                WF_SHADE_SPECULAR,
+                WF_CONNECT,
+                WF_KERNEL_COUNT
+            };
+
+            /** \brief Slots of the ray-counters buffer. The path length histogram takes PATH_LENGTH_BINS slots, the last one also counts longer paths. */
+            enum RayCounter
+            {
+                RC_RAYS,
+                RC_NODES_VISITED,
+                RC_TRIANGLE_TESTS,
+                RC_SHADOW_RAYS,
+                RC_PATH_LENGTH,
+                PATH_LENGTH_BINS = 16,
+                RAY_COUNTER_COUNT = RC_PATH_LENGTH + PATH_LENGTH_BINS
+            };
+
             CLManager();    /**< Default Constructor. */
             ~CLManager();   /**< Default Destructor. */
 
@@ -77,15 +100,124 @@ namespace yune
              */
             void setGuiMessageCb(std::function<void(const std::string&, const std::string&, const std::string&)>);
 
+            /** \brief Enable or disable rendering on secondary OpenCL devices.
+             *
+             *  Every available device other than the one sharing the OpenGL context gets it's own context, command queue, a copy of the
+             *  rendering program and replicas of the scene buffers. Blocks assigned to these devices are rendered into private images and
+             *  composited into the shared image at the end of each frame.
+             * \param[in] enable    Whether to create (true) or release (false) the secondary devices.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupMultiDevice(bool enable);
+
+            /** \brief Get the index of the first argument of an optional rendering kernel feature.
+             *
+             * \param[in] feature   Name of the feature as given in the "#yune-preproc feature" directive.
+             * \return The argument index or -1 if the loaded rendering kernel doesn't use the feature.
+             */
+            int getFeatureArg(const std::string& feature);
+
+            /** \brief Get the index of the first argument of an optional post-processing kernel feature.
+             *
+             * \param[in] feature   Name of the feature as given in the "#yune-preproc feature" directive.
+             * \return The argument index or -1 if the loaded post-processing kernel doesn't use the feature.
+             */
+            int getPostProcFeatureArg(const std::string& feature);
+
 
             //Setup Buffer Objects
             void setupCameraBuffer(Cam* cam_data);
-            bool setupImageBuffers(GLuint rbo_IDs[]);
+            bool setupImageBuffers(GLuint rbo_IDs[], GLuint display_tex_IDs[], int width, int height);
             bool setupBVHBuffer(std::vector<BVHNodeGPU>& bvh_data, float bvh_size, float scene_size);
             bool setupVertexBuffer(std::vector<TriangleGPU>& vert_data, float scene_size);
             bool setupMatBuffer(std::vector<Material>& mat_data);
 
+            /** \brief Create the path state, queue and counter buffers used by wavefront kernels. Buffers are only recreated if the sizes change.
+             *
+             * \param[in] num_paths     Number of paths processed at once i.e. the number of pixels in a tile.
+             * \param[in] max_bounces   Maximum number of bounces per path. Each bounce gets it's own set of queue counters.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupWavefrontBuffers(size_t num_paths, int max_bounces);
+
+            /** \brief Create the cost image written by kernels with the cost-heatmap feature and build the kernel that color-maps it.
+             *  The image is only recreated after setupImageBuffers() released it.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupCostImage(int width, int height);
+
+            /** \brief Create the moment and active pixel buffers used by kernels with the adaptive-sampling feature and build the kernel
+             *  that lists the pixels which haven't converged yet. Buffers are only recreated if the size changes.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupAdaptiveBuffers(int width, int height);
+
+            /** \brief Create the snapshot image and partial sum buffer used to estimate the noise left in the accumulated image and build
+             *  the kernel that computes it. Buffers are only recreated if the size changes.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupConvergenceBuffers(int width, int height);
+
+            /** \brief Create the feature buffers written by kernels with the feature-buffers feature and the images the denoiser
+             *  ping-pongs between, and build the denoising kernel. Buffers are only recreated if the size or format changes.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \param[in] half      Store the ping-pong images as half floats.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupDenoiseBuffers(int width, int height, bool half);
+
+            /** \brief Create the previous camera and the pair of first-hit distance buffers used by kernels with the temporal-reprojection
+             *  feature. The distance buffers are only recreated if the size changes.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupTemporalBuffers(int width, int height);
+
+            /** \brief Create the pair of reduced resolution images frames are accumulated in while the camera moves, and build the kernel
+             *  that upscales them into the framebuffer images. The images are only recreated if the size or format changes.
+             *
+             * \param[in] width     Width of the reduced resolution.
+             * \param[in] height    Height of the reduced resolution.
+             * \param[in] half      Store the images as half floats.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupPreviewImages(int width, int height, bool half);
+
+            /** \brief Create the buffers the luminance of the image is reduced into for post-processing kernels with the auto-exposure
+             *  feature and build the reduction kernel. The buffers are only recreated if the size changes.
+             *
+             * \param[in] width     Width of the framebuffer.
+             * \param[in] height    Height of the framebuffer.
+             * \return True if the function succeeds, else false. The error message is passed on to the GUI.
+             */
+            bool setupLuminanceBuffers(int width, int height);
+
+            static const int ERROR_GROUP_SIZE = 16;     /**< Width and height of the work-groups of the error kernel. Each writes one partial sum. */
+            static const int LUMINANCE_GROUP_SIZE = 16; /**< Width and height of the work-groups of the luminance kernel. Each writes one partial result. */
+            static const int LUMINANCE_BINS = 64;       /**< Bins of the log2 luminance histogram, evenly spread over [LUMINANCE_LOG2_MIN, LUMINANCE_LOG2_MAX]. */
+            static const int LUMINANCE_LOG2_MIN = -16;
+            static const int LUMINANCE_LOG2_MAX = 16;
+            static const int CAMERA_RING_SIZE = 2;      /**< Camera buffers written in turn, so a new camera never overwrites one a queued kernel reads. */
+            static const std::string TONEMAP_PATH;      /**< Path of the shipped post-processing kernel, loaded on startup. The fused-tonemap feature mirrors it's operator. */
+
             std::string rk_file, rk_file_path, rk_name, ppk_file, ppk_file_path, ppk_name, rk_compiler_opts, ppk_compiler_opts;
+            std::vector<std::string> rk_features;             /**< Optional features the rendering kernel opted into, in the order of their directives. */
+            std::vector<std::string> ppk_features;            /**< Optional features the post-processing kernel opted into, in the order of their directives. */
+            bool ray_counters_64;                             /**< Whether the ray counters are 64 bit wide. Without cl_khr_int64_base_atomics they are 32 bit and may wrap within a frame. */
+            std::vector<std::string> helper_device_names;     /**< Names of the secondary devices used in multi-device mode. Empty if disabled. */
 
         private:
             class Device
@@ -113,7 +245,30 @@ namespace yune
                     cl_ulong local_mem_size;
                     cl_ulong constant_mem_size;
                     bool clgl_event_ext;
+                    bool int64_atomics_ext;
                     bool clgl_sharing_ext;
+                    cl_bool image_support;
+            };
+
+            /** \brief A secondary device rendering blocks of the image in it's own context. Resources are released by CLManager::releaseHelperDevices(). */
+            class HelperDevice
+            {
+                public:
+                    HelperDevice();
+                    ~HelperDevice();
+
+                    Device device;
+                    cl_context context;
+                    cl_command_queue comm_queue;
+                    cl_program rk_program;
+                    cl_kernel rend_kernel;
+                    cl_mem image_buffers[2];    /**< Private (non GL-shared) copies of the read and write images. */
+                    cl_mem vert_buffer;
+                    cl_mem mat_buffer;
+                    cl_mem bvh_buffer;
+                    cl_mem camera_buffer;
+                    cl_mem work_counter_buffer; /**< Counter of a persistent-threads kernel. NULL for other kernels. */
+                    size_t rendk_wgs;           /**< Maximum work-group size of the rendering kernel on this device. */
             };
 
             class Platform
@@ -143,23 +298,78 @@ namespace yune
             Vendor mapPlatformToVendor(std::string str);            /**< Helper function that maps arbitrary vendor names to a well defined Enum. */
             void setupDevices(cl_context_properties* properties);   /**< Load the device currently assosciated with OpenGL. */
             void setupPlatforms();                                  /**< Display a list of OpenCL platforms and devices and select a platform. */
+            void buildHelperPrograms();                             /**< Build the last loaded rendering program on every secondary device. */
+            void releaseHelperDevices();                            /**< Release all resources held by secondary devices. */
+            cl_mem createHelperBuffer(HelperDevice& helper, size_t size, void* data);   /**< Create a read-only replica of a scene buffer on a secondary device. */
 
             static std::function<void(const std::string&, const std::string&, const std::string&)> setMessageCb;   /**< The function pointer to the RendererGUI message callback function. */
 
+            std::vector<Platform> platform_list;    /**< All detected OpenCL platforms and their devices. */
+            std::vector<HelperDevice> helper_devices;   /**< Secondary devices used in multi-device mode. */
+            std::string rk_source;                  /**< Source of the last successfully built rendering program. Needed to build it on secondary devices. */
+            std::string rk_build_opts;              /**< Compiler options and feature macros the rendering program was built with. */
             Platform target_platform;               /**< The OpenCL platform ID fo the selected platform. */
             Device target_device;                   /**< The OpenCL device ID of the selected device. */
             cl_context context;                     /**< The OpenCL context. */
             cl_program rk_program;                  /**< The OpenCL program object containing the Rendering kernel data. */
             cl_program ppk_program;                 /**< The OpenCL program object containing the Post-processing kernel data. */
+            cl_program heatmap_program;             /**< Built-in program color-mapping the cost image. */
+            cl_program compact_program;             /**< Built-in program listing the pixels adaptive sampling still has to render. */
+            cl_program error_program;               /**< Built-in program comparing the accumulated image with an earlier snapshot of it. */
+            cl_program denoise_program;             /**< Built-in program with the edge-avoiding a-trous wavelet filter. */
+            cl_program upscale_program;             /**< Built-in program scaling a preview image up to the framebuffer size. */
+            cl_program luminance_program;           /**< Built-in program reducing the luminance of an image for auto-exposure. */
             cl_command_queue comm_queue;            /**< The OpenCL command queue.*/
             cl_kernel rend_kernel;                  /**< The main path-tracer kernel.*/
             cl_kernel pp_kernel;                    /**< The kernel for post processing effects like Tone mapping and Gamma Correction.*/
-            cl_mem image_buffers[4];                /**< Image Buffer Objects. There are 2 for swapping role between read and write-only images. Third is for postprocessing*/
+            cl_kernel wf_kernels[WF_KERNEL_COUNT];  /**< Stage kernels if the rendering kernel has the wavefront feature, else NULL. */
+            cl_kernel heatmap_kernel;               /**< Writes the color-mapped cost image to a display image in the post-processing kernel's place. */
+            cl_kernel compact_kernel;               /**< Compacts the unconverged pixels into active_pixel_buffer and copies the converged ones forward. */
+            cl_kernel error_kernel;                 /**< Sums the relative squared difference between the image and snapshot_image per work-group. */
+            cl_kernel denoise_kernel;               /**< One pass of the a-trous filter, guided by the feature buffers. */
+            cl_kernel upscale_kernel;               /**< Bilinearly upscales a preview image into one of the framebuffer images. */
+            cl_kernel luminance_kernel;             /**< Sums the log luminance and finds the maximum per work-group, and fills the luminance histogram. */
+            cl_mem image_buffers[3];                /**< Image Buffer Objects. There are 2 for swapping role between read and write-only images.
+                                                     *   Third is a device-only image of per-pixel costs, only allocated for kernels with the cost-heatmap feature. */
+            cl_mem display_images[2];               /**< RGBA8 images shared with the display textures. The post-processing, heatmap or fused rendering kernel
+                                                     *   writes a frame to the one that isn't on screen. */
+            clCreateEventFromGLsyncKHR_fn createEventFromGLsync;   /**< cl_khr_gl_event entry point turning a GL fence into an event, else NULL. */
             cl_mem vert_buffer;                     /**< The Buffer Object used to hold Scene model data. */
             cl_mem mat_buffer;                      /**< The Buffer Object used to hold material data. */
             cl_mem bvh_buffer;                      /**< The Buffer Object used to hold bvh data. */
             cl_mem binary_heap_buffer;              /**< The Buffer Object used to hold binary heap which is used to traverse bvh. */
-            cl_mem camera_buffer;                   /**< The Buffer Object used to hold Camera data. */
+            cl_mem camera_buffers[CAMERA_RING_SIZE];    /**< Ring of Buffer Objects holding Camera data. */
+            cl_mem camera_buffer;                   /**< The buffer of the ring the current camera was written to. */
+            cl_mem path_buffer;                     /**< Wavefront path states, one per pixel of a tile. */
+            cl_mem ray_queue_buffer;                /**< Wavefront queue of paths to extend. Two halves alternating between bounces. */
+            cl_mem material_queue_buffer;           /**< Wavefront queues of paths to shade. First half diffuse/glossy, second half specular. */
+            cl_mem shadow_queue_buffer;             /**< Wavefront queue of paths with a shadow ray to trace. */
+            cl_mem queue_counter_buffer;            /**< Lengths of the wavefront queues, 4 per bounce. */
+            cl_mem work_counter_buffer;             /**< Next pixel of the tile to be taken by a persistent-threads kernel. Reset to 0 before every launch. */
+            cl_mem ray_counter_buffer;              /**< RAY_COUNTER_COUNT counters incremented by a kernel with the ray-counters feature. Sized for 64 bit counters either way. */
+            cl_mem moments_buffer;                  /**< Per pixel luminance moments kept by a kernel with the adaptive-sampling feature. */
+            cl_mem active_pixel_buffer;             /**< Indices of the pixels that haven't converged yet, y * width + x. */
+            cl_mem active_count_buffer;             /**< Number of valid entries in active_pixel_buffer. */
+            size_t adaptive_num_pixels;             /**< Number of pixels the adaptive sampling buffers were created for. */
+            cl_mem snapshot_image;                  /**< Copy of the accumulated image at an earlier sample count. Device-only, not shared with OpenGL. */
+            cl_mem error_sum_buffer;                /**< One partial sum of the error kernel and of the pixels it covers per work-group. */
+            int snapshot_width, snapshot_height;    /**< Size snapshot_image was created with. */
+            cl_mem albedo_buffer;                   /**< Per pixel first-hit albedo written by a kernel with the feature-buffers feature. */
+            cl_mem normal_depth_buffer;             /**< Per pixel first-hit normal and hit distance written by a kernel with the feature-buffers feature. */
+            cl_mem denoise_images[2];               /**< Device-only images the denoising passes alternate between. */
+            int denoise_width, denoise_height;      /**< Size the denoising buffers were created with. */
+            bool denoise_half;                      /**< Whether the denoising images were created as half floats. */
+            cl_mem prev_camera_buffer;              /**< Camera the accumulated image was rendered with before the last camera move. */
+            cl_mem depth_buffers[2];                /**< First-hit distances of the last two camera moves. They swap roles on every reset. */
+            size_t temporal_num_pixels;             /**< Number of pixels the distance buffers were created for. */
+            cl_mem preview_images[2];               /**< Device-only reduced resolution counterparts of image_buffers[0] and [1]. */
+            int preview_width, preview_height;      /**< Size the preview images were created with. */
+            bool preview_half;                      /**< Whether the preview images were created as half floats. */
+            cl_mem luminance_stats_buffer;          /**< Sum of the log luminance and maximum luminance of every work-group of the luminance kernel. */
+            cl_mem histogram_buffer;                /**< LUMINANCE_BINS pixel counts. Cleared before every reduction. */
+            int luminance_width, luminance_height;  /**< Size the luminance buffers were created for. */
+            size_t wf_num_paths;                    /**< Number of paths the wavefront buffers were created for. */
+            int wf_max_bounces;                     /**< Number of bounces the wavefront counter buffer was created for. */
 
             size_t rendk_wgs;                       /**< The maximum nubmer of Work Items in a Workgroup the rendering kernel can afford due to memory limitations. */
             size_t ppk_wgs;                         /**< The maximum nubmer of Work Items in a Workgroup the post processing kernel can afford due to memory limitations. */
@@ -167,6 +377,11 @@ namespace yune
 
 
             friend class RendererCore;
+            friend class ConvergenceEstimator;
+            friend class ExposureMeter;
+            friend class RayCounterSampler;
+            friend class WavefrontStages;
+            friend class HelperDispatcher;
     };
 }
 #endif // CLMANAGER_H
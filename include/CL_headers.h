@@ -106,6 +106,27 @@ struct alignas(16) Material
     cl_int is_transmissive;    // total 80 bytes.
 };
 
+/* Per-path state of the wavefront path tracer. Only the size matters on the host, the kernels in kernels/wavefront define the same
+ * struct and read/write it between stages.
+ */
+struct alignas(16) PathStateGPU
+{
+    cl_float4 origin;
+    cl_float4 dir;
+    cl_float4 throughput;
+    cl_float4 radiance;
+    cl_float4 hit_point;
+    cl_float4 normal;
+    cl_float4 shadow_dir;
+    cl_float4 shadow_contrib;
+    cl_int triangle_ID;
+    cl_int light_ID;
+    cl_int depth;
+    cl_uint seed;
+    cl_int last_specular;
+    cl_int pad[3];      // total 144 bytes.
+};
+
 inline Material newMaterial()
 {
     return {
@@ -0,0 +1,123 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef CPURENDERER_H
+#define CPURENDERER_H
+
+#include "CL_headers.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yune
+{
+    /** \brief A native path tracer running on the host. It's a port of kernels/legacy/udpt.cl traversing the same BVH and triangle data
+     *  that is uploaded to the GPU, so it can render without any OpenCL device and serves as a reference for kernel changes. The
+     *  random number sequence of every pixel matches the kernel given the same seed.
+     *
+     *  A frame is split in square tiles. A pool of worker threads pulls tiles from a shared atomic counter, so faster threads simply
+     *  take more tiles. Samples are accumulated in place and optionally tonemapped like kernels/post-proc/tonemap.cl.
+     */
+    class CPURenderer
+    {
+        public:
+            CPURenderer();      /**< Default Constructor. */
+            ~CPURenderer();     /**< Default Destructor. Joins the worker threads. */
+
+            /** \brief Allocate the images and (re)start the worker threads. Waits for any frame in progress.
+             *
+             * \param[in] width         Width of the image in pixels.
+             * \param[in] height        Height of the image in pixels.
+             * \param[in] num_threads   Number of worker threads. 0 uses every hardware thread.
+             */
+            void setup(int width, int height, int num_threads);
+
+            /** \brief Set the scene to render. The vectors are referenced, not copied, and must not change while a frame is in progress.
+             */
+            void setScene(const std::vector<TriangleGPU>* vert_data, const std::vector<Material>* mat_data, const std::vector<BVHNodeGPU>* bvh);
+
+            /** \brief Start tracing a frame on the worker threads and return immediately.
+             *
+             * \param[in] cam       Camera data, the same that is passed to the rendering kernel.
+             * \param[in] gi_check  Whether to trace indirect illumination.
+             * \param[in] reset     Discard the accumulated samples.
+             * \param[in] rand      Seed of the frame.
+             * \param[in] spp       Samples per pixel taken in this frame.
+             * \param[in] tonemap   Whether to tonemap and gamma correct the displayed image.
+             */
+            void startFrame(const Cam& cam, bool gi_check, bool reset, cl_uint rand, int spp, bool tonemap);
+
+            bool isFrameDone();     /**< Whether the last started frame has been traced completely. */
+            void waitForFrame();    /**< Block until the last started frame has been traced completely. */
+
+            /** \brief Set a function called from a worker thread when a frame completes.
+             */
+            void setFrameCompletedCb(std::function<void()> cb);
+
+            const std::vector<cl_float>& getDisplayImage();    /**< RGBA image of the last completed frame, bottom row first. */
+
+            float frame_ms;     /**< Wall clock time taken by the last completed frame. */
+            int tile_size;      /**< Width and height of a tile in pixels. */
+
+        private:
+            struct FrameParams
+            {
+                Cam cam;
+                bool gi_check;
+                bool reset;
+                bool tonemap;
+                cl_uint rand;
+                int spp;
+            };
+
+            void workerLoop();
+            void renderTile(int tile);
+            void stopWorkers();
+
+            std::vector<std::thread> workers;
+            std::mutex pool_mutex;
+            std::condition_variable pool_cv;    /**< Wakes the workers when a frame is started or the pool is shut down. */
+            std::condition_variable done_cv;    /**< Signalled when the last tile of a frame is finished. */
+            std::atomic<int> next_tile;         /**< Index of the next tile to be picked up by any worker. */
+            std::atomic<int> tiles_left;        /**< Tiles of the current frame that haven't been finished yet. */
+            std::function<void()> frameCompletedCb;
+
+            const std::vector<TriangleGPU>* vert_data;
+            const std::vector<Material>* mat_data;
+            const std::vector<BVHNodeGPU>* bvh;
+            std::vector<cl_float> accum_image;      /**< Running average of all samples. Alpha holds the number of samples. */
+            std::vector<cl_float> display_image;    /**< Accumulated image after optional tonemapping. */
+            FrameParams params;
+            unsigned long frame_id;
+            double frame_start;
+            int width, height, tiles_x, num_tiles;
+            bool frame_done, quit;
+    };
+}
+#endif // CPURENDERER_H
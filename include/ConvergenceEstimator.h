@@ -0,0 +1,72 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef CONVERGENCEESTIMATOR_H
+#define CONVERGENCEESTIMATOR_H
+
+#include "CLManager.h"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Estimates how much noise is left in the accumulated image while it renders. The image shares the samples of every pixel
+     *  with a snapshot taken earlier, so the relative MSE of the image follows from the difference between the two, see the error
+     *  kernel in CLManager.cpp. The partial sums are read back without blocking and the snapshot is renewed whenever the sample count doubles.
+     */
+    class ConvergenceEstimator
+    {
+        public:
+            ConvergenceEstimator(CLManager& cl_manager);    /**< Default Constructor. */
+
+            /** \brief Size the readback for an image. Call once CLManager::setupConvergenceBuffers() succeeded for the same size.
+             */
+            void setup(int width, int height);
+
+            /** \brief Compare a finished frame against the snapshot if an estimate is due and renew the snapshot if it's outdated.
+             *  Only enqueues commands on the primary queue.
+             *
+             * \param[in] image     Accumulated image of the frame.
+             * \param[in] width     Width of the image.
+             * \param[in] height    Height of the image.
+             * \param[in] samples   Samples per pixel accumulated into the image.
+             * \param[in] interval  Frames between two estimates.
+             */
+            void evaluate(cl_mem image, int width, int height, unsigned long samples, int interval);
+
+            void poll();            /**< Take the estimate of a readback that completed. Doesn't block. */
+            void reset();           /**< Forget the snapshot and the estimate. Waits for a readback in flight, it belongs to the discarded image. */
+            void release();         /**< Drop a readback in flight without waiting. Only once the queue is finished. */
+            float getError() const; /**< Relative MSE of the last estimate, negative if there's none yet. */
+
+        private:
+            CLManager& cl_manager;
+            unsigned long snapshot_samples;     /**< Samples of the accumulated image when snapshot_image was taken. 0 if there's none. */
+            int frames_since_error;             /**< Frames evaluated since the last estimate was enqueued. */
+            cl_event error_event;               /**< Non-blocking read of the partial error sums in flight, else NULL. */
+            std::vector<cl_float2> error_sums;  /**< Destination of the partial error sums readback. x error, y pixels. */
+            float error_estimate;
+    };
+}
+#endif // CONVERGENCEESTIMATOR_H
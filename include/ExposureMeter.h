@@ -0,0 +1,82 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef EXPOSUREMETER_H
+#define EXPOSUREMETER_H
+
+#include "CLManager.h"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Meters the scene luminance for auto-exposure. The image is reduced to per work-group log luminance sums and maxima and
+     *  a histogram on the device, which are read back without blocking. The exposure and the white point follow the readbacks with
+     *  exponential smoothing, so they lag the image by a frame or so.
+     */
+    class ExposureMeter
+    {
+        public:
+            ExposureMeter(CLManager& cl_manager);   /**< Default Constructor. */
+
+            /** \brief Size the readbacks for an image. Call once CLManager::setupLuminanceBuffers() succeeded for the same size.
+             */
+            void setup(int width, int height);
+
+            /** \brief Enqueue a reduction of an image unless the last one wasn't read yet.
+             *
+             * \param[in] image     Image to meter. Only pixels within gws are read.
+             * \param[in] gws       Size of the image in pixels.
+             * \param[out] event    Event of the reduction kernel, untouched if none was enqueued.
+             */
+            void enqueueReduction(cl_mem image, const size_t gws[2], cl_event* event);
+
+            /** \brief Take the luminance of a reduction that was read back and adapt the exposure towards it. Doesn't block.
+             *
+             * \param[in] key               Average luminance the image is exposed to.
+             * \param[in] adapt_time        Seconds the exposure takes to adapt by a factor of e.
+             * \param[in] histogram         Whether the white point is taken from the histogram instead of the brightest pixel.
+             * \param[in] white_percentile  Fraction of pixels below the white point with the histogram.
+             * \param[in] now               Current time in seconds.
+             */
+            void poll(float key, float adapt_time, bool histogram, float white_percentile, double now);
+
+            void reset();               /**< Forget the exposure. The next reduction read back is taken as is. */
+            void release();             /**< Drop a readback in flight without waiting. Only once the queue is finished. */
+            float getScale() const;     /**< Factor the radiance is exposed with, 1 until the first reduction was read. */
+            float getWhitePoint() const;    /**< White point of the Reinhard operator in exposed units. */
+
+        private:
+            CLManager& cl_manager;
+            int pixels;                                 /**< Pixels of the image the readbacks are sized for. */
+            cl_event read_event;                        /**< Non-blocking read of the reduction in flight, else NULL. */
+            std::vector<cl_float2> luminance_stats;     /**< Destination of the per work-group log luminance sums and maxima. */
+            std::vector<cl_uint> luminance_histogram;   /**< Destination of the luminance histogram. */
+            float exposure_scale;
+            float white_luminance;                      /**< Smoothed scene luminance mapped to white. */
+            bool exposure_valid;                        /**< Whether a reduction has been read since the last reset(). */
+            double exposure_time;                       /**< Time the exposure was last updated. */
+    };
+}
+#endif // EXPOSUREMETER_H
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef EXRWRITER_H
+#define EXRWRITER_H
+
+#include <string>
+#include <vector>
+
+namespace yune
+{
+    /** \brief Writes multi-channel OpenEXR images. Scanlines are stored in blocks of 16 with ZIP compression, the blocks are compressed
+     *  in parallel. Each channel is stored as half or full floats and any number of them, e.g. auxiliary buffers next to the
+     *  beauty, go into the same file.
+     */
+    class ExrWriter
+    {
+        public:
+            /** \brief A channel to write. Values are read from data with the given stride, rows bottom first like glReadPixels() returns them. */
+            struct Channel
+            {
+                std::string name;       /**< Name in the file, e.g. "R" or "albedo.R". */
+                const float* data;      /**< Value of the bottom left pixel. */
+                int stride;             /**< Floats from one pixel to the next. */
+                bool half;              /**< Store half floats instead of full floats. Only for values that fit, e.g. not sample counts or depth. */
+            };
+
+            /** \brief Write an image.
+             *
+             * \param[in] filename      Path of the file to write.
+             * \param[in] width         Width of the image in pixels.
+             * \param[in] height        Height of the image in pixels.
+             * \param[in] channels      Channels to write. They are sorted by name as the format requires.
+             * \param[in] num_threads   Threads compressing blocks. 0 uses every hardware thread.
+             * \return True if the file was written.
+             */
+            static bool write(const std::string& filename, int width, int height, std::vector<Channel> channels, int num_threads);
+    };
+}
+#endif // EXRWRITER_H
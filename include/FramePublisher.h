@@ -0,0 +1,142 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FRAMEPUBLISHER_H
+#define FRAMEPUBLISHER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+namespace yune
+{
+    /** \brief Layout of the shared memory a \ref FramePublisher writes to. The header is followed by slot_count slots, each one a
+     *  \ref FrameSlot followed by the pixels. Everything is in the host's byte order, readers have to run on the same machine anyway.
+     */
+    struct FrameRing
+    {
+        char magic[8];                      /**< "YUNEFRM1". */
+        int32_t width, height;              /**< Size of every frame in pixels. */
+        int32_t channels;                   /**< Floats per pixel. RGB hold the accumulated radiance, alpha the samples of the pixel. */
+        int32_t slot_count;                 /**< Number of slots frames are written to in turn. */
+        uint64_t slot_stride;               /**< Bytes from the start of one slot to the next. */
+        std::atomic<uint64_t> latest;       /**< Sequence number of the newest complete frame. Frames start at 1, 0 means none yet. */
+        std::atomic<uint32_t> closed;       /**< Set before the publisher goes away, e.g. to recreate the ring at another size. */
+    };
+
+    /** \brief Header of a slot. Frame n goes to slot n % slot_count. The sequence is odd while the slot is written and 2n once frame n
+     *  is complete, so a reader can tell whether the pixels changed under it by comparing it before and after reading them.
+     */
+    struct FrameSlot
+    {
+        std::atomic<uint64_t> sequence;
+        uint64_t samples;                   /**< Samples per pixel accumulated into the frame. Adaptive sampling leaves the per pixel count in alpha. */
+        double time;                        /**< Seconds since the publisher was opened. */
+    };
+
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "The frame ring needs address free 64 bit atomics.");
+
+    /** \brief Publishes frames into a ring in named shared memory, POSIX shm_open() or a Windows file mapping, so a local process can
+     *  read them without any disk I/O. A reader maps the same memory and reads the pixels in place, see \ref FrameSubscriber and
+     *  tools/frame_consumer.cpp. The writer never waits for readers. A reader too slow for slot_count - 1 frames notices it through
+     *  the sequence and simply drops the frame.
+     */
+    class FramePublisher
+    {
+        public:
+            FramePublisher();       /**< Default Constructor. */
+            ~FramePublisher();      /**< Default Destructor. Closes the ring. */
+
+            /** \brief Create the ring, replacing one that is open.
+             *
+             * \param[in] name          Name of the shared memory. A leading '/' is added for POSIX if missing.
+             * \param[in] width         Width of the frames in pixels.
+             * \param[in] height        Height of the frames in pixels.
+             * \param[in] slot_count    Number of frames kept in the ring.
+             * \return True if the ring was created, else false and getError() says why.
+             */
+            bool open(const std::string& name, int width, int height, int slot_count = 3);
+
+            void close();           /**< Mark the ring closed and unmap it. The name is removed, readers keep their mapping until they close it. */
+
+            /** \brief Copy a frame into the next slot and make it the latest.
+             *
+             * \param[in] pixels    width * height RGBA floats, bottom row first as glReadPixels() returns them.
+             * \param[in] samples   Samples per pixel accumulated into the frame.
+             */
+            void publish(const float* pixels, uint64_t samples);
+
+            bool isOpen() const;                        /**< Whether a ring is open. */
+            bool matches(const std::string& name, int width, int height) const;    /**< Whether the open ring has this name and size. */
+            uint64_t getSequence() const;               /**< Sequence number of the last published frame. */
+            const std::string& getError() const;        /**< Reason the last open() failed. */
+
+        private:
+            std::string name;
+            std::string error;
+            FrameRing* ring;
+            size_t size;
+            uint64_t sequence;
+            double open_time;
+            void* handle;       /**< The file mapping on Windows. Unused elsewhere. */
+    };
+
+    /** \brief Reads frames from a ring created by a \ref FramePublisher in place.
+     */
+    class FrameSubscriber
+    {
+        public:
+            FrameSubscriber();      /**< Default Constructor. */
+            ~FrameSubscriber();     /**< Default Destructor. Unmaps the ring. */
+
+            /** \brief Map an existing ring.
+             *
+             * \param[in] name  Name the publisher was opened with.
+             * \return True if a valid ring was mapped.
+             */
+            bool open(const std::string& name);
+            void close();           /**< Unmap the ring. */
+
+            /** \brief Get the newest complete frame if it's newer than the given one.
+             *
+             * \param[in] after     Sequence number of the last frame the caller has seen.
+             * \param[out] sequence Sequence number of the frame returned.
+             * \return Pointer to the pixels in shared memory, or NULL if there's no newer frame. The pixels are only valid as long as
+             *  isValid() returns true for the sequence after they were used.
+             */
+            const float* latest(uint64_t after, uint64_t& sequence);
+
+            bool isValid(uint64_t sequence) const;      /**< Whether a frame returned by latest() is still in it's slot untouched. */
+            bool isClosed() const;                      /**< Whether the publisher closed the ring. Reopen to follow a new one. */
+            const FrameRing* getRing() const;           /**< Header of the mapped ring, NULL if none. */
+            const FrameSlot* getSlot(uint64_t sequence) const;     /**< Header of the slot a frame goes to. */
+
+        private:
+            FrameRing* ring;
+            size_t size;
+            void* handle;
+    };
+}
+#endif // FRAMEPUBLISHER_H
@@ -55,6 +55,12 @@ namespace yune
              */
             bool setupGlBuffer();
 
+            /** \brief Draw a texture over the whole default framebuffer with a single triangle, one texel per pixel.
+             *
+             * \param[in] texture   The texture to draw. It must be the size of the framebuffer.
+             */
+            void drawDisplay(GLuint texture);
+
             /** \brief Show the created Window.
              *
              *  Windows are created hidden initially. This functions is called just before entering the event processing loop to display the window.
@@ -90,11 +96,21 @@ namespace yune
              */
             void createWindow(int width, int height);
 
+            /** \brief Compile the shaders drawing the display textures. Throws if they fail to compile or link.
+             */
+            void createDisplayProgram();
+
             static std::function<void(const glm::vec4&, float, float)> cameraUpdateCallback;   /**< The function pointer to the Camera Update Callback function. */
             static std::function<void(const std::string&, const std::string&, const std::string&)> setMessageCb;   /**< The function pointer to the RendererGUI message callback function. */
 
             GLuint fbo_ID;              /**< OpenGL FrameBuffer Object ID */
-            GLuint rbo_IDs[4];          /**< OpenGL RenderBuffer Object IDs for OpenCL read and write only Images and post-processing. The fourth RBO is temporary for storing a copy of latest output image by kernel. */
+            GLuint rbo_IDs[2];          /**< OpenGL RenderBuffer Object IDs for the OpenCL read and write only accumulation Images. */
+            GLuint display_tex_IDs[2];  /**< RGBA8 textures shared with OpenCL holding the displayed frame. One is drawn while the next frame is post-processed, tonemapped
+                                         *   by the kernel or copied into the other. */
+            GLuint display_program;     /**< Shader program drawing a display texture with a fullscreen triangle. */
+            GLuint display_vao;         /**< Empty vertex array bound for the fullscreen triangle, whose vertices come from gl_VertexID. */
+            GLuint upload_fbo_ID;       /**< OpenGL FrameBuffer Object ID with upload_tex_ID attached. Used as blit source for images rendered on the host. */
+            GLuint upload_tex_ID;       /**< OpenGL Texture ID images rendered on the host are uploaded to. */
             float old_cursor_x;         /**< Store the previous cursor X coordinate.*/
             float old_cursor_y;         /**< Store the previous cursor Y coordinate.*/
             bool space_flag;            /**< Store if the Space Key is in pressed state.*/
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef HELPERDISPATCHER_H
+#define HELPERDISPATCHER_H
+
+#include "CLManager.h"
+#include "TileScheduler.h"
+#include "glm/vec2.hpp"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Renders the share of a frame's tiles given to the secondary devices. The devices don't share a context with the primary
+     *  device, so the accumulated history of their tiles goes through host staging memory to their private images and the result
+     *  comes back the same way. Nothing blocks, transfers of different contexts wait on each other on the device through user events.
+     */
+    class HelperDispatcher
+    {
+        public:
+            HelperDispatcher(CLManager& cl_manager, TileScheduler& tile_scheduler);    /**< Default Constructor. */
+
+            void setup();       /**< Size the tile lists and staging memory for the secondary devices of the loaded program. */
+
+            /** \brief Tiles of every secondary device in the current frame. Filled by TileScheduler::schedule().
+             */
+            std::vector<std::vector<int>>& getBlocks();
+
+            /** \brief Upload the history of every secondary device's tiles, enqueue the tiles and read them back.
+             *
+             * \param[in] input             Accumulation image read by the frame. The other one is written.
+             * \param[in] history           Whether the accumulated history is uploaded. Not needed when the frame resets it.
+             * \param[in] grid              Tile grid of the frame.
+             * \param[in] width             Width of the image.
+             * \param[in] height            Height of the image.
+             * \param[in] gws               Global workgroup size of a tile.
+             * \param[in] lws               Local workgroup size of a tile, or 0 to let the runtime choose.
+             * \param[in] persistent        Whether the kernels are persistent-threads kernels.
+             * \param[in] persistent_lws    Workgroup size of a persistent-threads launch on the primary device.
+             * \param[in] groups_per_cu     Work-groups per compute unit of a persistent-threads launch.
+             */
+            void enqueue(int input, bool history, glm::ivec2 grid, int width, int height, const size_t gws[2], const size_t lws[2],
+                         bool persistent, size_t persistent_lws, int groups_per_cu);
+
+            /** \brief Write the tiles read back from the secondary devices into an accumulation image of the primary device.
+             *
+             * \param[in] output    Accumulation image written by the frame.
+             */
+            void composite(int output);
+
+            void retire(bool wait);     /**< Measure secondary devices whose last frame was read back. If wait is set, block until all were. */
+
+        private:
+            static void CL_CALLBACK completeGate(cl_event event, cl_int status, void* user_data);    /**< Completes the user event made by chainEvent() along with it's source. */
+
+            /** \brief Make a user event in context that completes along with source, so commands of one context can wait on a
+             *  command of another one on the device. The caller owns one reference to it.
+             */
+            cl_event chainEvent(cl_event source, cl_context context);
+
+            CLManager& cl_manager;
+            TileScheduler& tile_scheduler;              /**< Gets the measured time per tile of every secondary device. */
+            std::vector<std::vector<int>> blocks;
+            std::vector<std::vector<cl_float>> staging; /**< Host memory through which tile data is moved between devices. */
+            std::vector<cl_event> events;               /**< First and last command enqueued on each secondary device, used for profiling. */
+            std::vector<cl_event> writes;               /**< Last write of each secondary device's tiles into the shared image, else NULL. The staging memory is in use until it completed. */
+            glm::ivec2 grid;                            /**< Tile grid of the frame in flight. */
+            int width, height;
+    };
+}
+#endif // HELPERDISPATCHER_H
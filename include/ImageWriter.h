@@ -0,0 +1,102 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yune
+{
+    /** \brief Encodes and writes images on a background thread so saving doesn't stall rendering. Pixel storage of finished jobs is
+     *  kept and handed out again by acquireJob(), so periodic saves of the same size don't allocate.
+     *
+     *  Besides PNG, JPG and HDR images it writes multi-channel EXR images through \ref ExrWriter and ".yck" checkpoints, a header followed by the raw RGBA floats. Checkpoints go to a
+     *  temporary file first which then replaces the old one, so a crash while writing never leaves a broken checkpoint behind.
+     */
+    class ImageWriter
+    {
+        public:
+            /** \brief An image waiting to be written. Rows are tightly packed, bottom row first like glReadPixels() returns them. */
+            struct Job
+            {
+                std::string filename;
+                std::string ext;                    /**< One of ".png", ".jpg", ".hdr", ".exr" or ".yck". */
+                int width, height;
+                int channels;                       /**< 3 for 8 bit and ".hdr" images, 4 for ".exr" images and checkpoints. */
+                std::vector<unsigned char> pixels;  /**< RGB bytes, used for ".png" and ".jpg". */
+                std::vector<float> hdr_pixels;      /**< Floats, used for ".hdr", ".exr" and ".yck". The alpha of ".exr" images holds the sample count. */
+                std::vector<float> albedo;          /**< RGBA first-hit albedo added to ".exr" images if not empty. */
+                std::vector<float> normal_depth;    /**< First-hit normal in xyz and distance in w added to ".exr" images if not empty. */
+                bool half;                          /**< Store the color, albedo and normal channels of ".exr" images as half floats. Sample counts and depth stay full floats. */
+                int threads;                        /**< Threads compressing ".exr" images. 0 uses every hardware thread. */
+                std::string header;                 /**< Bytes written before the pixels of a checkpoint. */
+            };
+
+            ImageWriter();      /**< Default Constructor. Starts the writer thread. */
+            ~ImageWriter();     /**< Default Destructor. Writes the queued images and joins the writer thread. */
+
+            /** \brief Get a job whose pixel storage is recycled from a finished one if possible.
+             */
+            Job acquireJob();
+
+            /** \brief Queue a job. It's written in the order submitted.
+             */
+            void submit(Job job);
+
+            /** \brief Set a function called from the writer thread whenever a job finishes.
+             */
+            void setJobCompletedCb(std::function<void()> cb);
+
+            /** \brief File names of the images that couldn't be written since the last call.
+             */
+            std::vector<std::string> takeFailures();
+
+            bool isIdle();      /**< Whether every submitted job has been written. */
+            void waitForIdle(); /**< Block until every submitted job has been written. */
+
+        private:
+            void writerLoop();
+            static bool writeCheckpoint(const Job& job);
+            static bool writeExr(const Job& job);
+
+            std::thread writer;
+            std::mutex queue_mutex;
+            std::condition_variable queue_cv;   /**< Wakes the writer when a job is submitted or it's shut down. */
+            std::condition_variable idle_cv;    /**< Signalled when the queue runs empty. */
+            std::deque<Job> jobs;
+            std::vector<Job> free_jobs;         /**< Finished jobs kept for their pixel storage. */
+            std::vector<std::string> failures;
+            std::function<void()> jobCompletedCb;
+            bool busy, quit;
+    };
+}
+#endif // IMAGEWRITER_H
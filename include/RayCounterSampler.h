@@ -0,0 +1,97 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef RAYCOUNTERSAMPLER_H
+#define RAYCOUNTERSAMPLER_H
+
+#include "CLManager.h"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Statistics of the last frame in which the ray counters were sampled. */
+    struct RayStats
+    {
+        bool valid;                     /**< Whether any frame was sampled since the renderer was started. */
+        double mrays_per_sec;           /**< Millions of rays traced per second of rendering kernel time. */
+        float nodes_per_ray;            /**< BVH nodes visited per traced ray. */
+        float triangle_tests_per_ray;   /**< Ray-triangle tests per traced ray. */
+        float shadow_ray_share;         /**< Fraction of the traced rays that were shadow rays. */
+        cl_ulong rays;                  /**< Rays traced in the sampled frame. Summed over the tiles with 32 bit counters. */
+        cl_ulong path_length[CLManager::PATH_LENGTH_BINS]; /**< Camera paths by number of segments. Index 0 holds paths of length 1. */
+    };
+
+    /** \brief Samples the counters of a rendering kernel with the ray-counters feature every few frames. Counters are only meaningful
+     *  for a frame they were cleared before, frames in between may wrap them around freely. The counters of a sampled frame are read
+     *  back without stalling and turned into \ref RayStats once the read completes.
+     */
+    class RayCounterSampler
+    {
+        public:
+            RayCounterSampler(CLManager& cl_manager);   /**< Default Constructor. */
+
+            /** \brief Clear the counters before the tiles of a frame if a sample is due.
+             *
+             * \param[in] interval  Frames between two samples.
+             */
+            void beginFrame(int interval);
+
+            /** \brief Make room for a readback after every tile of a sampled frame with 32 bit counters. Called once the tiles of the
+             *  frame are known. They may only be trimmed afterwards, reads into the room are in flight.
+             */
+            void reserveTiles(size_t tiles);
+
+            /** \brief Read and clear 32 bit counters after a tile was enqueued. They can wrap over a whole frame, so the host sums the
+             *  tiles instead. The queue is in-order, so each read sees exactly that tile. Does nothing for other frames.
+             */
+            void tileEnqueued();
+
+            /** \brief Enqueue the read of the counters of a sampled frame after it's last tile.
+             *
+             * \param[in] frame_ms  Rendering kernel time of the frame.
+             */
+            void finishFrame(double frame_ms);
+
+            /** \brief Turn a read that completed into statistics. Doesn't block.
+             *
+             * \param[out] stats    Statistics of the sampled frame, untouched until a read completed.
+             */
+            void poll(RayStats& stats);
+
+            void reset();           /**< Sample the next frame that can be sampled. */
+            void release();         /**< Drop a readback in flight without waiting. Only once the queue is finished. */
+
+        private:
+            CLManager& cl_manager;
+            bool sampling;                                      /**< Whether the counters were cleared at the start of the current frame. */
+            int frames_since_sample;                            /**< Frames completed since the counters were last sampled. */
+            cl_event read_event;                                /**< Non-blocking read of the counters in flight, else NULL. */
+            double frame_ms;                                    /**< Rendering kernel time of the frame the counters in flight belong to. */
+            cl_ulong counter_data[CLManager::RAY_COUNTER_COUNT];  /**< Destination of the counter readback with 64 bit counters. */
+            std::vector<cl_uint> counter_tiles;                 /**< Destination of the per-tile readbacks with 32 bit counters, RAY_COUNTER_COUNT per tile. */
+            size_t tile_count;                                  /**< Tiles of the sampled frame read into counter_tiles. */
+    };
+}
+#endif // RAYCOUNTERSAMPLER_H
@@ -28,12 +28,26 @@
 
 #include "Scene.h"
 #include "CLManager.h"
+#include "ConvergenceEstimator.h"
+#include "ExposureMeter.h"
+#include "RayCounterSampler.h"
+#include "TileScheduler.h"
+#include "WavefrontStages.h"
+#include "CPURenderer.h"
+#include "FramePublisher.h"
+#include "HelperDispatcher.h"
 #include "GlfwManager.h"
+#include "ImageWriter.h"
 #include "glm/vec2.hpp"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <random>
 #include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace yune
@@ -66,6 +80,20 @@ namespace yune
              */
             void render();
 
+            /** \brief Ask for the next frame the submission thread completes to be saved. The name is taken when the frame is saved.
+             */
+            void requestSave(const std::string& fn, const std::string& ext);
+
+            /** \brief Whether enqueueKernels() can make progress right away. If false, nothing will change until an enqueued command
+             *  completes, which wakes the GUI thread through glfwPostEmptyEvent(), so the caller can sleep in glfwWaitEventsTimeout().
+             */
+            bool canMakeProgress();
+
+            /** \brief Whether image readbacks are in flight. Their GL fences can't wake the GUI thread, so they have to be polled
+             *  by calling enqueueKernels() again after a short wait.
+             */
+            bool hasPendingSaves();
+
             /** \brief Set the callback function to set messages shown by GUI incase of any event
              */
             void setGuiMessageCb(std::function<void(const std::string&, const std::string&, const std::string&)>);
@@ -76,42 +104,377 @@ namespace yune
             void resetValues();
             void stop();
 
+            /** \brief Write the events recorded by \ref Tracer to a Chrome trace JSON file and report the outcome to the GUI.
+             *
+             * \param[in] filename  Path of the file to write.
+             * \return True if the file was written.
+             */
+            bool saveTrace(const std::string& filename);
+
             Scene render_scene;
             std::string save_fn, save_ext, save_samples_fn, save_samples_ext;
-            bool save_pending, save_editor, new_gi_check;
+            bool save_editor, new_gi_check;
             unsigned long samples_taken, save_at_samples, time_passed;
             float ms_per_rk, ms_per_ppk, mspf_avg;
             int fps;
 
             glm::ivec2 blocks;
+            int max_bounces;            /**< Maximum path length of wavefront kernels. Each bounce launches the extend, shade and connect stages once. */
+            float ms_per_stage[CLManager::WF_KERNEL_COUNT + 1];    /**< Average time per tile of every wavefront stage. The last one is the accumulating rendering kernel. */
+            int spp_per_launch;         /**< Samples per pixel taken by a single launch. Only used if the kernel has the spp-per-launch feature. */
+            int tiles_in_flight;        /**< Number of tiles kept queued on the device at once. */
+            float target_ms_per_tile;   /**< Execution time per tile the grid is resized towards when adaptive tiles are enabled. */
+            bool adaptive_tiles;        /**< Resize the tile grid every frame to match target_ms_per_tile. */
+            int persistent_groups_per_cu;   /**< Work-groups launched per compute unit if the kernel has the persistent-threads feature. */
+            int counter_interval;       /**< Frames between two samples of the ray counters if the kernel has the ray-counters feature. */
+            bool write_report;          /**< Write the render statistics to a .txt file next to every saved image. */
+            bool show_heatmap;          /**< Display the color-mapped cost image instead of the render if the kernel has the cost-heatmap feature. */
+            int heatmap_channel;        /**< Cost shown by the heatmap. 0 BVH nodes visited, 1 triangle tests, 2 rays traced, all per sample. */
+            float heatmap_max;          /**< Cost mapped to the top of the color scale. */
+            float adaptive_threshold;   /**< Relative standard error of a pixel's mean luminance below which adaptive sampling stops rendering it. */
+            int adaptive_min_spp;       /**< Samples every pixel takes before adaptive sampling may consider it converged. */
+            float active_pixel_share;   /**< Fraction of the pixels rendered in the last frame if the kernel has the adaptive-sampling feature. */
+            float target_error;         /**< Relative MSE at which the render is saved and stopped. 0 disables the check. */
+            float time_budget;          /**< Seconds after which the render is saved and stopped, counted from the last reset. 0 disables the check. */
+            int convergence_interval;   /**< Frames between two estimates of the relative MSE. */
+            float convergence_error;    /**< Last estimate of the relative MSE of the accumulated image. Negative until the first estimate. */
+            bool denoise;               /**< Run the a-trous denoiser before the post-processing kernel if the kernel has the feature-buffers feature. */
+            int denoise_passes;         /**< Number of a-trous passes. Pass i spreads the filter taps 2^i pixels apart. */
+            float denoise_sigma_color;  /**< Color difference at which the weight of a tap falls off in the first pass. Halved every pass. */
+            float denoise_sigma_normal; /**< Exponent applied to the cosine between the normals of the center and a tap. */
+            float denoise_sigma_depth;  /**< Relative depth difference at which the weight of a tap falls off. */
+            float ms_per_denoise;       /**< Average time per frame spent in the denoising passes. */
+            bool auto_exposure;         /**< Expose the image from it's log-average luminance if the post-processing kernel has the auto-exposure feature. */
+            float exposure_key;         /**< Display luminance the log-average luminance of the image is mapped to. */
+            float exposure_adapt_time;  /**< Seconds over which the exposure follows about 63% of a change in brightness. */
+            bool exposure_histogram;    /**< Take the white point from the luminance histogram instead of the brightest pixel, so fireflies don't dim the image. */
+            float exposure_white_percentile;    /**< Share of the pixels below the white point when the histogram is used. */
+            float exposure;             /**< Smoothed factor the image is scaled by before tonemapping. */
+            float ms_per_exposure;      /**< Average time per frame spent reducing the luminance. */
+            bool half_targets;          /**< Create the denoising and preview images as half floats. The accumulation stays float. Applied on Start. */
+            float mb_per_frame;         /**< Megabytes of image data the device reads and writes per frame, averaged over the last second. Computed from the passes, not measured. */
+            bool fused_tonemap;         /**< Let the rendering kernel write the tonemapped frame if it has the fused-tonemap feature, skipping the built-in post-processing kernel. Off by default. */
+            bool temporal_reprojection; /**< Carry the accumulated image over camera moves if the kernel has the temporal-reprojection feature. */
+            int temporal_max_history;   /**< Samples reprojected history is worth at most. Higher values are smoother but ghost longer. */
+            bool preview_enabled;       /**< Render at a reduced resolution while the camera moves and upscale. Not available for wavefront or persistent kernels or multiple devices. */
+            float preview_target_ms;    /**< Rendering kernel time per frame the preview resolution is adapted towards. */
+            int preview_max_scale;      /**< Largest factor the preview resolution is divided by. */
+            float preview_settle_ms;    /**< Time preview frames continue after the last camera move before rendering starts over at full resolution. */
+            int preview_scale;          /**< Factor the resolution of the last preview frame was divided by. */
+            std::string checkpoint_fn;  /**< File the raw accumulation is checkpointed to. Empty disables checkpoints. */
+            unsigned long checkpoint_samples;   /**< Write a checkpoint every this many samples. 0 disables the sample interval. */
+            float checkpoint_minutes;   /**< Write a checkpoint every this many minutes. 0 disables the time interval. */
+            std::string resume_fn;      /**< Checkpoint to continue from at the start of the next frame. Cleared once it was loaded. */
+            bool exr_half;              /**< Store the color, albedo and normal channels of saved .exr images as half floats. */
+            int exr_threads;            /**< Threads compressing saved .exr images. 0 uses every hardware thread. */
+            bool publish_frames;        /**< Publish the raw accumulation to a shared memory ring a local process can read, see FramePublisher. */
+            std::string publish_name;   /**< Name of the shared memory frames are published to. */
+            int publish_interval;       /**< Publish every this many frames. */
+
+            enum StopReason { STOP_NONE, STOP_CONVERGED, STOP_TIME_BUDGET };
+            StopReason stop_reason;     /**< Why the render was stopped automatically. No new frames are started until the camera or GI changes. */
+            bool cpu_backend;           /**< Render on the host with \ref CPURenderer instead of the loaded OpenCL kernels. Must not change while rendering. */
+            int cpu_threads;            /**< Number of worker threads of the CPU backend. 0 uses every hardware thread. */
+            std::vector<float> device_share;    /**< Fraction of blocks given to each device in the last frame. Index 0 is the device sharing the GL context. */
             size_t rk_gws[2];    /**< Global workgroup size for Rendeirng Kernel.*/
             size_t ppk_gws[2];   /**< Global workgroup size for Post-processing Kernel.*/
             size_t rk_lws[2];    /**< Local workgroup size for Rendering Kernel.*/
             size_t ppk_lws[2];   /**< Local workgroup size for Post-processing Kernel.*/
 
+            RayStats ray_stats;         /**< Statistics of the last frame in which the ray counters were sampled. */
+
             private:
+            /** \brief An image read back into a pixel buffer object that hasn't been handed to the writer yet. */
+            struct PendingSave
+            {
+                GLuint pbo;
+                GLsync fence;               /**< Signalled once the readback into pbo has completed. */
+                size_t size;                /**< Bytes read back. */
+                bool floats;                /**< Whether the pixels are read back as floats instead of bytes. */
+                cl_event aov_event;         /**< Last readback of the feature buffers into the job, else NULL. */
+                ImageWriter::Job job;
+            };
+
+            /** \brief Frame counts and device times summed until the benchmarks are averaged. */
+            struct FrameStats
+            {
+                int frames;
+                int launches;               /**< Rendering kernel launches. */
+                double frame_time;          /**< Seconds from the start of every frame until the host was done with it. */
+                double rk, ppk, denoise, exposure;                  /**< Device milliseconds of every kind of kernel. */
+                double stage[CLManager::WF_KERNEL_COUNT + 1];       /**< Device milliseconds of every wavefront stage and the accumulating kernel. */
+                double image_bytes;         /**< Estimated image traffic. */
+
+                void add(const FrameStats& other);
+            };
+
+            /** \brief The settings edited in the GUI that rendering a frame depends on. The submission thread renders every frame with a
+             *  copy taken when it starts, so the GUI thread can change them at any time.
+             */
+            struct FrameSettings
+            {
+                glm::ivec2 blocks;
+                size_t rk_gws[2], rk_lws[2], ppk_gws[2], ppk_lws[2];
+                int max_bounces;
+                int spp_per_launch;
+                int tiles_in_flight;
+                float target_ms_per_tile;
+                bool adaptive_tiles;
+                int persistent_groups_per_cu;
+                int counter_interval;
+                bool write_report;
+                bool show_heatmap;
+                int heatmap_channel;
+                float heatmap_max;
+                float adaptive_threshold;
+                int adaptive_min_spp;
+                float target_error;
+                float time_budget;
+                int convergence_interval;
+                bool denoise;
+                int denoise_passes;
+                float denoise_sigma_color, denoise_sigma_normal, denoise_sigma_depth;
+                bool auto_exposure;
+                float exposure_key;
+                float exposure_adapt_time;
+                bool exposure_histogram;
+                float exposure_white_percentile;
+                bool fused_tonemap;
+                bool temporal_reprojection;
+                int temporal_max_history;
+                bool preview_enabled;
+                float preview_target_ms;
+                int preview_max_scale;
+                float preview_settle_ms;
+                unsigned long checkpoint_samples;
+                float checkpoint_minutes;
+                bool publish_frames;
+                int publish_interval;
+                unsigned long save_at_samples;
+            };
+
+            /** \brief Kernels writing a display image whose timings haven't been collected yet. */
+            struct DisplayPass
+            {
+                cl_event ppk_event;                     /**< Post-processing or heatmap kernel. */
+                std::vector<cl_event> denoise_events;
+                cl_event luminance_event;               /**< Luminance reduction, else NULL. */
+            };
+
+            /** \brief A frame the submission thread completed. It waits in the mailbox until the GUI thread takes it. */
+            struct FrameResult
+            {
+                bool valid;                 /**< Whether this holds a frame. */
+                bool failed;                /**< The submission thread ran into an error and stopped. */
+                std::string error;          /**< Message of the error, empty if it was reported already. */
+                int display;                /**< Display image holding the frame, -1 if a later frame took it over. */
+                cl_event display_event;     /**< Last kernel writing the display image, else NULL. The frame is taken once it completed. */
+                bool show;                  /**< Put the display image on screen. False if it was only post-processed to be saved behind the heatmap view. */
+                bool blit;                  /**< No kernel writes the display image, the GUI thread copies the accumulation into it. */
+                int accumulation;           /**< Accumulation image the frame was written to. */
+                bool preview;               /**< Whether it's an upscaled preview frame. */
+                bool save, save_samples, checkpoint, auto_stopped;  /**< Saves the GUI thread reads from the images of the frame. */
+                bool hold;                  /**< The GUI thread uses the images of this frame. No frame is started until it's done with them. */
+                cl_event publish_event;     /**< Read of the accumulation into publish_pixels, else NULL. */
+                cl_ulong publish_samples;   /**< Samples per pixel of the published frame. */
+                FrameStats stats;           /**< Summed over this frame and the untaken frames it replaced. */
+                unsigned long samples;      /**< Statistics of the submission thread when the frame completed, see the public members. */
+                float convergence_error;
+                StopReason stop_reason;
+                double stop_elapsed;
+                float active_pixel_share;
+                int preview_scale;
+                float exposure;
+                RayStats ray_stats;
+                std::vector<float> device_share;
+                glm::ivec2 blocks;          /**< Tile grid the frame was rendered with. */
+            };
+
             void loadOptions();
-            void updateRenderKernelArgs(bool new_gi_check, cl_uint seed);
+            void updateRenderKernelArgs(bool new_gi_check, bool camera_changed, cl_uint seed);
             void updatePostProcessingKernelArgs();
+            void adaptTileSize();
+            void applyTileGrid(glm::ivec2 grid);    /**< Render the following tiles with grid. Sets the launch size and the block arguments if it changed. */
+            FrameSettings currentSettings() const;  /**< Copy the public settings. Called on the GUI thread. */
+            bool renderCPUFrame(bool new_gi_check, bool cap_fps);
             bool saveImage(std::string save_fn, std::string save_ext);
-            void endFrame();
+            bool pollSaves(bool wait);
+            void enqueueReadback(PendingSave save);
+            bool checkpointDue(unsigned long samples);
+            bool saveCheckpoint(GLenum attachment, unsigned long samples);
+            bool resumeCheckpoint(bool new_gi_check);
+            bool writeReport(const std::string& image_fn);
+            void compactActivePixels();
+            void readActiveCount(bool wait);    /**< Trim the tiles of the frame to the active pixel count once it's read back. */
+            void evaluateConvergence();
+            void resetConvergence();
+            bool autoStopDue();         /**< Whether the target error or the time budget was just reached. Sets auto_stop. */
+            bool saveAutoStop();        /**< Save the image and report of an automatically stopped render. */
+            cl_mem enqueueDenoise(std::vector<cl_event>& events);
+            void enqueueLuminanceReduction(cl_mem image, cl_event* event);
+            cl_float whitePoint() const;    /**< White point of the Reinhard operator in exposed units, 1 without auto-exposure. */
+            bool choosePreviewScale(bool was_preview);
+            void bindPreviewImages();
+            void upscalePreview();
+            void countImageTraffic(bool show_cost);
+            void endFrame(const FrameResult& frame);
+            void watchEvent(cl_event event);
+            void uploadCamera();
+
+            /** \brief Set up the frame and enqueue everything before it's tiles. Runs on the submission thread.
+             */
+            bool beginFrame(bool new_gi_check, bool camera_changed);
+
+            /** \brief Enqueue everything after the tiles of the frame, from compositing to the display image, and describe what the GUI
+             *  thread has to do with it. Runs on the submission thread.
+             */
+            void finishFrame(FrameResult& frame);
+
+            /** \brief Take the display image that isn't on screen for the frame being written. A frame in the mailbox that was written
+             *  to it isn't shown anymore, the new one supersedes it. Called on the submission thread.
+             */
+            int claimDisplay();
+
+            void snapshotStats(FrameResult& frame);     /**< Copy the statistics of the submission thread into frame. */
+            bool presentFrame(FrameResult& frame);      /**< Show a frame taken from the mailbox and do the saves that come with it. */
+            void retireDisplayPasses(bool wait);        /**< Collect the timings of display passes that completed. If wait is set, block until all have. */
+            void releaseTileEvents();                   /**< Release the events of the tiles in flight. */
+
+            /** \brief Stop the submission thread at the next frame boundary and wait until it's there. With abort set, tiles of the
+             *  frame in flight that weren't enqueued yet are dropped.
+             *
+             * \return False if a frame is held for the GUI thread. Everything it reads is still in use then.
+             */
+            bool parkSubmission(bool abort);
+            void discardMailbox();      /**< Drop an untaken frame along with a hold on the submission thread. Only while it's parked. */
+
+            void submitLoop();      /**< Body of the submission thread. Renders frames back to back while active and posts them to the mailbox. */
+
+            /** \brief Keep upto tiles_in_flight tiles of the frame queued until all of them have completed. Runs on the submission
+             *  thread and blocks on the oldest tile in between.
+             */
+            void submitTiles();
+            void releaseCameraWrites(int slot);
+
+            /** \brief Enqueue the acquisition of the accumulation images and, if display isn't negative, a display image for OpenCL.
+             *  The acquire waits on the GL fences the GUI thread left in gl_waits.
+             */
+            void acquireGLObjects(bool accumulation, int display);
+            void releaseGLObjects();            /**< Release whatever the submission thread has acquired. */
+
+            /** \brief Let the next acquire wait for the GL commands issued so far. With cl_khr_gl_event a fence behind them becomes
+             *  an event in gl_waits, otherwise GL is finished right away. Called on the GUI thread with submit_mutex held.
+             */
+            void fenceGL();
+            void retireGLSyncs(bool wait);      /**< Delete the GL fences of acquires that have started. If wait is set, block until all have. */
+
+            static void CL_CALLBACK eventCompleted(cl_event event, cl_int status, void* user_data);   /**< Called by the OpenCL runtime from it's own thread when a watched command completes. */
 
             static std::function<void(const std::string&, const std::string&, const std::string&)> setMessageCb;   /**< The function pointer to the RendererGUI message callback function. */
 
             CLManager& cl_manager;       /**< A \ref CLManager object. */
             GlfwManager& glfw_manager;    /**< A \ref GlfwManager object. */
+            ConvergenceEstimator convergence;   /**< Estimates the noise left in the accumulated image. Owned by the submission thread. */
+            ExposureMeter exposure_meter;       /**< Meters the scene luminance for auto-exposure. Owned by the submission thread. */
+            RayCounterSampler ray_counters;     /**< Samples the counters of a program with the ray-counters feature. Owned by the submission thread. */
+            WavefrontStages wf_stages;          /**< Stage kernels of a program with the wavefront feature. Owned by the submission thread. */
+            TileScheduler tile_scheduler;       /**< Order of the tiles and their split between the devices. Owned by the submission thread. */
+            HelperDispatcher helpers;           /**< Renders the tiles given to secondary devices. Owned by the submission thread. */
             std::mt19937 mt_engine;
             std::uniform_int_distribution<unsigned int> dist;
 
-            bool buffer_switch, gi_check, rk_enqueued, ppk_enqueued, do_postproc, render_nextframe;
-            cl_int reset, rk_status, ppk_status;
+            bool buffer_switch, gi_check, do_postproc, render_nextframe;
+            cl_int reset, rk_status;
             cl_uint seed;
-            cl_event rk_event, ppk_event;
-            int curr_block, frame_count;
-            float skip_ticks, sum_mspf, mspf_uncapped_avg;
-            double exec_time_rk, exec_time_ppk, last_time, start_time;
+            std::atomic<bool> gpu_signalled;                    /**< Set when a watched command completes or a frame ends, cleared on every enqueueKernels() call. */
+            std::deque<std::vector<cl_event>> wf_events;        /**< Stage kernels of every tile in rk_events. Empty unless the program is wavefront. */
+            bool wavefront;                                     /**< Whether the loaded rendering program has the wavefront feature. Latched in setup(). */
+            bool persistent;                                    /**< Whether the loaded rendering program has the persistent-threads feature. Latched in setup(). */
+            size_t persistent_gws, persistent_lws;              /**< 1D launch size of persistent-threads kernels. Computed in setup(). */
+            bool ray_counting;                                  /**< Whether the loaded rendering program has the ray-counters feature. Latched in setup(). */
+            bool cost_heatmap;                                  /**< Whether the loaded rendering program has the cost-heatmap feature. Latched in setup(). */
+            bool adaptive_sampling;                             /**< Whether the loaded rendering program has the adaptive-sampling feature. Latched in setup(). */
+            bool feature_buffers;                               /**< Whether the loaded rendering program has the feature-buffers feature. Latched in setup(). */
+            bool temporal;                                      /**< Whether the loaded rendering program has the temporal-reprojection feature. Latched in setup(). */
+            int fused_arg;                                      /**< First argument of the fused-tonemap feature of the rendering kernel, else -1. Latched in setup(). */
+            bool fused_frame;                                   /**< Whether the frame in flight writes the display image instead of being post-processed. */
+            bool builtin_tonemap;                               /**< Whether the post-processing kernel is kernels/post-proc/tonemap.cl, the one the fused tonemap matches. Latched in setup(). */
+            int display_target;                                 /**< Display image the frame in flight is written to, -1 until it's claimed. */
+            std::deque<DisplayPass> display_passes;             /**< Display passes enqueued by the submission thread, oldest first. */
+            std::deque<std::pair<GLsync, cl_event>> gl_syncs;   /**< GL fences and the events made from them that acquires wait on. Owned by the GUI thread. */
+            int depth_switch;                                   /**< Which of the distance buffers holds the distances of the last reset. */
+            bool depth_valid;                                   /**< Whether a reset frame has written the distances since setup(). */
+            bool frame_preview;                                 /**< Whether the frame in flight is rendered into the preview images. */
+            double last_camera_move;                            /**< Time the last frame with a camera change was started. */
+            bool force_reset;                                   /**< Reset the accumulation on the next frame even though nothing changed. */
+            size_t preview_gws[2];                              /**< Global workgroup size of a tile of a preview frame. */
+            int exposure_arg;                                   /**< First argument of the auto-exposure feature of the post-processing kernel, else -1. Latched in setup(). */
+            bool half_images;                                   /**< Whether the denoising and preview images are half floats. Latched in setup(). */
+            cl_event active_count_event;                        /**< Non-blocking read of the active pixel count of the current frame in flight, else NULL. */
+            cl_event compact_event;                             /**< Compaction of the current frame, released along with active_count_event. */
+            cl_int active_count;                                /**< Destination of the active pixel count readback. */
+            double budget_start;                                /**< Time the time budget is counted from. */
+            double last_checkpoint;                             /**< Time the last checkpoint was taken or the renderer was started. */
+            bool resuming;                                      /**< Whether the next frame continues a loaded checkpoint instead of resetting. */
+            std::deque<cl_event> rk_events;                     /**< Tiles enqueued on the primary device that haven't completed yet, oldest first. */
+
+            /* The submission thread owns the OpenCL side of rendering. It renders frames back to back and only stops between two frames,
+             * when it's parked, held for the GUI thread or capped. Members below marked as guarded are shared through submit_mutex. The
+             * GUI thread may touch what the submission thread owns while it's parked or held.
+             */
+            std::thread submit_thread;                          /**< Renders frames back to back, so the device stays busy while the GUI is drawn. */
+            std::mutex submit_mutex;
+            std::condition_variable submit_cv;                  /**< Wakes the submission thread for new inputs and the GUI thread waiting for it to park. */
+            bool submit_active, submit_hold, submit_parked, submit_quit;    /**< Frames are rendered, a frame is held for the GUI thread, the thread waits between frames, the thread should exit. Guarded. */
+            std::atomic<bool> submit_abort;                     /**< Don't enqueue more tiles of the frame in flight. */
+            FrameResult mailbox;                                /**< Latest completed frame not taken by the GUI thread yet. Guarded. */
+            int shown_display;                                  /**< Display image on screen. Written by the GUI thread, guarded. */
+            std::vector<cl_event> gl_waits;                     /**< Events of GL fences the next acquire waits on. Guarded. */
+            Camera input_camera;                                /**< Camera the next frame is rendered with, if input_camera_changed is set. Guarded. */
+            bool input_camera_changed, input_gi_check, input_cap_fps, input_checkpoint, save_requested; /**< Inputs of the next frame. Guarded. */
+            FrameSettings input_settings;                       /**< Settings of the next frame, updated every GUI frame. Guarded. */
+            FrameSettings frame_settings;                       /**< Settings of the frame in flight. Owned by the submission thread. */
+            glm::ivec2 tile_grid;                               /**< Tile grid the block arguments of the rendering kernel were last set to. Adaptive tiles carry it over frames. */
+            Camera frame_camera;                                /**< Camera of the frame in flight. Owned by the submission thread. */
+            bool frame_save, frame_checkpoints;                 /**< Save and checkpoint settings of the frame in flight. */
+            double last_frame_start;                            /**< Time the last frame was started, the frame rate is capped from. */
+            bool accumulation_acquired;                         /**< Whether the accumulation images are acquired for OpenCL. */
+            int display_acquired;                               /**< Display image acquired for OpenCL, else -1. */
+            FrameStats frame_stats;                             /**< Statistics of the submission thread since the last frame was posted. */
+            unsigned long samples_rendered;                     /**< Working copies of the public statistics owned by the submission thread. */
+            StopReason auto_stop;
+            double auto_stop_elapsed;
+            float active_share;
+            int preview_divisor;
+            RayStats frame_ray_stats;
+
+            size_t curr_block;                                  /**< Next entry of frame_blocks to enqueue. */
+            int frame_spp;
+            float skip_ticks, mspf_uncapped_avg;
+            double frame_time_rk, last_time, start_time;
+            FrameStats bench_stats;                             /**< Statistics of the frames taken since the benchmarks were last averaged. */
+            double stop_elapsed;                                /**< Seconds from the last reset until the render was stopped automatically. */
+            int save_display, save_accumulation;                /**< Display and accumulation image of the frame being saved. */
+            bool save_preview;                                  /**< Whether the frame being saved is a preview frame. */
+            bool save_pending;                                  /**< Whether requestSave() was called and the save wasn't done yet. */
+            std::vector<int> frame_blocks;                      /**< Blocks rendered by the primary device in the current frame, in launch order. */
             unsigned int mt_seed;
             Cam cam_data;        /**< A Cam structure containing Camera data for passing to the GPU. A similar structure resides on GPU.*/
+            Cam camera_staging[CLManager::CAMERA_RING_SIZE];    /**< Host copies the camera buffers are written from. They have to outlive the non-blocking writes. */
+            std::vector<cl_event> camera_writes[CLManager::CAMERA_RING_SIZE];  /**< Writes in flight from each staging copy, on every device. */
+            int camera_slot;                                    /**< Slot of the ring the current camera was written to. */
+            bool cpu_frame_pending;                             /**< Whether a frame was started on the CPU backend and not displayed yet. */
+
+            std::deque<PendingSave> pending_saves;              /**< Readbacks in flight, oldest first. */
+            std::vector<GLuint> free_pbos;                      /**< Pixel buffer objects of completed readbacks, reused by the next save. */
+            ImageWriter image_writer;                           /**< Encodes saved images off the render thread. */
+            FramePublisher frame_publisher;                     /**< Shared memory ring the published frames go to. */
+            std::vector<float> publish_pixels;                  /**< Destination of the read of a frame to publish. Owned by the GUI thread while publish_in_flight is set. */
+            std::atomic<bool> publish_in_flight;                /**< Whether a frame to publish is being read or waits to be published. Only one is at a time. */
+            cl_event publish_read;                              /**< Read of publish_pixels taken from the mailbox, else NULL. */
+            cl_ulong publish_read_samples;                      /**< Samples per pixel of the frame in publish_pixels. */
+            int frames_since_publish;                           /**< Frames completed since a frame was last published. */
+            CPURenderer cpu_renderer;                           /**< Host backend. Declared last so it's worker threads are joined before anything they signal is destroyed. */
     };
 }
 #endif // RENDERERCORE_H
@@ -79,9 +79,11 @@ namespace yune
             imgui_addons::ImGuiFileBrowser file_dialog;
 
             char input_fn[256];
+            char checkpoint_input[256];
+            char publish_input[256];
             int benchmark_wheight, bvh_bins, selected_size;
             bool benchmark_shown, scene_info_shown, misc_settings_shown, renderer_start;
-            bool is_fullscreen, update_vertex_buffer, update_mat_buffer, update_image_buffer, update_bvh_buffer, load_bvh, gi_check, cap_fps, do_postproc;
+            bool is_fullscreen, update_vertex_buffer, update_mat_buffer, update_image_buffer, update_bvh_buffer, load_bvh, gi_check, cap_fps, do_postproc, multi_device, cl_available;
     };
 }
 #endif // RENDERERGUI_H
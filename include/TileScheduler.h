@@ -0,0 +1,91 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include "glm/vec2.hpp"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Decides which tiles each device renders and in what order. Tiles are issued in a spiral from the center of the screen
+     *  and split between the devices proportional to the time each one was measured to take per tile.
+     */
+    class TileScheduler
+    {
+        public:
+            TileScheduler();        /**< Default Constructor. */
+
+            /** \brief Forget the measurements and start over with a number of devices. Index 0 is the device sharing the GL context.
+             */
+            void setup(size_t devices);
+
+            void reset();           /**< Forget the measurements and the share of the last schedule. */
+
+            /** \brief Split the tiles of a grid between the devices.
+             *
+             * \param[in] grid      Tile grid of the frame.
+             * \param[out] primary  Tiles of the primary device in launch order. It always gets at least one.
+             * \param[in,out] helpers   Tiles of every secondary device. Sized to the number of secondary devices by the caller.
+             */
+            void schedule(glm::ivec2 grid, std::vector<int>& primary, std::vector<std::vector<int>>& helpers);
+
+            /** \brief Choose a grid whose tiles take roughly a target time on the primary device. The measurements are rescaled to a new grid.
+             *
+             * \param[in] grid          Tile grid of the last frame.
+             * \param[in] ms_per_tile   Average rendering kernel time of a tile of the last frame.
+             * \param[in] target_ms     Time a tile should take.
+             * \param[in] width         Width of the image.
+             * \param[in] height        Height of the image.
+             * \return The new grid, or grid if the tiles are close enough to the target.
+             */
+            glm::ivec2 adaptGrid(glm::ivec2 grid, float ms_per_tile, float target_ms, int width, int height);
+
+            /** \brief Fold the time a device took per tile into it's moving average.
+             */
+            void measure(size_t device, float ms_per_tile);
+
+            const std::vector<float>& getShare() const;     /**< Fraction of the tiles given to each device by the last schedule(). */
+
+            /** \brief Get the pixels a tile covers. Tiles at the right and top edge are clipped to the image, tiles past it are empty.
+             *
+             * \param[in] grid      Tile grid.
+             * \param[in] width     Width of the image.
+             * \param[in] height    Height of the image.
+             * \param[in] block     Index of the tile, row by row.
+             * \param[out] origin   Corner of the tile as an image origin.
+             * \param[out] region   Size of the tile as an image region.
+             */
+            static void getBlockRegion(glm::ivec2 grid, int width, int height, int block, size_t origin[3], size_t region[3]);
+
+        private:
+            std::vector<int> tile_order;        /**< Every tile of the grid in the order they are issued. */
+            glm::ivec2 tile_order_grid;         /**< Grid dimensions tile_order was computed for. */
+            std::vector<float> ms_per_block;    /**< Moving average of the time each device takes to render one tile. */
+            std::vector<float> share;
+    };
+}
+#endif // TILESCHEDULER_H
@@ -0,0 +1,131 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "CL_headers.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** \brief Record the enclosing scope as a host event named name under category cat. Compiles to nothing if YUNE_DISABLE_TRACING is
+ *  defined, otherwise costs a single relaxed atomic load while tracing is off.
+ */
+#ifdef YUNE_DISABLE_TRACING
+    #define YUNE_TRACE_SCOPE(cat, name)
+#else
+    #define YUNE_TRACE_CONCAT_(a, b) a##b
+    #define YUNE_TRACE_CONCAT(a, b) YUNE_TRACE_CONCAT_(a, b)
+    #define YUNE_TRACE_SCOPE(cat, name) yune::Tracer::Scope YUNE_TRACE_CONCAT(trace_scope_, __LINE__)(cat, name)
+#endif
+
+namespace yune
+{
+    /** \brief Records host scopes and OpenCL commands into a fixed size ring buffer and dumps them in the Chrome trace event format,
+     *  which chrome://tracing and Perfetto open. Once the buffer is full the oldest events are overwritten, so a dump always holds
+     *  the latest few seconds.
+     *
+     *  Device timestamps are mapped onto the host clock with an offset measured by calibrate(). Names and categories must be string
+     *  literals or otherwise outlive the trace since only the pointers are stored.
+     */
+    class Tracer
+    {
+        public:
+            /** \brief RAII helper recording the time between it's construction and destruction. Use through YUNE_TRACE_SCOPE. */
+            class Scope
+            {
+                public:
+                    Scope(const char* cat, const char* name);
+                    ~Scope();
+
+                private:
+                    const char* cat;
+                    const char* name;
+                    double start;       /**< Host time in microseconds, negative if tracing was off when the scope was entered. */
+            };
+
+            /** \brief Start or stop recording. Starting clears the events of the previous recording and invalidates the device clock offset.
+             *
+             * \param[in] enable    Whether to record events.
+             * \param[in] capacity  Number of events kept in the ring buffer.
+             */
+            static void setEnabled(bool enable, size_t capacity = 65536);
+
+            static bool isEnabled()             /**< Whether events are being recorded. */
+            {
+                return enabled.load(std::memory_order_relaxed);
+            }
+
+            static bool isCalibrated();         /**< Whether the device clock offset was measured since recording started. */
+
+            /** \brief Measure the offset between the device and the host clock. Enqueues a marker and blocks until it completes.
+             *
+             * \param[in] queue     A command queue with profiling enabled.
+             */
+            static void calibrate(cl_command_queue queue);
+
+            /** \brief Record a completed OpenCL command from it's profiling timestamps. Does nothing if tracing is off or the clock offset
+             *  hasn't been measured yet.
+             *
+             * \param[in] cat       Category of the event.
+             * \param[in] name      Name of the event.
+             * \param[in] event     A completed event of a queue with profiling enabled.
+             */
+            static void deviceEvent(const char* cat, const char* name, cl_event event);
+
+            /** \brief Write the recorded events to a Chrome trace JSON file.
+             *
+             * \param[in] filename      Path of the file to write.
+             * \param[in] device_name   Name shown for the device track.
+             * \return True if the file was written.
+             */
+            static bool dump(const std::string& filename, const std::string& device_name);
+
+            static double now();                /**< Host time in microseconds since the first call. */
+
+        private:
+            struct Event
+            {
+                const char* cat;
+                const char* name;
+                double start, duration;     /**< Microseconds on the host clock. */
+                int pid;                    /**< 1 for host scopes, 2 for device commands. */
+                size_t tid;                 /**< Hashed host thread id or 0 for the device queue. */
+            };
+
+            static void record(const char* cat, const char* name, double start, double duration, int pid);
+
+            static std::atomic<bool> enabled;
+            static std::mutex mutex;
+            static std::vector<Event> events;   /**< Ring buffer of recorded events. */
+            static size_t next_event;           /**< Total number of events recorded. The oldest one lives at next_event % capacity. */
+            static double device_offset;        /**< Host time in microseconds minus device time, once calibrated. */
+            static bool calibrated;
+    };
+}
+#endif // TRACER_H
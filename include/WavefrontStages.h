@@ -0,0 +1,78 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef WAVEFRONTSTAGES_H
+#define WAVEFRONTSTAGES_H
+
+#include "CLManager.h"
+#include "Scene.h"
+#include "glm/vec2.hpp"
+#include <vector>
+
+namespace yune
+{
+    /** \brief Drives the stage kernels of a rendering program with the wavefront feature. The paths of a tile are generated, then
+     *  extended, shaded and connected once per bounce through queues on the device, before the rendering kernel accumulates them.
+     *  Queue lengths are read back without waiting and size the stage launches of later tiles.
+     */
+    class WavefrontStages
+    {
+        public:
+            WavefrontStages(CLManager& cl_manager);     /**< Default Constructor. */
+
+            /** \brief Set up the path and queue buffers and the arguments of the stage kernels for a frame. Also passes the paths to
+             *  the rendering kernel.
+             *
+             * \param[in] scene         Scene whose buffers are loaded.
+             * \param[in] width         Width of the image.
+             * \param[in] height        Height of the image.
+             * \param[in] blocks        Tile grid of the frame.
+             * \param[in] gws           Global workgroup size of a tile. There is one path per work item.
+             * \param[in] max_bounces   Bounces traced per path, at least 1.
+             * \param[in] gi_check      Whether indirect lighting is traced.
+             * \param[in] seed          Seed of the frame.
+             * \return False if the buffers couldn't be created.
+             */
+            bool setup(const Scene& scene, int width, int height, glm::ivec2 blocks, const size_t gws[2], int max_bounces, bool gi_check, cl_uint seed);
+
+            /** \brief Enqueue the stage kernels of a tile.
+             *
+             * \param[in] block     Tile to trace.
+             * \param[in] gws       Global workgroup size of the tile.
+             * \param[in] lws       Local workgroup size, or 0 to let the runtime choose.
+             * \param[out] events   Events of the stage kernels are appended in launch order.
+             */
+            void enqueue(cl_int block, const size_t gws[2], const size_t lws[2], std::vector<cl_event>& events);
+
+            void release();         /**< Drop a readback in flight without waiting and forget the queue lengths. Only once the queue is finished. */
+
+        private:
+            CLManager& cl_manager;
+            std::vector<cl_uint> queue_counts;      /**< Destination of the read of a tile's queue lengths. */
+            std::vector<cl_uint> queue_estimate;    /**< Queue lengths of the last tile read back. The stage launches are sized from them. */
+            cl_event count_event;                   /**< Read of queue_counts in flight, else NULL. */
+    };
+}
+#endif // WAVEFRONTSTAGES_H
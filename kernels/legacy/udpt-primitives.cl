@@ -1,4 +1,5 @@
 #yune-preproc kernel-name pathtracer
+#yune-preproc feature spp-per-launch
 
 #define PI              3.14159265359f
 #define INV_PI          0.31830988618f
@@ -278,8 +279,16 @@ bool sampleGlossyPdf(HitInfo hit, uint* seed, float* prob);
 
 __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d_t inputImage, __constant Camera* main_cam, 
                          int scene_size, __global Triangle* vert_data, __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh,
-                         int GI_CHECK, int reset, uint rand, int block, int block_x, int block_y)
+                         int GI_CHECK, int reset, uint rand, int block, int block_x, int block_y
+#ifdef YUNE_SPP_PER_LAUNCH
+                         , int spp_per_launch
+#endif
+                         )
 {
+#ifndef YUNE_SPP_PER_LAUNCH
+    const int spp_per_launch = 1;
+#endif
+
     int img_width = get_image_width(outputImage);
     int img_height = get_image_height(outputImage);
     int2 pixel = (int2)(get_global_id(0), get_global_id(1));
@@ -301,22 +310,29 @@ __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d
         seed = wang_hash(seed);    
     
     float4 color = (float4) (0.f, 0.f, 0.f, 1.f);
+    float4 sum = (float4) (0.f, 0.f, 0.f, 0.f);
     
-    seed = xor_shift(seed);
-    r1 = seed / (float) UINT_MAX;
-    seed =  xor_shift(seed);
-    r2 =  seed / (float) UINT_MAX;
-    
-    createRay(pixel.x + r1, pixel.y + r2, img_width, img_height, &eye_ray, main_cam);
-    
-    color = shading(eye_ray, light_ray, GI_CHECK, &seed);
-    
-    if(any(isnan(color)))
-            color = PINK;
+    //Accumulate all samples of this launch in registers and touch the accumulation image only once.
+    for(int s = 0; s < spp_per_launch; s++)
+    {
+        seed = xor_shift(seed);
+        r1 = seed / (float) UINT_MAX;
+        seed =  xor_shift(seed);
+        r2 =  seed / (float) UINT_MAX;
+        
+        createRay(pixel.x + r1, pixel.y + r2, img_width, img_height, &eye_ray, main_cam);
+        
+        color = shading(eye_ray, light_ray, GI_CHECK, &seed);
+        
+        if(any(isnan(color)))
+                color = PINK;
+        sum += color;
+    }
+    color = sum / spp_per_launch;
         
     if ( reset == 1 )
     {   
-        color.w = 1;
+        color.w = spp_per_launch;
         write_imagef(outputImage, pixel, color);
     }
     else
@@ -324,9 +340,9 @@ __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d
         float4 prev_color = read_imagef(inputImage, sampler, pixel);
         int num_passes = prev_color.w;
 
-        color += (prev_color * num_passes);
-        color /= (num_passes + 1);
-        color.w = num_passes + 1;
+        color = (color * spp_per_launch) + (prev_color * num_passes);
+        color /= (num_passes + spp_per_launch);
+        color.w = num_passes + spp_per_launch;
         write_imagef(outputImage, pixel, color);    
     }
 }
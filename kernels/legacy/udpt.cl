@@ -1,4 +1,12 @@
 #yune-preproc kernel-name pathtracer
+#yune-preproc feature spp-per-launch
+#yune-preproc feature persistent-threads
+#yune-preproc feature ray-counters
+#yune-preproc feature cost-heatmap
+#yune-preproc feature adaptive-sampling
+#yune-preproc feature feature-buffers
+#yune-preproc feature temporal-reprojection
+#yune-preproc feature fused-tonemap
 
 #define PI              3.14159265359f
 #define INV_PI          0.31830988618f
@@ -6,8 +14,22 @@
 #define RR_THRESHOLD    6
 #define LIGHT_SIZE      1
 #define HEAP_SIZE       1500
+#define PATH_LENGTH_BINS 16
+#define FAR_DEPTH       1e10f
+#define DISOCCLUSION_TOLERANCE 0.05f    // Relative first-hit distance difference beyond which reprojected history is rejected.
 //#define MIS
 
+// The host widens the ray counters to 64 bits if the device has 64 bit atomics. 32 bit counters may wrap within a frame,
+// so the host then reads and clears them after every tile and sums them up.
+#ifdef YUNE_RAY_COUNTERS_64
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+typedef ulong counter_t;
+#define COUNTER_ADD(counter, value) atom_add(counter, (ulong) (value))
+#else
+typedef uint counter_t;
+#define COUNTER_ADD(counter, value) atomic_add(counter, value)
+#endif
+
 typedef struct Mat4x4{
     float4 r1;
     float4 r2;
@@ -90,6 +112,16 @@ typedef struct Camera{
     float pad[3];           // 12 bytes padding to reach 80 (next multiple of 16)
 } Camera;
 
+//Per work-item tallies. Only flushed to the global counters if the ray-counters feature is enabled, otherwise they are optimized out.
+typedef struct RayStats{
+    uint rays;
+    uint nodes_visited;
+    uint triangle_tests;
+    uint shadow_rays;
+    uint path_length;                       // Segments of the current camera path, excluding shadow rays.
+    uint path_length_hist[PATH_LENGTH_BINS];
+} RayStats;
+
 __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
                            CLK_ADDRESS_CLAMP_TO_EDGE   |
                            CLK_FILTER_NEAREST;
@@ -110,10 +142,13 @@ __constant float4 BACKGROUND_COLOR =(float4) (0.4f, 0.4f, 0.4f, 1.0f);
 __constant float4 PINK = (float4) (0.988f, 0.0588f, 0.7529f, 1.0f);
 
 //Core Functions
+float2 renderPixel(int2 pixel, __write_only image2d_t outputImage, __read_only image2d_t inputImage, __constant Camera* main_cam,
+                   int scene_size, __global Triangle* scene_data, __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh,
+                   int GI_CHECK, int reset, uint rand, int spp_per_launch, float4 history, RayStats* stats, float4* accum);
 void createRay(float pixel_x, float pixel_y, int img_width, int img_height, Ray* eye_ray, constant Camera* main_cam);
-bool traceRay(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data);
-float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data);
-float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data);
+bool traceRay(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data, RayStats* stats);
+float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data, RayStats* stats);
+float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data, RayStats* stats);
 float4 evaluateBRDF(float4 w_i, float4 w_o, HitInfo hit_info, bool sample_glossy, float rr_prob, __global Triangle* scene_data, __global Material* mat_data );
 int sampleLights(HitInfo hit_info, float* light_pdf, float4* w_i, uint* seed);
 float4 reflect(float4 w_i, HitInfo hit_info);
@@ -122,7 +157,7 @@ float evalFresnelReflectance(float4 w_i, HitInfo hit_info, float* ior_factor, __
 
 //Intersection Routiens
 bool rayAabbIntersection(Ray* ray, AABB bb);
-bool traverseBVH(Ray* ray, HitInfo* hit_info, int bvh_size, __global BVHNodeGPU* bvh, __global Triangle* scene_data);
+bool traverseBVH(Ray* ray, HitInfo* hit_info, int bvh_size, __global BVHNodeGPU* bvh, __global Triangle* scene_data, RayStats* stats);
 bool rayTriangleIntersection(Ray* ray, HitInfo* hit, __global Triangle* scene_data, int idx);
 
 //Sampling Hemisphere Functions
@@ -143,6 +178,27 @@ uint wang_hash(uint seed);
 uint xor_shift(uint seed);
 void powerHeuristic(float* weight, float light_pdf, float brdf_pdf, int beta);
 bool sampleGlossyPdf(HitInfo hit, __global Triangle* scene_data, __global Material* mat_data, uint* seed, float* prob);
+#ifdef YUNE_RAY_COUNTERS
+void flushRayStats(RayStats* stats, __global volatile counter_t* ray_counters);
+#endif
+#ifdef YUNE_COST_HEATMAP
+void writeCost(__write_only image2d_t cost_image, int2 pixel, RayStats* stats, uint4 start, int spp_per_launch);
+#endif
+#ifdef YUNE_ADAPTIVE_SAMPLING
+void updateMoments(__global float4* moments, int2 pixel, int img_width, float2 lum_sum, int reset, int spp_per_launch);
+#endif
+#ifdef YUNE_FEATURE_BUFFERS
+void writeFeatures(int2 pixel, int img_width, int img_height, __constant Camera* main_cam, int scene_size, __global Triangle* scene_data,
+                   __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh, __global float4* albedo, __global float4* normal_depth);
+#endif
+#ifdef YUNE_TEMPORAL_REPROJECTION
+float4 reprojectHistory(int2 pixel, int img_width, int img_height, __read_only image2d_t inputImage, __constant Camera* main_cam,
+                        __constant Camera* prev_cam, __global const float* prev_depth, __global float* depth, int reproject, int max_history,
+                        int scene_size, __global Triangle* scene_data, int bvh_size, __global BVHNodeGPU* bvh);
+#endif
+#ifdef YUNE_FUSED_TONEMAP
+void writeDisplay(__write_only image2d_t display_image, int2 pixel, float4 color, float lum_white);
+#endif
 
 
 /* Throught out the code, we use w_o as the inverse of the direction vector that hits the current surface. This points
@@ -157,18 +213,157 @@ bool sampleGlossyPdf(HitInfo hit, __global Triangle* scene_data, __global Materi
 
 __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d_t inputImage, __constant Camera* main_cam, 
                          int scene_size, __global Triangle* scene_data, __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh,
-                         int GI_CHECK, int reset, uint rand, int block, int block_x, int block_y)
+                         int GI_CHECK, int reset, uint rand, int block, int block_x, int block_y
+#ifdef YUNE_SPP_PER_LAUNCH
+                         , int spp_per_launch
+#endif
+#ifdef YUNE_PERSISTENT_THREADS
+                         , __global volatile int* work_counter
+#endif
+#ifdef YUNE_RAY_COUNTERS
+                         , __global volatile counter_t* ray_counters
+#endif
+#ifdef YUNE_COST_HEATMAP
+                         , __write_only image2d_t cost_image
+#endif
+#ifdef YUNE_ADAPTIVE_SAMPLING
+                         , __global float4* moments, __global const int* active_pixels, __global const int* active_count
+#endif
+#ifdef YUNE_FEATURE_BUFFERS
+                         , __global float4* albedo, __global float4* normal_depth, int write_features
+#endif
+#ifdef YUNE_TEMPORAL_REPROJECTION
+                         , __constant Camera* prev_cam, __global const float* prev_depth, __global float* depth, int reproject, int max_history
+#endif
+#ifdef YUNE_FUSED_TONEMAP
+                         , __write_only image2d_t display_image, int write_display, float lum_white
+#endif
+                         )
 {
+#ifndef YUNE_SPP_PER_LAUNCH
+    const int spp_per_launch = 1;
+#endif
+    RayStats stats = {0};
+
     int img_width = get_image_width(outputImage);
     int img_height = get_image_height(outputImage);
-    int2 pixel = (int2)(get_global_id(0), get_global_id(1));
-    
-    pixel.x += ceil((float)img_width / block_x) * (block % block_x);
-    pixel.y += ceil((float)img_height / block_y) * (block / block_x);
+    int tile_width = ceil((float)img_width / block_x);
+    int tile_height = ceil((float)img_height / block_y);
+    int2 tile_origin = (int2)(tile_width * (block % block_x), tile_height * (block / block_x));
+    int tile_pixels = tile_width * tile_height;
+    
+#ifdef YUNE_ADAPTIVE_SAMPLING
+    // Tiles are consecutive ranges of the list of pixels that haven't converged yet instead of rectangles of the image.
+    int list_start = block * tile_pixels;
+    tile_pixels = clamp(*active_count - list_start, 0, tile_pixels);
+#endif
+    
+#ifdef YUNE_PERSISTENT_THREADS
+    /* Only enough work-groups to fill the device are launched. Each one takes the next batch of pixels of the tile from a global counter
+     * until none are left, so groups stuck with long paths don't hold back the others. The batch start is shared through local memory
+     * so every work-item leaves the loop together and the barriers stay uniform.
+     */
+    __local int batch_start;
+    while(true)
+    {
+        if(get_local_id(0) == 0)
+            batch_start = atomic_add(work_counter, (int) get_local_size(0));
+        barrier(CLK_LOCAL_MEM_FENCE);
+        int start = batch_start;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if(start >= tile_pixels)
+            break;
+        
+        int idx = start + get_local_id(0);
+#ifdef YUNE_ADAPTIVE_SAMPLING
+        int p = idx < tile_pixels ? active_pixels[list_start + idx] : 0;
+        int2 pixel = (int2)(p % img_width, p / img_width);
+#else
+        int2 pixel = tile_origin + (int2)(idx % tile_width, idx / tile_width);
+#endif
+        if(idx < tile_pixels && pixel.x < img_width && pixel.y < img_height)
+        {
+#ifdef YUNE_COST_HEATMAP
+            uint4 cost_start = (uint4)(stats.nodes_visited, stats.triangle_tests, stats.rays, 0);
+#endif
+            float4 history = (float4)(0.f);
+#ifdef YUNE_TEMPORAL_REPROJECTION
+            if(reset == 1)
+                history = reprojectHistory(pixel, img_width, img_height, inputImage, main_cam, prev_cam, prev_depth, depth, reproject, max_history,
+                                           scene_size, scene_data, bvh_size, bvh);
+#endif
+            float4 accum;
+            float2 lum_sum = renderPixel(pixel, outputImage, inputImage, main_cam, scene_size, scene_data, mat_data, bvh_size, bvh, GI_CHECK, reset, rand, spp_per_launch, history, &stats, &accum);
+#ifdef YUNE_FUSED_TONEMAP
+            if(write_display == 1)
+                writeDisplay(display_image, pixel, accum, lum_white);
+#endif
+#ifdef YUNE_COST_HEATMAP
+            writeCost(cost_image, pixel, &stats, cost_start, spp_per_launch);
+#endif
+#ifdef YUNE_ADAPTIVE_SAMPLING
+            updateMoments(moments, pixel, img_width, lum_sum, reset, spp_per_launch);
+#endif
+#ifdef YUNE_FEATURE_BUFFERS
+            if(write_features == 1)
+                writeFeatures(pixel, img_width, img_height, main_cam, scene_size, scene_data, mat_data, bvh_size, bvh, albedo, normal_depth);
+#endif
+        }
+    }
+#else
+#ifdef YUNE_ADAPTIVE_SAMPLING
+    int idx = get_global_id(1) * tile_width + get_global_id(0);
+    if(get_global_id(0) >= tile_width || idx >= tile_pixels)
+        return;
+    int p = active_pixels[list_start + idx];
+    int2 pixel = (int2)(p % img_width, p / img_width);
+#else
+    int2 pixel = tile_origin + (int2)(get_global_id(0), get_global_id(1));
+#endif
     
     if (pixel.x >= img_width || pixel.y >= img_height)
         return;
     
+    float4 history = (float4)(0.f);
+#ifdef YUNE_TEMPORAL_REPROJECTION
+    if(reset == 1)
+        history = reprojectHistory(pixel, img_width, img_height, inputImage, main_cam, prev_cam, prev_depth, depth, reproject, max_history,
+                                   scene_size, scene_data, bvh_size, bvh);
+#endif
+    float4 accum;
+    float2 lum_sum = renderPixel(pixel, outputImage, inputImage, main_cam, scene_size, scene_data, mat_data, bvh_size, bvh, GI_CHECK, reset, rand, spp_per_launch, history, &stats, &accum);
+#ifdef YUNE_FUSED_TONEMAP
+    if(write_display == 1)
+        writeDisplay(display_image, pixel, accum, lum_white);
+#endif
+#ifdef YUNE_COST_HEATMAP
+    writeCost(cost_image, pixel, &stats, (uint4)(0), spp_per_launch);
+#endif
+#ifdef YUNE_ADAPTIVE_SAMPLING
+    updateMoments(moments, pixel, img_width, lum_sum, reset, spp_per_launch);
+#endif
+#ifdef YUNE_FEATURE_BUFFERS
+    if(write_features == 1)
+        writeFeatures(pixel, img_width, img_height, main_cam, scene_size, scene_data, mat_data, bvh_size, bvh, albedo, normal_depth);
+#endif
+#endif
+
+#ifdef YUNE_RAY_COUNTERS
+    flushRayStats(&stats, ray_counters);
+#endif
+}
+
+/* Returns the sum of the luminance and of the squared luminance of the samples taken. On reset the samples are blended with history,
+ * whose alpha holds the number of samples it's worth, instead of the accumulated image. A history worth 0 samples is ignored.
+ * The new accumulated color is also stored in accum.
+ */
+float2 renderPixel(int2 pixel, __write_only image2d_t outputImage, __read_only image2d_t inputImage, __constant Camera* main_cam,
+                   int scene_size, __global Triangle* scene_data, __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh,
+                   int GI_CHECK, int reset, uint rand, int spp_per_launch, float4 history, RayStats* stats, float4* accum)
+{
+    int img_width = get_image_width(outputImage);
+    int img_height = get_image_height(outputImage);
+    
     //create a camera ray and light ray
     Ray eye_ray, light_ray;
     float r1, r2;
@@ -180,22 +375,38 @@ __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d
         seed = wang_hash(seed);    
     
     float4 color = (float4) (0.f, 0.f, 0.f, 1.f);
+    float4 sum = (float4) (0.f, 0.f, 0.f, 0.f);
+    float2 lum_sum = (float2) (0.f, 0.f);
     
-    seed = xor_shift(seed);
-    r1 = seed / (float) UINT_MAX;
-    seed =  xor_shift(seed);
-    r2 =  seed / (float) UINT_MAX;
-    
-    createRay(pixel.x + r1, pixel.y + r2, img_width, img_height, &eye_ray, main_cam);
-    
-    color = shading(eye_ray, light_ray, GI_CHECK ,&seed, bvh_size, bvh, scene_size, scene_data, mat_data);
-    
-    if(any(isnan(color)))
-            color = PINK;
+    //Accumulate all samples of this launch in registers and touch the accumulation image only once.
+    for(int s = 0; s < spp_per_launch; s++)
+    {
+        seed = xor_shift(seed);
+        r1 = seed / (float) UINT_MAX;
+        seed =  xor_shift(seed);
+        r2 =  seed / (float) UINT_MAX;
+        
+        createRay(pixel.x + r1, pixel.y + r2, img_width, img_height, &eye_ray, main_cam);
+        
+        color = shading(eye_ray, light_ray, GI_CHECK ,&seed, bvh_size, bvh, scene_size, scene_data, mat_data, stats);
+#ifdef YUNE_RAY_COUNTERS
+        stats->path_length_hist[min(stats->path_length, (uint) PATH_LENGTH_BINS - 1)]++;
+#endif
+        
+        if(any(isnan(color)))
+                color = PINK;
+        sum += color;
+        
+        float lum = getYluminance(color);
+        lum_sum += (float2)(lum, lum * lum);
+    }
+    color = sum / spp_per_launch;
         
     if ( reset == 1 )
     {   
-        color.w = 1;
+        color = (color * spp_per_launch) + (history * history.w);
+        color /= (history.w + spp_per_launch);
+        color.w = history.w + spp_per_launch;
         write_imagef(outputImage, pixel, color);
     }
     else
@@ -203,11 +414,13 @@ __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d
         float4 prev_color = read_imagef(inputImage, sampler, pixel);
         int num_passes = prev_color.w;
 
-        color += (prev_color * num_passes);
-        color /= (num_passes + 1);
-        color.w = num_passes + 1;
+        color = (color * spp_per_launch) + (prev_color * num_passes);
+        color /= (num_passes + spp_per_launch);
+        color.w = num_passes + spp_per_launch;
         write_imagef(outputImage, pixel, color);    
     }
+    *accum = color;
+    return lum_sum;
 }
 
 void createRay(float pixel_x, float pixel_y, int img_width, int img_height, Ray* eye_ray, constant Camera* main_cam)
@@ -237,9 +450,12 @@ void createRay(float pixel_x, float pixel_y, int img_width, int img_height, Ray*
     eye_ray->length = INFINITY;                             
 }
 
-bool traceRay(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data)
+bool traceRay(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data, RayStats* stats)
 {
     bool flag = false;
+    stats->rays++;
+    if(ray->is_shadow_ray)
+        stats->shadow_rays++;
     
     for(int i = 0; i < LIGHT_SIZE; i++)
     {       
@@ -276,16 +492,17 @@ bool traceRay(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, in
     }
     //Traverse BVH if present, else brute force intersect all triangles...
     if(bvh_size > 0)
-        flag |= traverseBVH(ray, hit, bvh_size, bvh, scene_data);
+        flag |= traverseBVH(ray, hit, bvh_size, bvh, scene_data, stats);
     else
     {
         for (int i =0 ; i < scene_size; i++)
             flag |= rayTriangleIntersection(ray, hit, scene_data, i);       
+        stats->triangle_tests += scene_size;
     }
     return flag;
 }
 
-bool traverseBVH(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, __global Triangle* scene_data)
+bool traverseBVH(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh, __global Triangle* scene_data, RayStats* stats)
 {
     int candidate_list[HEAP_SIZE];    
     candidate_list[0] = 0;
@@ -297,11 +514,13 @@ bool traverseBVH(Ray* ray, HitInfo* hit, int bvh_size, __global BVHNodeGPU* bvh,
     
     for(int i = 0; i < len && len < HEAP_SIZE; i++)
     {        
+        stats->nodes_visited++;
         float c_idx = bvh[candidate_list[i]].child_idx;
         if(c_idx == -1 && bvh[candidate_list[i]].vert_len > 0)
         {
             for(int j = 0; j < bvh[candidate_list[i]].vert_len; j++)
             {
+                stats->triangle_tests++;
                 intersect |= rayTriangleIntersection(ray, hit, scene_data, bvh[candidate_list[i]].vert_list[j]);
                 //If shadow ray don't need to compute further intersections...
                 if(ray->is_shadow_ray && intersect)
@@ -430,11 +649,12 @@ bool rayAabbIntersection(Ray* ray, AABB bb)
     return (t_max > fmax(t_min, 0.0f));
 }
 
-float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data, __global Material* mat_data)
+float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data, __global Material* mat_data, RayStats* stats)
 {   
     HitInfo hit_info = {-1, -1, (float4)(0,0,0,1), (float4)(0,0,0,0)};
 
-    if(!traceRay(&ray, &hit_info, bvh_size, bvh, scene_size, scene_data))
+    stats->path_length = 1;
+    if(!traceRay(&ray, &hit_info, bvh_size, bvh, scene_size, scene_data, stats))
         return BACKGROUND_COLOR;
     
     if(hit_info.light_ID >= 0)
@@ -452,7 +672,7 @@ float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, _
     // Compute Direct Illumination at the first hitpoint.
     int matID = scene_data[hit_info.triangle_ID].matID;
     if(!mat_data[matID].is_specular)
-        direct_color =  evaluateDirectLighting(-ray.dir, hit_info, seed, bvh_size, bvh, scene_size, scene_data, mat_data);
+        direct_color =  evaluateDirectLighting(-ray.dir, hit_info, seed, bvh_size, bvh, scene_size, scene_data, mat_data, stats);
     
     //Compute Indirect Illumination bouncing rays around.
     if(GI_CHECK)
@@ -485,7 +705,9 @@ float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, _
             // Note that in normal path tracing we would have skipped an iteration upon hitting a light source. But in Progressive path tracing
             // we return i.e. we ignore the sample completely since we are taking samples continuously.
             // Also Account for the light source if the object hit is specular.
-            if(pdf <= 0.0f || !traceRay(&new_ray, &new_hitinfo, bvh_size, bvh, scene_size, scene_data) || new_hitinfo.light_ID >= 0)
+            if(pdf > 0.0f)
+                stats->path_length++;
+            if(pdf <= 0.0f || !traceRay(&new_ray, &new_hitinfo, bvh_size, bvh, scene_size, scene_data, stats) || new_hitinfo.light_ID >= 0)
             {
                 if(mat_data[matID].is_specular && new_hitinfo.light_ID >= 0)
                 {
@@ -524,7 +746,7 @@ float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, _
             
             matID = scene_data[new_hitinfo.triangle_ID].matID;
             if(!mat_data[matID].is_specular)
-                indirect_color +=  throughput * evaluateDirectLighting(-new_ray.dir, new_hitinfo, seed, bvh_size, bvh, scene_size, scene_data, mat_data);
+                indirect_color +=  throughput * evaluateDirectLighting(-new_ray.dir, new_hitinfo, seed, bvh_size, bvh, scene_size, scene_data, mat_data, stats);
             hit_info = new_hitinfo;
             ray = new_ray;            
         }
@@ -532,7 +754,7 @@ float4 shading(Ray ray, Ray light_ray, int GI_CHECK, uint* seed, int bvh_size, _
     return direct_color + indirect_color;
 }
 
-float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data)
+float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size, __global BVHNodeGPU* bvh, int scene_size, __global Triangle* scene_data,  __global Material* mat_data, RayStats* stats)
 {
     float4 emission = mat_data[scene_data[hit.triangle_ID].matID].ke;
     float4 light_sample = (float4) (0.f, 0.f, 0.f, 0.f);
@@ -554,7 +776,7 @@ float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size,
     
     //Direct Light Sampling     
 	//If ray doesn't hit anything (exclude light source j while intersection check). This means light source j visible.
-    if(!traceRay(&shadow_ray, &shadow_hitinfo, bvh_size, bvh, scene_size, scene_data))
+    if(!traceRay(&shadow_ray, &shadow_hitinfo, bvh_size, bvh, scene_size, scene_data, stats))
     {
         sample_glossy = sampleGlossyPdf(hit, scene_data, mat_data, seed, &brdf_prob);
         if(brdf_prob == 0.0f)
@@ -596,7 +818,7 @@ float4 evaluateDirectLighting(float4 w_o, HitInfo hit, uint* seed, int bvh_size,
     HitInfo new_hitinfo = {-1, -1, (float4)(0,0,0,1), (float4)(0,0,0,0)};   
     
     //If traceRay doesnt hit anything or if it does not hit the same light source return only light sample.
-    if(!traceRay(&brdf_sample_ray, &new_hitinfo, bvh_size, bvh, scene_size, scene_data) || new_hitinfo.light_ID != j)
+    if(!traceRay(&brdf_sample_ray, &new_hitinfo, bvh_size, bvh, scene_size, scene_data, stats) || new_hitinfo.light_ID != j)
        return light_sample + emission;
     
     mis_weight = brdf_pdf;
@@ -1149,4 +1371,133 @@ uint xor_shift(uint seed)
 void powerHeuristic(float* weight, float pdf1, float pdf2, int beta)
 {
     *weight = (pown(*weight, beta)) / (pown(pdf1, beta) + pown(pdf2, beta) );  
-}
\ No newline at end of file
+}
+
+#ifdef YUNE_RAY_COUNTERS
+//One atomic per counter and work-item. Slots follow the layout documented in template/kernel.cl.
+void flushRayStats(RayStats* stats, __global volatile counter_t* ray_counters)
+{
+    COUNTER_ADD(&ray_counters[0], stats->rays);
+    COUNTER_ADD(&ray_counters[1], stats->nodes_visited);
+    COUNTER_ADD(&ray_counters[2], stats->triangle_tests);
+    COUNTER_ADD(&ray_counters[3], stats->shadow_rays);
+    for(int i = 0; i < PATH_LENGTH_BINS; i++)
+    {
+        if(stats->path_length_hist[i] > 0)
+            COUNTER_ADD(&ray_counters[4 + i], stats->path_length_hist[i]);
+    }
+}
+#endif
+
+#ifdef YUNE_COST_HEATMAP
+//Cost of the pixel per sample taken in this launch: BVH nodes visited, ray-triangle tests and rays traced.
+void writeCost(__write_only image2d_t cost_image, int2 pixel, RayStats* stats, uint4 start, int spp_per_launch)
+{
+    uint4 end = (uint4)(stats->nodes_visited, stats->triangle_tests, stats->rays, 0);
+    write_imagef(cost_image, pixel, convert_float4(end - start) / spp_per_launch);
+}
+#endif
+
+#ifdef YUNE_ADAPTIVE_SAMPLING
+//Running means of the luminance and squared luminance of a pixel. z holds the number of samples they are taken over.
+void updateMoments(__global float4* moments, int2 pixel, int img_width, float2 lum_sum, int reset, int spp_per_launch)
+{
+    int i = pixel.y * img_width + pixel.x;
+    float4 m = reset == 1 ? (float4)(0.f) : moments[i];
+    float n = m.z + spp_per_launch;
+    m.xy = (m.xy * m.z + lum_sum) / n;
+    m.z = n;
+    moments[i] = m;
+}
+#endif
+
+#ifdef YUNE_FEATURE_BUFFERS
+/* First hit of a ray through the pixel center. It doesn't change until the camera does, so it's only traced on reset and isn't counted
+ * in the ray statistics. Misses and lights get a white albedo, a normal facing the camera and a depth far behind the scene.
+ */
+void writeFeatures(int2 pixel, int img_width, int img_height, __constant Camera* main_cam, int scene_size, __global Triangle* scene_data,
+                   __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh, __global float4* albedo, __global float4* normal_depth)
+{
+    Ray ray;
+    HitInfo hit = {-1, -1, (float4)(0,0,0,1), (float4)(0,0,0,0)};
+    RayStats stats = {0};
+    float4 kd = (float4)(1.f, 1.f, 1.f, 1.f);
+    float4 nd = (float4)(0.f, 0.f, 0.f, FAR_DEPTH);
+    
+    createRay(pixel.x + 0.5f, pixel.y + 0.5f, img_width, img_height, &ray, main_cam);
+    nd.xyz = -ray.dir.xyz;
+    if(traceRay(&ray, &hit, bvh_size, bvh, scene_size, scene_data, &stats) && hit.light_ID < 0)
+    {
+        kd = mat_data[scene_data[hit.triangle_ID].matID].kd;
+        nd = (float4)(hit.normal.xyz, length(hit.hit_point.xyz - ray.origin.xyz));
+    }
+    
+    int i = pixel.y * img_width + pixel.x;
+    albedo[i] = (float4)(kd.xyz, 1.f);
+    normal_depth[i] = nd;
+}
+#endif
+
+#ifdef YUNE_TEMPORAL_REPROJECTION
+/* Traces the pixel center to store it's first-hit distance for the next camera move, then projects the hit point into the previous
+ * camera. The accumulated color there is returned as history, unless the distance stored for that pixel differs from the distance to
+ * the hit by more than DISOCCLUSION_TOLERANCE of the shorter one, which means something else was in front of it (a disocclusion). The sample count of the history is capped at max_history, so over a sequence of moves the image is an
+ * exponential moving average with a weight of about 1 / (max_history + 1) for the newest samples.
+ */
+float4 reprojectHistory(int2 pixel, int img_width, int img_height, __read_only image2d_t inputImage, __constant Camera* main_cam,
+                        __constant Camera* prev_cam, __global const float* prev_depth, __global float* depth, int reproject, int max_history,
+                        int scene_size, __global Triangle* scene_data, int bvh_size, __global BVHNodeGPU* bvh)
+{
+    Ray ray;
+    HitInfo hit = {-1, -1, (float4)(0,0,0,1), (float4)(0,0,0,0)};
+    RayStats stats = {0};
+    
+    createRay(pixel.x + 0.5f, pixel.y + 0.5f, img_width, img_height, &ray, main_cam);
+    float d = FAR_DEPTH;
+    if(traceRay(&ray, &hit, bvh_size, bvh, scene_size, scene_data, &stats))
+        d = length(hit.hit_point.xyz - ray.origin.xyz);
+    depth[pixel.y * img_width + pixel.x] = d;
+    if(reproject == 0)
+        return (float4)(0.f);
+    
+    //The rotation part of the view matrix is orthonormal, so it's transpose takes world space vectors into the previous camera space.
+    Mat4x4 m = prev_cam->view_mat;
+    float3 v = ray.origin.xyz + ray.dir.xyz * d - (float3)(m.r1.w, m.r2.w, m.r3.w);
+    float3 local = (float3)(dot(v, (float3)(m.r1.x, m.r2.x, m.r3.x)),
+                            dot(v, (float3)(m.r1.y, m.r2.y, m.r3.y)),
+                            dot(v, (float3)(m.r1.z, m.r2.z, m.r3.z)));
+    if(local.z >= 0.f)
+        return (float4)(0.f);
+    
+    //Inverse of createRay().
+    float aspect_ratio = (img_width*1.0)/img_height;
+    float2 ndc = (float2)(local.x / aspect_ratio, local.y) * (prev_cam->view_plane_dist / -local.z);
+    int2 prev = convert_int2(floor((ndc + 1.f) * 0.5f * (float2)(img_width, img_height)));
+    if(prev.x < 0 || prev.y < 0 || prev.x >= img_width || prev.y >= img_height)
+        return (float4)(0.f);
+    
+    float expected = length(v);
+    float stored = prev_depth[prev.y * img_width + prev.x];
+    if(fabs(stored - expected) > DISOCCLUSION_TOLERANCE * min(stored, expected))
+        return (float4)(0.f);
+    
+    float4 history = read_imagef(inputImage, sampler, prev);
+    history.w = min(history.w, (float) max_history);
+    return history;
+}
+#endif
+
+#ifdef YUNE_FUSED_TONEMAP
+/* Same Reinhard operator and gamma as kernels/post-proc/tonemap.cl, written straight to the RGBA8 display image so the accumulated
+ * frame doesn't need a post-processing pass. lum_white is the white point the host would pass to the tonemap kernel.
+ */
+void writeDisplay(__write_only image2d_t display_image, int2 pixel, float4 color, float lum_white)
+{
+    float lum_world = getYluminance(color) + 0.001f;
+    float lum_display = lum_world * (1 + lum_world/(lum_white * lum_white)) / (1 + lum_world);
+    float4 ldr_color = lum_display * (color / lum_world);
+    ldr_color = pow(clamp(ldr_color, (float4) 0.0f, (float4) 1.0f), (float4) (1/2.2f));
+    ldr_color.w = 1.0f;
+    write_imagef(display_image, pixel, ldr_color);
+}
+#endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #yune-preproc kernel-name tonemap
+#yune-preproc feature auto-exposure
 
 #define SATURATION_EXP  1.0f
 #define GAMMA           2.2f
@@ -12,7 +13,11 @@ float4 tonemapReinhard(float4 col, float lum_white);
 float4 tonemapJohnHable(float4 col);
 
 __kernel void tonemap(__read_only image2d_t current_frame, __read_only image2d_t prev_frame,
-                      __write_only image2d_t outputImage, int reset)
+                      __write_only image2d_t outputImage, int reset
+#ifdef YUNE_AUTO_EXPOSURE
+                      , float exposure, float lum_white
+#endif
+                      )
 {
     int img_width = get_image_width(outputImage);
     int img_height = get_image_height(outputImage);
@@ -25,7 +30,11 @@ __kernel void tonemap(__read_only image2d_t current_frame, __read_only image2d_t
     float4 hdr_color = read_imagef(current_frame, sampler, pixel);
     float4 ldr_color = hdr_color;
     
+#ifdef YUNE_AUTO_EXPOSURE
+    ldr_color = tonemapReinhard(hdr_color * exposure, lum_white);
+#else
     ldr_color = tonemapReinhard(hdr_color, 1.0f);
+#endif
     //ldr_color = tonemapJohnHable(hdr_color);
 
     //Apply Gamma correction
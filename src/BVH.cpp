@@ -24,6 +24,7 @@
  ******************************************************************************/
 
 #include "BVH.h"
+#include "Tracer.h"
 #include <limits>
 
 #include <cmath>
@@ -55,6 +56,7 @@ namespace yune
 
     void BVH::createBVH(AABB root, const std::vector<TriangleCPU>& cpu_tri_list, int bvh_bins)
     {
+        YUNE_TRACE_SCOPE("scene", "Build BVH");
         clearValues();
         bins = bvh_bins;
 
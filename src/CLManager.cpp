@@ -24,6 +24,7 @@
  ******************************************************************************/
 
 #include "CLManager.h"
+#include "Tracer.h"
 
 #include <exception>
 #include <iostream>
@@ -45,6 +46,300 @@
 namespace yune
 {
     std::function<void(const std::string&, const std::string&, const std::string&)> CLManager::setMessageCb;
+    const std::string CLManager::TONEMAP_PATH = "./kernels/post-proc/tonemap.cl";
+
+    /* Optional features a rendering kernel can opt into with "#yune-preproc feature <name>" and the number of arguments each one
+     * appends after block_y. Arguments of different features follow each other in the order the directives appear in the file.
+     */
+    static const std::vector<std::pair<std::string, int>> rk_feature_args =
+    {
+        {"spp-per-launch", 1},
+        {"wavefront", 1},
+        {"persistent-threads", 1},
+        {"ray-counters", 1},
+        {"cost-heatmap", 1},
+        {"adaptive-sampling", 3},
+        {"feature-buffers", 3},
+        {"temporal-reprojection", 5},
+        {"fused-tonemap", 3}
+    };
+
+    /* Rendering kernel features Multi-Device Rendering doesn't support, with how they're called in messages. Their state lives on the
+     * primary device only.
+     */
+    static const std::vector<std::pair<std::string, std::string>> single_device_features =
+    {
+        {"wavefront", "wavefront kernels"},
+        {"ray-counters", "ray counters"},
+        {"cost-heatmap", "cost heatmaps"},
+        {"adaptive-sampling", "adaptive sampling"},
+        {"feature-buffers", "feature buffers"},
+        {"temporal-reprojection", "temporal reprojection"},
+        {"fused-tonemap", "fused tonemapping"}
+    };
+
+    /* Same for post-processing kernels. Their arguments follow reset. */
+    static const std::vector<std::pair<std::string, int>> ppk_feature_args =
+    {
+        {"auto-exposure", 2}
+    };
+
+    // Every feature is also exposed as a macro e.g. spp-per-launch defines YUNE_SPP_PER_LAUNCH so kernels can #ifdef the extra arguments.
+    static std::string featureBuildOptions(std::string build_opts, const std::vector<std::string>& features)
+    {
+        for(const std::string& feature : features)
+        {
+            std::string macro = "YUNE_" + feature;
+            std::replace(macro.begin(), macro.end(), '-', '_');
+            std::transform(macro.begin(), macro.end(), macro.begin(), ::toupper);
+            build_opts += " -D " + macro;
+        }
+        return build_opts;
+    }
+
+    /* Maps one channel of the cost image to a color with a polynomial fit of the Turbo colormap. The result is written where the
+     * post-processing kernel writes, so it's displayed and saved the same way.
+     */
+    static const char* heatmap_src = R"(
+        __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+        __kernel void heatmap(__read_only image2d_t cost_image, __write_only image2d_t output_image, int channel, float max_cost)
+        {
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            if(pixel.x >= get_image_width(output_image) || pixel.y >= get_image_height(output_image))
+                return;
+
+            float4 cost = read_imagef(cost_image, sampler, pixel);
+            float x = channel == 0 ? cost.x : (channel == 1 ? cost.y : cost.z);
+            x = clamp(x / max_cost, 0.0f, 1.0f);
+
+            float4 v4 = (float4)(1.0f, x, x * x, x * x * x);
+            float2 v2 = v4.zw * v4.z;
+            float4 color;
+            color.x = dot(v4, (float4)(0.13572138f, 4.61539260f, -42.66032258f, 132.13108234f)) + dot(v2, (float2)(-152.94239396f, 59.28637943f));
+            color.y = dot(v4, (float4)(0.09140261f, 2.19418839f, 4.84296658f, -14.18503333f)) + dot(v2, (float2)(4.27729857f, 2.82956604f));
+            color.z = dot(v4, (float4)(0.10667330f, 12.64194608f, -60.58204836f, 110.36276771f)) + dot(v2, (float2)(-89.90310912f, 27.34824973f));
+            color.w = 1.0f;
+            write_imagef(output_image, pixel, clamp(color, 0.0f, 1.0f));
+        }
+    )";
+
+    /* Lists the pixels of an adaptive-sampling frame that still have to be rendered. A pixel stays active until it has min_spp samples
+     * and the standard error of it's mean luminance drops below threshold relative to the mean. Work-groups reserve their slots in the
+     * list with a single global atomic, so the list is ordered by work-group and neighbouring pixels stay close together. Converged
+     * pixels are copied to the image the rendering kernel writes to, since it won't touch them this frame.
+     */
+    static const char* compact_src = R"(
+        __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+        __kernel void compact(__read_only image2d_t input_image, __write_only image2d_t output_image, __global const float4* moments,
+                              __global int* active_pixels, __global volatile int* active_count, float threshold, int min_spp, int reset)
+        {
+            __local int group_count, group_start;
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            int width = get_image_width(output_image);
+            bool first = get_local_id(0) == 0 && get_local_id(1) == 0;
+
+            if(first)
+                group_count = 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            bool active = false;
+            int slot = 0;
+            if(pixel.x < width && pixel.y < get_image_height(output_image))
+            {
+                float4 m = moments[pixel.y * width + pixel.x];
+                active = reset == 1 || m.z < min_spp;
+                if(!active)
+                {
+                    float variance = max(m.y - m.x * m.x, 0.0f) * m.z / (m.z - 1.0f);
+                    active = sqrt(variance / m.z) > threshold * (m.x + 1e-3f);
+                }
+
+                if(active)
+                    slot = atomic_inc(&group_count);
+                else
+                    write_imagef(output_image, pixel, read_imagef(input_image, sampler, pixel));
+            }
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            if(first)
+                group_start = atomic_add(active_count, group_count);
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            if(active)
+                active_pixels[group_start + slot] = pixel.y * width + pixel.x;
+        }
+    )";
+
+    /* Relative squared difference between the accumulated image and a snapshot of it taken at fewer samples, averaged over the RGB
+     * channels. The difference has (m - n) / (m * n) times the per-sample variance of a pixel at m samples with n of them in the
+     * snapshot, while the pixel itself has 1 / m times, so it's scaled by n / (m - n) with the counts in the alpha channels. Pixels
+     * adaptive sampling skipped since the snapshot can't be estimated and aren't counted. The error and the number of pixels that
+     * contributed are summed per work-group. The host adds up the partial sums, so no floating point atomics are needed.
+     */
+    static const char* error_src = R"(
+        __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+        __kernel void rel_mse(__read_only image2d_t image, __read_only image2d_t snapshot, __global float2* group_sums)
+        {
+            __local float2 sums[GROUP_SIZE * GROUP_SIZE];
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            int lid = get_local_id(1) * GROUP_SIZE + get_local_id(0);
+
+            float2 error = (float2)(0.0f, 0.0f);
+            if(pixel.x < get_image_width(image) && pixel.y < get_image_height(image))
+            {
+                float4 a = read_imagef(image, sampler, pixel);
+                float4 s = read_imagef(snapshot, sampler, pixel);
+                if(a.w > s.w)
+                {
+                    float3 d = a.xyz - s.xyz;
+                    float3 r = d * d / (a.xyz * a.xyz + 0.01f);
+                    error = (float2)((r.x + r.y + r.z) / 3.0f * s.w / (a.w - s.w), 1.0f);
+                }
+            }
+            sums[lid] = error;
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            for(int s = GROUP_SIZE * GROUP_SIZE / 2; s > 0; s >>= 1)
+            {
+                if(lid < s)
+                    sums[lid] += sums[lid + s];
+                barrier(CLK_LOCAL_MEM_FENCE);
+            }
+
+            if(lid == 0)
+                group_sums[get_group_id(1) * get_num_groups(0) + get_group_id(0)] = sums[0];
+        }
+    )";
+
+    /* One pass of the edge-avoiding a-trous wavelet filter (Dammertz et al. 2010). A 5x5 B3-spline is spread out by step pixels and
+     * every tap is weighted by how much it's color, normal and depth differ from the center. The first pass divides the color by the
+     * albedo so textures aren't blurred, the last one multiplies it back.
+     */
+    static const char* denoise_src = R"(
+        __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+        __constant float B3[3] = {0.375f, 0.25f, 0.0625f};
+
+        float3 safeAlbedo(float4 albedo)
+        {
+            return select((float3)(1.0f), albedo.xyz, isgreater(albedo.xyz, (float3)(0.01f)));
+        }
+
+        float3 fetch(__read_only image2d_t input, __global const float4* albedo, int2 pixel, int width, int demodulate)
+        {
+            float3 color = read_imagef(input, sampler, pixel).xyz;
+            return demodulate ? color / safeAlbedo(albedo[pixel.y * width + pixel.x]) : color;
+        }
+
+        __kernel void atrous(__read_only image2d_t input, __write_only image2d_t output, __global const float4* albedo,
+                             __global const float4* normal_depth, int step, float sigma_color, float sigma_normal, float sigma_depth,
+                             int demodulate, int remodulate)
+        {
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            int width = get_image_width(output);
+            int height = get_image_height(output);
+            if(pixel.x >= width || pixel.y >= height)
+                return;
+
+            int p = pixel.y * width + pixel.x;
+            float4 nd_p = normal_depth[p];
+            float3 c_p = fetch(input, albedo, pixel, width, demodulate);
+            float3 sum = (float3)(0.0f);
+            float weight_sum = 0.0f;
+
+            for(int dy = -2; dy <= 2; dy++)
+            {
+                for(int dx = -2; dx <= 2; dx++)
+                {
+                    int2 q = clamp(pixel + (int2)(dx, dy) * step, (int2)(0), (int2)(width - 1, height - 1));
+                    float4 nd_q = normal_depth[q.y * width + q.x];
+                    float3 c_q = fetch(input, albedo, q, width, demodulate);
+                    float3 d = c_p - c_q;
+
+                    float w = B3[abs(dx)] * B3[abs(dy)];
+                    w *= exp(-dot(d, d) / (sigma_color * sigma_color + 1e-6f));
+                    w *= pow(max(dot(nd_p.xyz, nd_q.xyz), 0.0f), sigma_normal);
+                    w *= exp(-fabs(nd_p.w - nd_q.w) / (sigma_depth * step * max(nd_p.w, 1e-3f)));
+                    sum += c_q * w;
+                    weight_sum += w;
+                }
+            }
+
+            float3 color = weight_sum > 1e-6f ? sum / weight_sum : c_p;
+            if(remodulate)
+                color *= safeAlbedo(albedo[p]);
+            write_imagef(output, pixel, (float4)(color, 1.0f));
+        }
+    )";
+
+    /* Reduces a tile of the image per work-group to the sum of the log luminance and the maximum luminance for auto-exposure. Every
+     * group also bins it's pixels into a histogram of log2 luminance in local memory first and merges it with one atomic per bin.
+     */
+    static const char* luminance_src = R"(
+        __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+        __kernel void luminance(__read_only image2d_t image, __global float2* group_stats, __global uint* histogram)
+        {
+            __local float log_sums[GROUP_SIZE * GROUP_SIZE];
+            __local float maxima[GROUP_SIZE * GROUP_SIZE];
+            __local uint bins[BINS];
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            int lid = get_local_id(1) * GROUP_SIZE + get_local_id(0);
+
+            for(int i = lid; i < BINS; i += GROUP_SIZE * GROUP_SIZE)
+                bins[i] = 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            float log_lum = 0.0f, lum = 0.0f;
+            if(pixel.x < get_image_width(image) && pixel.y < get_image_height(image))
+            {
+                float3 color = read_imagef(image, sampler, pixel).xyz;
+                lum = fmax(dot(color, (float3)(0.212671f, 0.715160f, 0.072169f)), 0.0f);
+                log_lum = log(lum + 0.0001f);
+                int bin = (log2(lum + 1e-6f) - LOG2_MIN) * BINS / (LOG2_MAX - LOG2_MIN);
+                atomic_inc(&bins[clamp(bin, 0, BINS - 1)]);
+            }
+            log_sums[lid] = log_lum;
+            maxima[lid] = lum;
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            for(int s = GROUP_SIZE * GROUP_SIZE / 2; s > 0; s >>= 1)
+            {
+                if(lid < s)
+                {
+                    log_sums[lid] += log_sums[lid + s];
+                    maxima[lid] = fmax(maxima[lid], maxima[lid + s]);
+                }
+                barrier(CLK_LOCAL_MEM_FENCE);
+            }
+
+            if(lid == 0)
+                group_stats[get_group_id(1) * get_num_groups(0) + get_group_id(0)] = (float2)(log_sums[0], maxima[0]);
+            for(int i = lid; i < BINS; i += GROUP_SIZE * GROUP_SIZE)
+                if(bins[i] > 0)
+                    atomic_add(&histogram[i], bins[i]);
+        }
+    )";
+
+    // Bilinear upscale of a reduced resolution frame to the size of the output image.
+    static const char* upscale_src = R"(
+        __constant sampler_t linear = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+
+        __kernel void upscale(__read_only image2d_t input, __write_only image2d_t output)
+        {
+            int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+            int2 size = (int2)(get_image_width(output), get_image_height(output));
+            if(pixel.x >= size.x || pixel.y >= size.y)
+                return;
+
+            float2 uv = (convert_float2(pixel) + 0.5f) / convert_float2(size);
+            write_imagef(output, pixel, read_imagef(input, linear, uv));
+        }
+    )";
+
+    static const char* wf_kernel_names[CLManager::WF_KERNEL_COUNT] = {"generate", "extend", "shade_diffuse", "shade_specular", "connect"};
 
     CLManager::Platform::Platform()
     {
@@ -62,6 +357,26 @@ namespace yune
     {
     }
 
+    CLManager::HelperDevice::HelperDevice()
+    {
+        context = NULL;
+        comm_queue = NULL;
+        rk_program = NULL;
+        rend_kernel = NULL;
+        image_buffers[0] = NULL;
+        image_buffers[1] = NULL;
+        vert_buffer = NULL;
+        mat_buffer = NULL;
+        bvh_buffer = NULL;
+        camera_buffer = NULL;
+        work_counter_buffer = NULL;
+        rendk_wgs = 0;
+    }
+
+    CLManager::HelperDevice::~HelperDevice()
+    {
+    }
+
     CLManager::CLManager()
     {
         rend_kernel = NULL;
@@ -70,10 +385,61 @@ namespace yune
         image_buffers[0] = NULL;
         image_buffers[1] = NULL;
         image_buffers[2] = NULL;
+        display_images[0] = NULL;
+        display_images[1] = NULL;
+        createEventFromGLsync = NULL;
+        heatmap_program = NULL;
+        heatmap_kernel = NULL;
+        compact_program = NULL;
+        compact_kernel = NULL;
+        error_program = NULL;
+        error_kernel = NULL;
+        denoise_program = NULL;
+        denoise_kernel = NULL;
+        upscale_program = NULL;
+        upscale_kernel = NULL;
+        luminance_program = NULL;
+        luminance_kernel = NULL;
         vert_buffer = NULL;
         mat_buffer = NULL;
         bvh_buffer = NULL;
         camera_buffer = NULL;
+        for(int i = 0; i < CAMERA_RING_SIZE; i++)
+            camera_buffers[i] = NULL;
+        path_buffer = NULL;
+        ray_queue_buffer = NULL;
+        material_queue_buffer = NULL;
+        shadow_queue_buffer = NULL;
+        queue_counter_buffer = NULL;
+        work_counter_buffer = NULL;
+        ray_counter_buffer = NULL;
+        ray_counters_64 = false;
+        moments_buffer = NULL;
+        active_pixel_buffer = NULL;
+        active_count_buffer = NULL;
+        adaptive_num_pixels = 0;
+        snapshot_image = NULL;
+        error_sum_buffer = NULL;
+        snapshot_width = snapshot_height = 0;
+        albedo_buffer = NULL;
+        normal_depth_buffer = NULL;
+        denoise_images[0] = denoise_images[1] = NULL;
+        denoise_width = denoise_height = 0;
+        denoise_half = false;
+        prev_camera_buffer = NULL;
+        depth_buffers[0] = depth_buffers[1] = NULL;
+        temporal_num_pixels = 0;
+        preview_images[0] = preview_images[1] = NULL;
+        preview_width = preview_height = 0;
+        preview_half = false;
+        luminance_stats_buffer = NULL;
+        histogram_buffer = NULL;
+        luminance_width = luminance_height = 0;
+        rendk_wgs = preferred_workgroup_multiple = 0;
+        wf_num_paths = 0;
+        wf_max_bounces = 0;
+        for(int i = 0; i < WF_KERNEL_COUNT; i++)
+            wf_kernels[i] = NULL;
         rk_program = NULL;
         ppk_program = NULL;
         context = NULL;
@@ -82,14 +448,42 @@ namespace yune
 
     CLManager::~CLManager()
     {
+        releaseHelperDevices();
         if(rend_kernel)
             clReleaseKernel(rend_kernel);
         if(pp_kernel)
             clReleaseKernel(pp_kernel);
+        for(int i = 0; i < WF_KERNEL_COUNT; i++)
+            if(wf_kernels[i])
+                clReleaseKernel(wf_kernels[i]);
+        if(heatmap_kernel)
+            clReleaseKernel(heatmap_kernel);
+        if(compact_kernel)
+            clReleaseKernel(compact_kernel);
+        if(error_kernel)
+            clReleaseKernel(error_kernel);
+        if(denoise_kernel)
+            clReleaseKernel(denoise_kernel);
+        if(upscale_kernel)
+            clReleaseKernel(upscale_kernel);
+        if(luminance_kernel)
+            clReleaseKernel(luminance_kernel);
         if(rk_program)
             clReleaseProgram(rk_program);
         if(ppk_program)
             clReleaseProgram(ppk_program);
+        if(heatmap_program)
+            clReleaseProgram(heatmap_program);
+        if(compact_program)
+            clReleaseProgram(compact_program);
+        if(error_program)
+            clReleaseProgram(error_program);
+        if(denoise_program)
+            clReleaseProgram(denoise_program);
+        if(upscale_program)
+            clReleaseProgram(upscale_program);
+        if(luminance_program)
+            clReleaseProgram(luminance_program);
         if(comm_queue)
             clReleaseCommandQueue(comm_queue);
         if(image_buffers[0])
@@ -98,14 +492,25 @@ namespace yune
             clReleaseMemObject(image_buffers[1]);
         if(image_buffers[2])
             clReleaseMemObject(image_buffers[2]);
+        if(display_images[0])
+            clReleaseMemObject(display_images[0]);
+        if(display_images[1])
+            clReleaseMemObject(display_images[1]);
         if(vert_buffer)
             clReleaseMemObject(vert_buffer);
         if(mat_buffer)
             clReleaseMemObject(mat_buffer);
         if(bvh_buffer)
             clReleaseMemObject(bvh_buffer);
-        if(camera_buffer)
-            clReleaseMemObject(camera_buffer);
+        for(int i = 0; i < CAMERA_RING_SIZE; i++)
+            if(camera_buffers[i])
+                clReleaseMemObject(camera_buffers[i]);
+        for(cl_mem buffer : {path_buffer, ray_queue_buffer, material_queue_buffer, shadow_queue_buffer, queue_counter_buffer, work_counter_buffer, ray_counter_buffer,
+                           moments_buffer, active_pixel_buffer, active_count_buffer, snapshot_image, error_sum_buffer,
+                           albedo_buffer, normal_depth_buffer, denoise_images[0], denoise_images[1], prev_camera_buffer, depth_buffers[0], depth_buffers[1],
+                           preview_images[0], preview_images[1], luminance_stats_buffer, histogram_buffer})
+            if(buffer)
+                clReleaseMemObject(buffer);
         if(context)
             clReleaseContext(context);
     }
@@ -153,10 +558,41 @@ namespace yune
 
         comm_queue = clCreateCommandQueue(context, target_device.device_id, CL_QUEUE_PROFILING_ENABLE, &err);
         checkError(err, __FILE__, __LINE__ - 1);
+
+        //With cl_khr_gl_event, GL fences can be waited on by the device instead of finishing GL on the host before every acquire.
+        createEventFromGLsync = NULL;
+        if(target_device.clgl_event_ext)
+        {
+            #if CL_TARGET_OPENCL_VERSION > 110
+            createEventFromGLsync = (clCreateEventFromGLsyncKHR_fn) clGetExtensionFunctionAddressForPlatform(target_platform.platform_id, "clCreateEventFromGLsyncKHR");
+            #else
+            createEventFromGLsync = (clCreateEventFromGLsyncKHR_fn) clGetExtensionFunctionAddress("clCreateEventFromGLsyncKHR");
+            #endif
+        }
     }
 
     bool CLManager::createRenderProgram(std::string fn, std::string path, bool reload)
     {
+        YUNE_TRACE_SCOPE("cl", "Build Rendering Program");
+
+        // The program, it's kernels and features replace the current ones together once every check passed, so a kernel that fails to
+        // load leaves the previous one usable.
+        cl_program program = NULL;
+        cl_kernel kernel = NULL;
+        cl_kernel stage_kernels[WF_KERNEL_COUNT] = {};
+        auto releaseNew = [&]()
+        {
+            for(int i = 0; i < WF_KERNEL_COUNT; i++)
+            {
+                if(stage_kernels[i])
+                    clReleaseKernel(stage_kernels[i]);
+            }
+            if(kernel)
+                clReleaseKernel(kernel);
+            if(program)
+                clReleaseProgram(program);
+        };
+
         try
         {
             std::cout << "\nReading Rendering Kernel File..." << std::endl;
@@ -164,6 +600,7 @@ namespace yune
             std::string rk;
             std::ifstream file;
             std::streamoff len;
+            std::string name = rk_name, compiler_opts = rk_compiler_opts;
 
             if(reload)
                 path = rk_file_path;
@@ -179,6 +616,7 @@ namespace yune
             rk.resize(len);
             file.read(&rk[0], len);
 
+            std::vector<std::string> features;
             int first_char = rk.find_first_not_of(" \t\r\n");
             while(true)
             {
@@ -195,63 +633,143 @@ namespace yune
                 {
                     ss >> word;
                     if(word == "compiler-opts")
-                        ss >> rk_compiler_opts;
+                        ss >> compiler_opts;
                     else if (word == "kernel-name")
-                        ss >> rk_name;
+                        ss >> name;
+                    else if (word == "feature")
+                    {
+                        ss >> word;
+                        auto it = std::find_if(rk_feature_args.begin(), rk_feature_args.end(), [&word](const std::pair<std::string, int>& f){ return f.first == word; });
+                        if(it == rk_feature_args.end())
+                            throw std::runtime_error("Unknown kernel feature \"" + word + "\" in #yune-preproc directive.");
+                        if(std::find(features.begin(), features.end(), word) == features.end())
+                            features.push_back(word);
+                    }
                 }
                 rk.erase(rk.begin(), last);
                 first_char = 0;
             }
             std::cout << "File read successfully!" << std::endl;
 
+            bool persistent = std::find(features.begin(), features.end(), "persistent-threads") != features.end();
+            for(const std::pair<std::string, std::string>& f : single_device_features)
+            {
+                if(!helper_devices.empty() && std::find(features.begin(), features.end(), f.first) != features.end())
+                    throw std::runtime_error("Multi-Device Rendering doesn't support " + f.second + ". Disable it before loading the kernel.");
+            }
+            if(std::find(features.begin(), features.end(), "adaptive-sampling") != features.end() && std::find(features.begin(), features.end(), "wavefront") != features.end())
+                throw std::runtime_error("The wavefront and adaptive-sampling features can't be combined.");
+            if(persistent && std::find(features.begin(), features.end(), "wavefront") != features.end())
+                throw std::runtime_error("The wavefront and persistent-threads features can't be combined.");
+            if(std::find(features.begin(), features.end(), "spp-per-launch") != features.end() && std::find(features.begin(), features.end(), "wavefront") != features.end())
+                throw std::runtime_error("The wavefront and spp-per-launch features can't be combined. The stages trace one sample per pixel and tile.");
+
+            std::string build_opts = featureBuildOptions(compiler_opts, features);
+
+            // Counters of a whole frame overflow 32 bits at high resolutions. Widen them where the device has 64 bit atomics.
+            bool counters_64 = target_device.int64_atomics_ext && std::find(features.begin(), features.end(), "ray-counters") != features.end();
+            if(counters_64)
+                build_opts += " -D YUNE_RAY_COUNTERS_64";
+
             std::cout << "Compiling Kernel..," << std::endl;
             const char* rk_src = rk.c_str();
-            rk_program = clCreateProgramWithSource(context, 1, &rk_src, NULL, &err);
+            program = clCreateProgramWithSource(context, 1, &rk_src, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
 
             //Build Rendering Program
-            if(rk_compiler_opts.empty())
-                err = clBuildProgram(rk_program, 1, &target_device.device_id, NULL, NULL, NULL);
+            if(build_opts.empty())
+                err = clBuildProgram(program, 1, &target_device.device_id, NULL, NULL, NULL);
             else
-                err = clBuildProgram(rk_program, 1, &target_device.device_id, rk_compiler_opts.data(), NULL, NULL);
+                err = clBuildProgram(program, 1, &target_device.device_id, build_opts.data(), NULL, NULL);
 
             if(err < 0)
             {
                 std::cout << "\nRendering Program failed to build." << std::endl;
 
                 size_t log_size;
-                err = clGetProgramBuildInfo(rk_program, target_device.device_id, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+                err = clGetProgramBuildInfo(program, target_device.device_id, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
                 checkError(err, __FILE__, __LINE__ - 1);
 
                 std::string log;
                 log.resize(log_size);
-                err = clGetProgramBuildInfo(rk_program, target_device.device_id, CL_PROGRAM_BUILD_LOG, log_size, &log[0], NULL);
+                err = clGetProgramBuildInfo(program, target_device.device_id, CL_PROGRAM_BUILD_LOG, log_size, &log[0], NULL);
                 checkError(err, __FILE__, __LINE__ - 1);
 
                 std::cout << "\n" + std::string(log) << std::endl;
                 setMessageCb("Error in Kernel file. Log given below.", "Error!", std::string(log));
+                releaseNew();
                 return false;
             }
 
-            rend_kernel = clCreateKernel(rk_program, rk_name.data(), &err);
+            kernel = clCreateKernel(program, name.data(), &err);
             checkError(err, __FILE__, __LINE__ - 1);
 
+            // Wavefront programs have a fixed set of stage kernels besides the rendering kernel.
+            bool wavefront = std::find(features.begin(), features.end(), "wavefront") != features.end();
+            for(int i = 0; i < WF_KERNEL_COUNT && wavefront; i++)
+            {
+                stage_kernels[i] = clCreateKernel(program, wf_kernel_names[i], &err);
+                if(err != CL_SUCCESS)
+                    throw std::runtime_error("Wavefront kernel \"" + std::string(wf_kernel_names[i]) + "\" not found in the Rendering program.");
+            }
+
+            // Persistent-threads kernels take pixels from a counter the host resets before every launch.
+            if(persistent && !work_counter_buffer)
+            {
+                work_counter_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(std::find(features.begin(), features.end(), "ray-counters") != features.end() && !ray_counter_buffer)
+            {
+                ray_counter_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, RAY_COUNTER_COUNT * sizeof(cl_ulong), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
             // Check memory and workgroup requirements for kernels. Check if Kernel's requirements exceed device capabilities.
             cl_ulong local_mem_size;
-            size_t wgs, preferred_workgroup_multiple;
+            size_t wgs, wg_multiple;
 
-            clGetKernelWorkGroupInfo(rend_kernel, target_device.device_id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &wgs, NULL);
-            clGetKernelWorkGroupInfo(rend_kernel, target_device.device_id, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &preferred_workgroup_multiple, NULL);
-            clGetKernelWorkGroupInfo(rend_kernel, target_device.device_id, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_mem_size, NULL);
+            clGetKernelWorkGroupInfo(kernel, target_device.device_id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &wgs, NULL);
+            clGetKernelWorkGroupInfo(kernel, target_device.device_id, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &wg_multiple, NULL);
+            clGetKernelWorkGroupInfo(kernel, target_device.device_id, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_mem_size, NULL);
 
             std::cout << "Kernel compiled successfully!" << std::endl;
             std::cout << "\nThe Rendering Kernel has the following features.." << std::endl;
             std::cout << "Kernel Workgroup Size: " << wgs << "\n"
-                      << "Preferred WorkGroup Multiple Size: " <<  preferred_workgroup_multiple << "\n"
+                      << "Preferred WorkGroup Multiple Size: " <<  wg_multiple << "\n"
                       << "Kernel Local Memory Required: " << local_mem_size/(1024) << " KB" << "\n" << std::endl;
 
             if(local_mem_size > target_device.local_mem_size)
                 throw std::runtime_error("Kernel local memory requirement exceeds Device's local memory.\nProgram may crash during kernel processing.\n");
 
+            for(int i = 0; i < WF_KERNEL_COUNT; i++)
+            {
+                if(wf_kernels[i])
+                    clReleaseKernel(wf_kernels[i]);
+                wf_kernels[i] = stage_kernels[i];
+            }
+            if(rend_kernel)
+                clReleaseKernel(rend_kernel);
+            if(rk_program)
+                clReleaseProgram(rk_program);
+            rend_kernel = kernel;
+            rk_program = program;
+            program = NULL;
+            kernel = NULL;
+            std::fill(stage_kernels, stage_kernels + WF_KERNEL_COUNT, (cl_kernel) NULL);
+
+            rk_name = name;
+            rk_compiler_opts = compiler_opts;
+            rendk_wgs = wgs;
+            preferred_workgroup_multiple = wg_multiple;
+            rk_source = rk;
+            rk_build_opts = build_opts;
+            rk_features = features;
+            ray_counters_64 = counters_64;
+            if(!helper_devices.empty())
+                buildHelperPrograms();
+
             if(!reload)
             {
                 rk_file = fn;
@@ -260,6 +778,7 @@ namespace yune
         }
         catch(const std::exception& err)
         {
+            releaseNew();
             setMessageCb(err.what(), "Error!", "");
             return false;
         }
@@ -269,6 +788,7 @@ namespace yune
 
     bool CLManager::createPostProcProgram(std::string fn, std::string path, bool reload)
     {
+        YUNE_TRACE_SCOPE("cl", "Build Post-Proc Program");
         try
         {
             std::cout << "\nReading Post-processing Kernel File..." << std::endl;
@@ -276,6 +796,7 @@ namespace yune
             std::string pk;
             std::ifstream file;
             std::streamoff len;
+            std::vector<std::string> features;
 
             if(reload)
                 path = ppk_file_path;
@@ -310,6 +831,15 @@ namespace yune
                         ss >> ppk_compiler_opts;
                     else if (word == "kernel-name")
                         ss >> ppk_name;
+                    else if (word == "feature")
+                    {
+                        ss >> word;
+                        auto it = std::find_if(ppk_feature_args.begin(), ppk_feature_args.end(), [&word](const std::pair<std::string, int>& f){ return f.first == word; });
+                        if(it == ppk_feature_args.end())
+                            throw std::runtime_error("Unknown kernel feature \"" + word + "\" in #yune-preproc directive.");
+                        if(std::find(features.begin(), features.end(), word) == features.end())
+                            features.push_back(word);
+                    }
                 }
                 pk.erase(pk.begin(), last);
                 first_char = 0;
@@ -321,10 +851,8 @@ namespace yune
             ppk_program = clCreateProgramWithSource(context, 1, &pk_src, NULL, &err);
 
             //Build Post-processing Program
-            if(ppk_compiler_opts.empty())
-                err = clBuildProgram(ppk_program, 1, &target_device.device_id, NULL, NULL, NULL);
-            else
-                err = clBuildProgram(ppk_program, 1, &target_device.device_id, ppk_compiler_opts.data(), NULL, NULL);
+            std::string build_opts = featureBuildOptions(ppk_compiler_opts, features);
+            err = clBuildProgram(ppk_program, 1, &target_device.device_id, build_opts.c_str(), NULL, NULL);
             if(err < 0)
             {
                 std::cout << "\nPost-processing Program failed to build." << std::endl;
@@ -363,6 +891,7 @@ namespace yune
             if(local_mem_size > target_device.local_mem_size)
                 throw std::runtime_error("Kernel local memory requirement exceeds Device's local memory.\nProgram may crash during kernel processing.\n");
 
+            ppk_features = features;
             if(!reload)
             {
                 ppk_file = fn;
@@ -378,8 +907,9 @@ namespace yune
         return true;
     }
 
-    bool CLManager::setupImageBuffers(GLuint* rbo_IDs)
+    bool CLManager::setupImageBuffers(GLuint* rbo_IDs, GLuint* display_tex_IDs, int width, int height)
     {
+        YUNE_TRACE_SCOPE("upload", "Setup Image Buffers");
         try
         {
             cl_int err = 0;
@@ -391,16 +921,38 @@ namespace yune
                 clReleaseMemObject(image_buffers[1]);
             if(image_buffers[2])
                 clReleaseMemObject(image_buffers[2]);
+            image_buffers[2] = NULL;
+            if(display_images[0])
+                clReleaseMemObject(display_images[0]);
+            if(display_images[1])
+                clReleaseMemObject(display_images[1]);
 
-            //Setup Image Buffers for reading/writing and Post processing.
+            //Setup Image Buffers for reading/writing and the display textures.
             image_buffers[0] = clCreateFromGLRenderbuffer(context, CL_MEM_READ_WRITE, rbo_IDs[0], &err);
             checkError(err, __FILE__, __LINE__ - 1);
 
             image_buffers[1] = clCreateFromGLRenderbuffer(context, CL_MEM_READ_WRITE, rbo_IDs[1], &err);
             checkError(err, __FILE__, __LINE__ - 1);
 
-            image_buffers[2] = clCreateFromGLRenderbuffer(context, CL_MEM_READ_WRITE, rbo_IDs[2], &err);
+            display_images[0] = clCreateFromGLTexture(context, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, display_tex_IDs[0], &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            display_images[1] = clCreateFromGLTexture(context, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, display_tex_IDs[1], &err);
             checkError(err, __FILE__, __LINE__ - 1);
+
+            //Secondary devices can't share the GL renderbuffers, give them private images of the same size and format.
+            cl_image_format format = {CL_RGBA, CL_FLOAT};
+            cl_image_desc desc = {CL_MEM_OBJECT_IMAGE2D, (size_t) width, (size_t) height, 0, 0, 0, 0, 0, 0, NULL};
+            for(HelperDevice& helper : helper_devices)
+            {
+                for(int i = 0; i < 2; i++)
+                {
+                    if(helper.image_buffers[i])
+                        clReleaseMemObject(helper.image_buffers[i]);
+                    helper.image_buffers[i] = clCreateImage(helper.context, CL_MEM_READ_WRITE, &format, &desc, NULL, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+                }
+            }
         }
         catch(const std::exception& err)
         {
@@ -410,15 +962,341 @@ namespace yune
         return true;
     }
 
+    bool CLManager::setupCostImage(int width, int height)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!heatmap_program)
+            {
+                heatmap_program = clCreateProgramWithSource(context, 1, &heatmap_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                err = clBuildProgram(heatmap_program, 1, &target_device.device_id, NULL, NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                heatmap_kernel = clCreateKernel(heatmap_program, "heatmap", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(!image_buffers[2])
+            {
+                cl_image_format format = {CL_RGBA, CL_FLOAT};
+                cl_image_desc desc = {CL_MEM_OBJECT_IMAGE2D, (size_t) width, (size_t) height, 0, 0, 0, 0, 0, 0, NULL};
+                image_buffers[2] = clCreateImage(context, CL_MEM_READ_WRITE, &format, &desc, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Cost Image", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupAdaptiveBuffers(int width, int height)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!compact_program)
+            {
+                compact_program = clCreateProgramWithSource(context, 1, &compact_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                err = clBuildProgram(compact_program, 1, &target_device.device_id, NULL, NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                compact_kernel = clCreateKernel(compact_program, "compact", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(!active_count_buffer)
+            {
+                active_count_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            size_t num_pixels = (size_t) width * height;
+            if(num_pixels != adaptive_num_pixels)
+            {
+                for(cl_mem* buffer : {&moments_buffer, &active_pixel_buffer})
+                {
+                    if(*buffer)
+                        clReleaseMemObject(*buffer);
+                    *buffer = NULL;
+                }
+                adaptive_num_pixels = 0;
+
+                moments_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, num_pixels * sizeof(cl_float4), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                active_pixel_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, num_pixels * sizeof(cl_int), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+                adaptive_num_pixels = num_pixels;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Adaptive Sampling Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupConvergenceBuffers(int width, int height)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!error_program)
+            {
+                error_program = clCreateProgramWithSource(context, 1, &error_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                std::string opts = "-D GROUP_SIZE=" + std::to_string(ERROR_GROUP_SIZE);
+                err = clBuildProgram(error_program, 1, &target_device.device_id, opts.c_str(), NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                error_kernel = clCreateKernel(error_program, "rel_mse", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(width != snapshot_width || height != snapshot_height)
+            {
+                for(cl_mem* buffer : {&snapshot_image, &error_sum_buffer})
+                {
+                    if(*buffer)
+                        clReleaseMemObject(*buffer);
+                    *buffer = NULL;
+                }
+                snapshot_width = snapshot_height = 0;
+
+                cl_image_format format = {CL_RGBA, CL_FLOAT};
+                cl_image_desc desc = {CL_MEM_OBJECT_IMAGE2D, (size_t) width, (size_t) height, 0, 0, 0, 0, 0, 0, NULL};
+                snapshot_image = clCreateImage(context, CL_MEM_READ_WRITE, &format, &desc, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                size_t groups = (size_t) ((width + ERROR_GROUP_SIZE - 1) / ERROR_GROUP_SIZE) * ((height + ERROR_GROUP_SIZE - 1) / ERROR_GROUP_SIZE);
+                error_sum_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, groups * sizeof(cl_float2), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+                snapshot_width = width;
+                snapshot_height = height;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Convergence Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupDenoiseBuffers(int width, int height, bool half)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!denoise_program)
+            {
+                denoise_program = clCreateProgramWithSource(context, 1, &denoise_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                err = clBuildProgram(denoise_program, 1, &target_device.device_id, NULL, NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                denoise_kernel = clCreateKernel(denoise_program, "atrous", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(width != denoise_width || height != denoise_height || half != denoise_half)
+            {
+                for(cl_mem* buffer : {&albedo_buffer, &normal_depth_buffer, &denoise_images[0], &denoise_images[1]})
+                {
+                    if(*buffer)
+                        clReleaseMemObject(*buffer);
+                    *buffer = NULL;
+                }
+                denoise_width = denoise_height = 0;
+
+                size_t num_pixels = (size_t) width * height;
+                albedo_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, num_pixels * sizeof(cl_float4), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                normal_depth_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, num_pixels * sizeof(cl_float4), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                // Only the denoised frame goes through the images, so half floats are precise enough for the 8-bit display.
+                cl_image_format format = {CL_RGBA, (cl_channel_type) (half ? CL_HALF_FLOAT : CL_FLOAT)};
+                cl_image_desc desc = {CL_MEM_OBJECT_IMAGE2D, (size_t) width, (size_t) height, 0, 0, 0, 0, 0, 0, NULL};
+                for(int i = 0; i < 2; i++)
+                {
+                    denoise_images[i] = clCreateImage(context, CL_MEM_READ_WRITE, &format, &desc, NULL, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+                }
+                denoise_width = width;
+                denoise_height = height;
+                denoise_half = half;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Denoising Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupTemporalBuffers(int width, int height)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!prev_camera_buffer)
+            {
+                prev_camera_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(Cam), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            size_t num_pixels = (size_t) width * height;
+            if(num_pixels != temporal_num_pixels)
+            {
+                temporal_num_pixels = 0;
+                for(int i = 0; i < 2; i++)
+                {
+                    if(depth_buffers[i])
+                        clReleaseMemObject(depth_buffers[i]);
+                    depth_buffers[i] = clCreateBuffer(context, CL_MEM_READ_WRITE, num_pixels * sizeof(cl_float), NULL, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+                }
+                temporal_num_pixels = num_pixels;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Temporal Reprojection Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupPreviewImages(int width, int height, bool half)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!upscale_program)
+            {
+                upscale_program = clCreateProgramWithSource(context, 1, &upscale_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                err = clBuildProgram(upscale_program, 1, &target_device.device_id, NULL, NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                upscale_kernel = clCreateKernel(upscale_program, "upscale", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(width != preview_width || height != preview_height || half != preview_half)
+            {
+                // A preview frame only holds the few samples taken while the camera moves. Half floats count those exactly.
+                preview_width = preview_height = 0;
+                cl_image_format format = {CL_RGBA, (cl_channel_type) (half ? CL_HALF_FLOAT : CL_FLOAT)};
+                cl_image_desc desc = {CL_MEM_OBJECT_IMAGE2D, (size_t) width, (size_t) height, 0, 0, 0, 0, 0, 0, NULL};
+                for(int i = 0; i < 2; i++)
+                {
+                    if(preview_images[i])
+                        clReleaseMemObject(preview_images[i]);
+                    preview_images[i] = clCreateImage(context, CL_MEM_READ_WRITE, &format, &desc, NULL, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+                }
+                preview_width = width;
+                preview_height = height;
+                preview_half = half;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Preview Images", "");
+            return false;
+        }
+        return true;
+    }
+
+    bool CLManager::setupLuminanceBuffers(int width, int height)
+    {
+        try
+        {
+            cl_int err = 0;
+            if(!luminance_program)
+            {
+                luminance_program = clCreateProgramWithSource(context, 1, &luminance_src, NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                std::string opts = "-D GROUP_SIZE=" + std::to_string(LUMINANCE_GROUP_SIZE) + " -D BINS=" + std::to_string(LUMINANCE_BINS) +
+                                   " -D LOG2_MIN=" + std::to_string(LUMINANCE_LOG2_MIN) + ".0f -D LOG2_MAX=" + std::to_string(LUMINANCE_LOG2_MAX) + ".0f";
+                err = clBuildProgram(luminance_program, 1, &target_device.device_id, opts.c_str(), NULL, NULL);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                luminance_kernel = clCreateKernel(luminance_program, "luminance", &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+
+            if(width != luminance_width || height != luminance_height)
+            {
+                for(cl_mem* buffer : {&luminance_stats_buffer, &histogram_buffer})
+                {
+                    if(*buffer)
+                        clReleaseMemObject(*buffer);
+                    *buffer = NULL;
+                }
+                luminance_width = luminance_height = 0;
+
+                size_t groups = (size_t) ((width + LUMINANCE_GROUP_SIZE - 1) / LUMINANCE_GROUP_SIZE) * ((height + LUMINANCE_GROUP_SIZE - 1) / LUMINANCE_GROUP_SIZE);
+                luminance_stats_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, groups * sizeof(cl_float2), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+
+                histogram_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, LUMINANCE_BINS * sizeof(cl_uint), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+                luminance_width = width;
+                luminance_height = height;
+            }
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Luminance Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
     void CLManager::setupCameraBuffer(Cam* cam_data)
     {
+        YUNE_TRACE_SCOPE("upload", "Upload Camera");
         cl_int err = 0;
-        camera_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR, sizeof(Cam), cam_data, &err);
-        checkError(err, __FILE__, __LINE__ - 1);
+
+        // The camera is written with non-blocking writes from then on, so the buffers can live in device memory.
+        for(int i = 0; i < CAMERA_RING_SIZE; i++)
+        {
+            if(camera_buffers[i])
+                clReleaseMemObject(camera_buffers[i]);
+            camera_buffers[i] = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(Cam), cam_data, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+        }
+        camera_buffer = camera_buffers[0];
+
+        for(HelperDevice& helper : helper_devices)
+        {
+            if(helper.camera_buffer)
+                clReleaseMemObject(helper.camera_buffer);
+            helper.camera_buffer = createHelperBuffer(helper, sizeof(Cam), cam_data);
+        }
     }
 
     bool CLManager::setupBVHBuffer(std::vector<BVHNodeGPU>& bvh_data, float bvh_size, float scene_size)
     {
+        YUNE_TRACE_SCOPE("upload", "Upload BVH");
         try
         {
             cl_int err = 0;
@@ -430,6 +1308,15 @@ namespace yune
 
             bvh_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR, sizeof(BVHNodeGPU) * bvh_data.size(), bvh_data.data(), &err);
             checkError(err, __FILE__, __LINE__);
+
+            for(HelperDevice& helper : helper_devices)
+            {
+                if(helper.bvh_buffer)
+                    clReleaseMemObject(helper.bvh_buffer);
+                if(bvh_size + scene_size > helper.device.global_mem_size)
+                    throw std::runtime_error("BVH and Scene Data size combined exceed global memory size of device \"" + std::string(helper.device.name.c_str()) + "\".");
+                helper.bvh_buffer = createHelperBuffer(helper, sizeof(BVHNodeGPU) * bvh_data.size(), bvh_data.data());
+            }
         }
         catch(const std::exception& err)
         {
@@ -441,6 +1328,7 @@ namespace yune
 
     bool CLManager::setupVertexBuffer(std::vector<TriangleGPU>& vert_data, float scene_size)
     {
+        YUNE_TRACE_SCOPE("upload", "Upload Vertices");
         try
         {
             cl_int err = 0;
@@ -454,6 +1342,15 @@ namespace yune
 
             vert_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR, sizeof(TriangleGPU) * vert_data.size(), vert_data.data(), &err);
             checkError(err, __FILE__, __LINE__);
+
+            for(HelperDevice& helper : helper_devices)
+            {
+                if(helper.vert_buffer)
+                    clReleaseMemObject(helper.vert_buffer);
+                if(scene_size > helper.device.global_mem_size)
+                    throw std::runtime_error("Scene Data size exceeds global memory size of device \"" + std::string(helper.device.name.c_str()) + "\".");
+                helper.vert_buffer = createHelperBuffer(helper, sizeof(TriangleGPU) * vert_data.size(), vert_data.data());
+            }
         }
         catch(const std::exception& err)
         {
@@ -463,8 +1360,56 @@ namespace yune
         return true;
     }
 
+    bool CLManager::setupWavefrontBuffers(size_t num_paths, int max_bounces)
+    {
+        if(num_paths == wf_num_paths && max_bounces == wf_max_bounces)
+            return true;
+
+        try
+        {
+            cl_int err = 0;
+            for(cl_mem* buffer : {&path_buffer, &ray_queue_buffer, &material_queue_buffer, &shadow_queue_buffer, &queue_counter_buffer})
+            {
+                if(*buffer)
+                    clReleaseMemObject(*buffer);
+                *buffer = NULL;
+            }
+            wf_num_paths = 0;
+            wf_max_bounces = 0;
+
+            size_t total_size = num_paths * (sizeof(PathStateGPU) + 5 * sizeof(cl_int));
+            if(total_size > target_device.global_mem_size)
+                throw std::runtime_error("Wavefront path state exceeds Device's global memory size. Use more blocks.");
+
+            path_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(PathStateGPU) * num_paths, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            ray_queue_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * num_paths * 2, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            material_queue_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * num_paths * 2, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            shadow_queue_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * num_paths, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            queue_counter_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * 4 * (max_bounces + 1), NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            wf_num_paths = num_paths;
+            wf_max_bounces = max_bounces;
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error Creating Wavefront Buffers", "");
+            return false;
+        }
+        return true;
+    }
+
     bool CLManager::setupMatBuffer(std::vector<Material>& mat_data)
     {
+        YUNE_TRACE_SCOPE("upload", "Upload Materials");
         try
         {
             cl_int err = 0;
@@ -474,6 +1419,13 @@ namespace yune
 
             mat_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR, sizeof(Material) * mat_data.size(), mat_data.data(), &err);
             checkError(err, __FILE__, __LINE__);
+
+            for(HelperDevice& helper : helper_devices)
+            {
+                if(helper.mat_buffer)
+                    clReleaseMemObject(helper.mat_buffer);
+                helper.mat_buffer = createHelperBuffer(helper, sizeof(Material) * mat_data.size(), mat_data.data());
+            }
         }
         catch(const std::exception& err)
         {
@@ -504,7 +1456,7 @@ namespace yune
 
         // List of OpenCL platforms and Devices
         std::vector<cl_platform_id> platforms(num_plat);
-        std::vector<Platform> platform_list;
+        platform_list.clear();
 
         err = clGetPlatformIDs(num_plat, platforms.data(), NULL);
         checkError(err, __FILE__, __LINE__ - 1);
@@ -597,6 +1549,162 @@ namespace yune
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
 
+    bool CLManager::setupMultiDevice(bool enable)
+    {
+        releaseHelperDevices();
+        if(!enable)
+            return true;
+
+        try
+        {
+            cl_int err = 0;
+            for(const std::pair<std::string, std::string>& f : single_device_features)
+            {
+                if(getFeatureArg(f.first) >= 0)
+                    throw std::runtime_error("Multi-Device Rendering doesn't support " + f.second + ".");
+            }
+
+            for(Platform& plat : platform_list)
+            {
+                for(Device& dev : plat.device_list)
+                {
+                    if(dev.device_id == target_device.device_id || !dev.availability || !dev.image_support)
+                        continue;
+
+                    cl_context_properties properties[] = { CL_CONTEXT_PLATFORM, (cl_context_properties) plat.platform_id, 0 };
+
+                    helper_devices.push_back(HelperDevice());
+                    HelperDevice& helper = helper_devices.back();
+                    helper.device = dev;
+
+                    helper.context = clCreateContext(properties, 1, &dev.device_id, NULL, NULL, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+
+                    helper.comm_queue = clCreateCommandQueue(helper.context, dev.device_id, CL_QUEUE_PROFILING_ENABLE, &err);
+                    checkError(err, __FILE__, __LINE__ - 1);
+
+                    helper_device_names.push_back(dev.name.c_str());
+                    std::cout << "Added secondary device \"" << dev.name.c_str() << "\"" << std::endl;
+                }
+            }
+
+            if(helper_devices.empty())
+                throw std::runtime_error("No other OpenCL device with image support is available for multi-device rendering.");
+
+            if(!rk_source.empty())
+                buildHelperPrograms();
+        }
+        catch(const std::exception& err)
+        {
+            releaseHelperDevices();
+            setMessageCb(err.what(), "Error!", "");
+            return false;
+        }
+        return true;
+    }
+
+    void CLManager::buildHelperPrograms()
+    {
+        cl_int err = 0;
+        const char* rk_src = rk_source.c_str();
+        for(HelperDevice& helper : helper_devices)
+        {
+            if(helper.rend_kernel)
+                clReleaseKernel(helper.rend_kernel);
+            if(helper.rk_program)
+                clReleaseProgram(helper.rk_program);
+            helper.rend_kernel = NULL;
+
+            helper.rk_program = clCreateProgramWithSource(helper.context, 1, &rk_src, NULL, &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            err = clBuildProgram(helper.rk_program, 1, &helper.device.device_id, rk_build_opts.empty() ? NULL : rk_build_opts.data(), NULL, NULL);
+            if(err < 0)
+                throw std::runtime_error("Rendering Program failed to build on secondary device \"" + std::string(helper.device.name.c_str()) + "\".");
+
+            helper.rend_kernel = clCreateKernel(helper.rk_program, rk_name.data(), &err);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            err = clGetKernelWorkGroupInfo(helper.rend_kernel, helper.device.device_id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &helper.rendk_wgs, NULL);
+            checkError(err, __FILE__, __LINE__ - 1);
+
+            if(getFeatureArg("persistent-threads") >= 0 && !helper.work_counter_buffer)
+            {
+                helper.work_counter_buffer = clCreateBuffer(helper.context, CL_MEM_READ_WRITE, sizeof(cl_int), NULL, &err);
+                checkError(err, __FILE__, __LINE__ - 1);
+            }
+        }
+    }
+
+    int CLManager::getPostProcFeatureArg(const std::string& feature)
+    {
+        // Fixed arguments end with reset at index 3.
+        int arg = 4;
+        for(const std::string& f : ppk_features)
+        {
+            auto it = std::find_if(ppk_feature_args.begin(), ppk_feature_args.end(), [&f](const std::pair<std::string, int>& fa){ return fa.first == f; });
+            if(f == feature)
+                return arg;
+            arg += it->second;
+        }
+        return -1;
+    }
+
+    int CLManager::getFeatureArg(const std::string& feature)
+    {
+        // Fixed arguments end with block_y at index 13.
+        int arg = 14;
+        for(const std::string& f : rk_features)
+        {
+            auto it = std::find_if(rk_feature_args.begin(), rk_feature_args.end(), [&f](const std::pair<std::string, int>& fa){ return fa.first == f; });
+            if(f == feature)
+                return arg;
+            arg += it->second;
+        }
+        return -1;
+    }
+
+    cl_mem CLManager::createHelperBuffer(HelperDevice& helper, size_t size, void* data)
+    {
+        cl_int err = 0;
+        cl_mem buffer = clCreateBuffer(helper.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR, size, data, &err);
+        checkError(err, __FILE__, __LINE__ - 1);
+        return buffer;
+    }
+
+    void CLManager::releaseHelperDevices()
+    {
+        for(HelperDevice& helper : helper_devices)
+        {
+            if(helper.comm_queue)
+                clFinish(helper.comm_queue);
+            if(helper.rend_kernel)
+                clReleaseKernel(helper.rend_kernel);
+            if(helper.rk_program)
+                clReleaseProgram(helper.rk_program);
+            if(helper.image_buffers[0])
+                clReleaseMemObject(helper.image_buffers[0]);
+            if(helper.image_buffers[1])
+                clReleaseMemObject(helper.image_buffers[1]);
+            if(helper.vert_buffer)
+                clReleaseMemObject(helper.vert_buffer);
+            if(helper.mat_buffer)
+                clReleaseMemObject(helper.mat_buffer);
+            if(helper.bvh_buffer)
+                clReleaseMemObject(helper.bvh_buffer);
+            if(helper.camera_buffer)
+                clReleaseMemObject(helper.camera_buffer);
+            if(helper.work_counter_buffer)
+                clReleaseMemObject(helper.work_counter_buffer);
+            if(helper.comm_queue)
+                clReleaseCommandQueue(helper.comm_queue);
+            if(helper.context)
+                clReleaseContext(helper.context);
+        }
+        helper_devices.clear();
+        helper_device_names.clear();
+    }
+
     CLManager::Vendor CLManager::mapPlatformToVendor(std::string str)
     {
         CLManager::Vendor vd = Vendor::UNKNOWN;
@@ -707,6 +1815,7 @@ namespace yune
         clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &global_mem_size, NULL);
         clGetDeviceInfo(device_id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_mem_size, NULL);
         clGetDeviceInfo(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(cl_ulong), &constant_mem_size, NULL);
+        clGetDeviceInfo(device_id, CL_DEVICE_IMAGE_SUPPORT, sizeof(cl_bool), &image_support, NULL);
     }
 
     void CLManager::Device::displayInfo(int i)
@@ -731,6 +1840,11 @@ namespace yune
         else
             clgl_event_ext = false;
 
+        if(ext.find("cl_khr_int64_base_atomics") != std::string::npos)
+            int64_atomics_ext = true;
+        else
+            int64_atomics_ext = false;
+
         std::cout << "Device " << i << "\n"
                   << "-------------------------------------------------------------------------------\n"
                   << std::left << std::setw(35) << "Device Name" << ": " << name << "\n"
@@ -740,6 +1854,7 @@ namespace yune
                   << std::left << std::setw(35) << "OpenCL-C Version Supported" << ": " <<  device_openclC_ver << "\n"
                   << std::left << std::setw(35) << "Device Available" << ": " << (availability ? "Yes" : "No") << "\n"
                   << std::left << std::setw(35) << "cl_khr_gl_event Supported" << ": " << (clgl_event_ext ? "Yes" : "No") << "\n"
+                  << std::left << std::setw(35) << "cl_khr_int64_base_atomics Supported" << ": " << (int64_atomics_ext ? "Yes" : "No") << "\n"
                   << std::left << std::setw(35) << std::string(CL_GL_SHARING_EXT) + " Supported" << ": " << (clgl_sharing_ext ? "Yes" : "No") << "\n"
                   << std::left << std::setw(35) << "SP Floating Point Supported" << ": " << ( (fp_support & (CL_FP_ROUND_TO_NEAREST|CL_FP_INF_NAN) ) ? "Yes" : "No") << "\n"
                   << std::left << std::setw(35) << "Max Compute Units" << ": " << compute_units << "\n"
@@ -0,0 +1,925 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "CPURenderer.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define YUNE_CPU_SSE
+    #include <emmintrin.h>
+#endif
+
+namespace yune
+{
+    /* Everything below mirrors kernels/legacy/udpt.cl function by function, including the order in which random numbers are drawn.
+     * Keep both in sync when changing one of them. The only difference is the BVH traversal which uses a stack and skips nodes
+     * behind the closest hit, which doesn't change the result.
+     */
+    namespace
+    {
+        const float PI = 3.14159265359f;
+        const float INV_PI = 0.31830988618f;
+        const float EPSILON = 0.0001f;
+        const int RR_THRESHOLD = 6;
+        const int STACK_SIZE = 128;
+
+        struct Vec4
+        {
+            float x, y, z, w;
+        };
+
+        inline Vec4 makeVec4(float x, float y, float z, float w) { Vec4 v = {x, y, z, w}; return v; }
+        inline Vec4 toVec4(const cl_float4& v) { return makeVec4(v.s[0], v.s[1], v.s[2], v.s[3]); }
+        inline Vec4 operator+(const Vec4& a, const Vec4& b) { return makeVec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+        inline Vec4 operator-(const Vec4& a, const Vec4& b) { return makeVec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+        inline Vec4 operator*(const Vec4& a, const Vec4& b) { return makeVec4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+        inline Vec4 operator*(const Vec4& a, float s) { return makeVec4(a.x * s, a.y * s, a.z * s, a.w * s); }
+        inline Vec4 operator*(float s, const Vec4& a) { return a * s; }
+        inline Vec4 operator/(const Vec4& a, float s) { return makeVec4(a.x / s, a.y / s, a.z / s, a.w / s); }
+        inline Vec4 operator-(const Vec4& a) { return makeVec4(-a.x, -a.y, -a.z, -a.w); }
+        inline Vec4& operator+=(Vec4& a, const Vec4& b) { a = a + b; return a; }
+        inline Vec4& operator*=(Vec4& a, float s) { a = a * s; return a; }
+
+        inline float dot(const Vec4& a, const Vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+        inline float length(const Vec4& a) { return std::sqrt(dot(a, a)); }
+        inline Vec4 normalize(const Vec4& a) { return a / length(a); }
+        inline Vec4 cross(const Vec4& a, const Vec4& b) { return makeVec4(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x, 0.f); }
+        inline bool anyNan(const Vec4& a) { return std::isnan(a.x) || std::isnan(a.y) || std::isnan(a.z) || std::isnan(a.w); }
+
+        struct Ray
+        {
+            Vec4 origin;
+            Vec4 dir;
+            float length;
+            bool is_shadow_ray;
+        };
+
+        struct HitInfo
+        {
+            int triangle_ID, light_ID;
+            Vec4 hit_point;
+            Vec4 normal;
+        };
+
+        struct Quad
+        {
+            Vec4 pos;
+            Vec4 normal;
+            Vec4 ke;
+            Vec4 edge_l;
+            Vec4 edge_w;
+        };
+
+        const Quad light_source = { {-0.1979f, 0.92f, -3.1972f, 1.f},
+                                    {0.f, -1.f, 0.f, 0.f},
+                                    {16.f, 16.f, 16.f, 0.f},
+                                    {0.4f, 0.f, 0.f, 0.f},
+                                    {0.f, 0.f, 0.4f, 0.f}
+                                  };
+
+        const Vec4 BACKGROUND_COLOR = {0.4f, 0.4f, 0.4f, 1.0f};
+        const Vec4 PINK = {0.988f, 0.0588f, 0.7529f, 1.0f};
+
+        struct SceneRef
+        {
+            const TriangleGPU* scene_data;
+            const Material* mat_data;
+            const BVHNodeGPU* bvh;
+            int scene_size;
+            int bvh_size;
+
+            const Material& material(int triangle_ID) const { return mat_data[scene_data[triangle_ID].matID]; }
+        };
+
+        /* Ray data in the form used by the slab test. Computed once per traversal. */
+        struct BoxRay
+        {
+#ifdef YUNE_CPU_SSE
+            __m128 origin;
+            __m128 inv_dir;
+#else
+            float origin[3];
+            float inv_dir[3];
+#endif
+        };
+
+        inline float randomFloat(cl_uint* seed);
+        inline cl_uint wang_hash(cl_uint seed);
+        inline cl_uint xor_shift(cl_uint seed);
+
+        BoxRay makeBoxRay(const Ray& ray)
+        {
+            BoxRay box_ray;
+#ifdef YUNE_CPU_SSE
+            box_ray.origin = _mm_setr_ps(ray.origin.x, ray.origin.y, ray.origin.z, 0.f);
+            box_ray.inv_dir = _mm_div_ps(_mm_set1_ps(1.f), _mm_setr_ps(ray.dir.x, ray.dir.y, ray.dir.z, 1.f));
+#else
+            box_ray.origin[0] = ray.origin.x;
+            box_ray.origin[1] = ray.origin.y;
+            box_ray.origin[2] = ray.origin.z;
+            box_ray.inv_dir[0] = 1 / ray.dir.x;
+            box_ray.inv_dir[1] = 1 / ray.dir.y;
+            box_ray.inv_dir[2] = 1 / ray.dir.z;
+#endif
+            return box_ray;
+        }
+
+        /* Slab test of all 3 axes at once. Axes the ray runs parallel to while starting on the slab yield 0 * inf = NaN and are
+         * ignored like in the kernel. The w lane is always masked out.
+         */
+        bool rayAabbIntersection(const BoxRay& box_ray, const AABB& bb, float t_far)
+        {
+            float t_min, t_max;
+#ifdef YUNE_CPU_SSE
+            const __m128 xyz_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            const __m128 pos_inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            const __m128 neg_inf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bb.p_min.s), box_ray.origin), box_ray.inv_dir);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bb.p_max.s), box_ray.origin), box_ray.inv_dir);
+            __m128 valid = _mm_and_ps(_mm_cmpord_ps(t0, t1), xyz_mask);
+
+            __m128 near_t = _mm_or_ps(_mm_and_ps(valid, _mm_min_ps(t0, t1)), _mm_andnot_ps(valid, neg_inf));
+            __m128 far_t = _mm_or_ps(_mm_and_ps(valid, _mm_max_ps(t0, t1)), _mm_andnot_ps(valid, pos_inf));
+
+            near_t = _mm_max_ps(near_t, _mm_shuffle_ps(near_t, near_t, _MM_SHUFFLE(2, 3, 0, 1)));
+            near_t = _mm_max_ps(near_t, _mm_shuffle_ps(near_t, near_t, _MM_SHUFFLE(1, 0, 3, 2)));
+            far_t = _mm_min_ps(far_t, _mm_shuffle_ps(far_t, far_t, _MM_SHUFFLE(2, 3, 0, 1)));
+            far_t = _mm_min_ps(far_t, _mm_shuffle_ps(far_t, far_t, _MM_SHUFFLE(1, 0, 3, 2)));
+
+            t_min = _mm_cvtss_f32(near_t);
+            t_max = _mm_cvtss_f32(far_t);
+#else
+            t_min = -std::numeric_limits<float>::infinity();
+            t_max = std::numeric_limits<float>::infinity();
+            for(int i = 0; i < 3; i++)
+            {
+                float min_diff = (bb.p_min.s[i] - box_ray.origin[i]) * box_ray.inv_dir[i];
+                float max_diff = (bb.p_max.s[i] - box_ray.origin[i]) * box_ray.inv_dir[i];
+                if(std::isnan(min_diff) || std::isnan(max_diff))
+                    continue;
+                t_min = std::max(std::min(min_diff, max_diff), t_min);
+                t_max = std::min(std::max(min_diff, max_diff), t_max);
+            }
+#endif
+            return t_max > std::max(t_min, 0.0f) && t_min < t_far;
+        }
+
+        bool rayTriangleIntersection(Ray* ray, HitInfo* hit, const SceneRef& scene, int idx)
+        {
+            const TriangleGPU& tri = scene.scene_data[idx];
+            Vec4 v1 = toVec4(tri.v1);
+            Vec4 v1v2 = toVec4(tri.v2) - v1;
+            Vec4 v1v3 = toVec4(tri.v3) - v1;
+
+            Vec4 pvec = cross(ray->dir, v1v3);
+            float det = dot(v1v2, pvec);
+
+            float inv_det = 1.0f/det;
+            Vec4 dist = ray->origin - v1;
+            float u = dot(pvec, dist) * inv_det;
+
+            if(u < 0.0 || u > 1.0f)
+                return false;
+
+            Vec4 qvec = cross(dist, v1v2);
+            float v = dot(qvec, ray->dir) * inv_det;
+
+            if(v < 0.0 || u+v > 1.0)
+                return false;
+
+            float t = dot(v1v3, qvec) * inv_det;
+
+            if(t > 0 && t < ray->length)
+            {
+                ray->length = t;
+
+                Vec4 N1 = normalize(toVec4(tri.vn1));
+                Vec4 N2 = normalize(toVec4(tri.vn2));
+                Vec4 N3 = normalize(toVec4(tri.vn3));
+
+                float w = 1 - u - v;
+                hit->hit_point = ray->origin + ray->dir * t;
+                hit->normal = normalize(N1*w + N2*u + N3*v);
+
+                hit->triangle_ID = idx;
+                hit->light_ID = -1;
+                return true;
+            }
+            return false;
+        }
+
+        bool traverseBVH(Ray* ray, HitInfo* hit, const SceneRef& scene)
+        {
+            BoxRay box_ray = makeBoxRay(*ray);
+            bool intersect = false;
+
+            if(!rayAabbIntersection(box_ray, scene.bvh[0].aabb, ray->length))
+                return intersect;
+
+            int stack[STACK_SIZE];
+            int len = 0;
+            stack[len++] = 0;
+
+            while(len > 0)
+            {
+                const BVHNodeGPU& node = scene.bvh[stack[--len]];
+                if(node.child_idx == -1)
+                {
+                    for(int j = 0; j < node.vert_len; j++)
+                    {
+                        intersect |= rayTriangleIntersection(ray, hit, scene, node.vert_list[j]);
+                        //If shadow ray don't need to compute further intersections...
+                        if(ray->is_shadow_ray && intersect)
+                            return true;
+                    }
+                    continue;
+                }
+
+                for(int j = node.child_idx; j < node.child_idx + 2; j++)
+                {
+                    const BVHNodeGPU& child = scene.bvh[j];
+                    if((child.vert_len > 0 || child.child_idx > 0) && len < STACK_SIZE && rayAabbIntersection(box_ray, child.aabb, ray->length))
+                        stack[len++] = j;
+                }
+            }
+            return intersect;
+        }
+
+        bool traceRay(Ray* ray, HitInfo* hit, const SceneRef& scene)
+        {
+            bool flag = false;
+
+            float DdotN = dot(ray->dir, light_source.normal);
+            if(std::fabs(DdotN) > 0.0001)
+            {
+                float t = dot(light_source.normal, light_source.pos - ray->origin) / DdotN;
+                if(t > 0.0 && t < ray->length)
+                {
+                    Vec4 temp = (ray->origin + ray->dir * t) - light_source.pos;
+                    float la = length(light_source.edge_l);
+                    float lb = length(light_source.edge_w);
+
+                    // Projection of the vector from rectangle corner to hitpoint on the edges.
+                    float proj1 = dot(temp, light_source.edge_l) / la;
+                    float proj2 = dot(temp, light_source.edge_w) / lb;
+
+                    if((proj1 >= 0.0 && proj2 >= 0.0) && (proj1 <= la && proj2 <= lb))
+                    {
+                        ray->length = t;
+                        hit->hit_point = ray->origin + ray->dir * t;
+                        hit->light_ID = 0;
+                        hit->triangle_ID = -1;
+                        flag = true;
+                    }
+                }
+            }
+
+            //Traverse BVH if present, else brute force intersect all triangles...
+            if(scene.bvh_size > 0)
+                flag |= traverseBVH(ray, hit, scene);
+            else
+            {
+                for(int i = 0; i < scene.scene_size; i++)
+                    flag |= rayTriangleIntersection(ray, hit, scene, i);
+            }
+            return flag;
+        }
+
+        Vec4 reflect(const Vec4& w_i, const HitInfo& hit_info)
+        {
+            Vec4 normal = hit_info.normal;
+            if(dot(w_i, normal) < 0)
+                normal = -normal;
+
+            return normalize(2*(dot(w_i, normal)) * normal - w_i);
+        }
+
+        Vec4 refract(const Vec4& w_i, const HitInfo& hit_info, const SceneRef& scene)
+        {
+            Vec4 normal = hit_info.normal;
+            float n1, n2;
+            float ior = scene.material(hit_info.triangle_ID).n;
+
+            if(dot(w_i, normal) < 0)
+            {
+                n1 = ior;
+                n2 = 1;
+                normal = -normal;
+            }
+            else
+            {
+                n1 = 1;
+                n2 = ior;
+            }
+
+            Vec4 wt_perp = n1/n2 * (dot(w_i, normal) * normal - w_i);
+            Vec4 wt_parallel = std::sqrt(1 - length(wt_perp) * length(wt_perp)) * -normal;
+            return normalize(wt_perp + wt_parallel);
+        }
+
+        float evalFresnelReflectance(const Vec4& w_i, const HitInfo& hit_info, float* ior_factor, const SceneRef& scene)
+        {
+            Vec4 normal = hit_info.normal;
+            const Material& mat = scene.material(hit_info.triangle_ID);
+            float n1, n2;
+
+            if(dot(w_i, normal) < 0)
+            {
+                n1 = mat.n;
+                n2 = 1;
+                normal = -normal;
+            }
+            else
+            {
+                n1 = 1;
+                n2 = mat.n;
+            }
+
+            float cosThetaI = dot(w_i, normal);
+            float sinThetaI = std::sqrt(1 - cosThetaI*cosThetaI);
+            float sinThetaT = n1 * sinThetaI / n2;
+            float cosThetaT = std::sqrt(1 - sinThetaT*sinThetaT);
+
+            if(sinThetaT >= 1.0f && n1 > n2)
+                return 1.0f;
+
+            float r0 = (mat.ks.s[0] + mat.ks.s[1] + mat.ks.s[2]) / 3.0f;
+            *ior_factor = (n2*n2) / (n1*n1);
+            if(n1 > n2)
+                return (r0 + (1-r0) * (1 - std::pow(cosThetaI, 5.0f)));
+            else
+                return (r0 + (1-r0) * (1 - std::pow(cosThetaT, 5.0f)));
+        }
+
+        /* Build an orthonormal basis around Nz and transform the direction (x, y, z) from it into world space. */
+        Vec4 toWorld(const Vec4& Nz, float x, float y, float z)
+        {
+            Vec4 Nx;
+            if(std::fabs(Nz.y) > std::fabs(Nz.z))
+                Nx = makeVec4(Nz.y, -Nz.x, 0, 0.f);
+            else
+                Nx = makeVec4(Nz.z, 0, -Nz.x, 0.f);
+
+            Nx = normalize(Nx);
+            Vec4 Ny = normalize(cross(Nz, Nx));
+
+            Vec4 dir = makeVec4(Nx.x*x + Ny.x*y + Nz.x*z, Nx.y*x + Ny.y*y + Nz.y*z, Nx.z*x + Ny.z*y + Nz.z*z, 0);
+            return normalize(dir);
+        }
+
+        void phongSampleHemisphere(Ray* ray, float* pdf, const Vec4& w_i, const HitInfo& hit_info, cl_uint* seed, const SceneRef& scene)
+        {
+            Vec4 Nz = reflect(w_i, hit_info);
+
+            float r1 = randomFloat(seed);
+            float r2 = randomFloat(seed);
+
+            const Material& mat = scene.material(hit_info.triangle_ID);
+            int phong_exponent = mat.px + mat.py;
+
+            float phi = 2*PI * r2;
+            float costheta = std::pow(r1, 1.0f/(phong_exponent+1));
+            float sintheta = std::sqrt(1 - std::pow(r1, 2.0f/(phong_exponent+1)));
+
+            ray->dir = toWorld(Nz, sintheta * std::cos(phi), sintheta * std::sin(phi), costheta);
+            ray->origin = hit_info.hit_point + ray->dir * EPSILON;
+            ray->is_shadow_ray = false;
+            ray->length = std::numeric_limits<float>::infinity();
+
+            //If a ray was sampled in the lower hemisphere, set pdf = 0
+            if(dot(ray->dir, hit_info.normal) < 0)
+                *pdf = 0;
+            else
+                *pdf = (phong_exponent+1) * 0.5 * INV_PI * std::pow(costheta, phong_exponent);
+        }
+
+        void cosineWeightedHemisphere(Ray* ray, float* pdf, const HitInfo& hit_info, cl_uint* seed)
+        {
+            float r1 = randomFloat(seed);
+            float r2 = randomFloat(seed);
+
+            float phi = 2 * PI * r2;
+            float sinTheta = std::sqrt(r1);
+            float z = std::sqrt(1-r1);
+
+            ray->dir = toWorld(hit_info.normal, sinTheta * std::cos(phi), sinTheta * std::sin(phi), z);
+            ray->origin = hit_info.hit_point + ray->dir * EPSILON;
+            ray->is_shadow_ray = false;
+            ray->length = std::numeric_limits<float>::infinity();
+
+            *pdf = z * INV_PI;
+        }
+
+        void sampleFresnelIncidence(Ray* ray, const HitInfo& hit_info, const Vec4& w_i, float* ior_factor, cl_uint* seed, const SceneRef& scene)
+        {
+            if(scene.material(hit_info.triangle_ID).is_transmissive)
+            {
+                float pdf = evalFresnelReflectance(w_i, hit_info, ior_factor, scene);
+                if(pdf == 1.0)
+                {
+                    ray->dir = reflect(w_i, hit_info);
+                    *ior_factor = 1.0f;
+                }
+                else
+                {
+                    float r = randomFloat(seed);
+                    if(r < pdf)
+                    {
+                        ray->dir = reflect(w_i, hit_info);
+                        *ior_factor = 1.0f;
+                    }
+                    else
+                        ray->dir = refract(w_i, hit_info, scene);
+                }
+            }
+            else
+            {
+                *ior_factor = 1.0f;
+                ray->dir = reflect(w_i, hit_info);
+            }
+            ray->length = std::numeric_limits<float>::infinity();
+            ray->is_shadow_ray = false;
+            ray->origin = hit_info.hit_point + ray->dir * EPSILON;
+        }
+
+        bool sampleGlossyPdf(const HitInfo& hit, const SceneRef& scene, cl_uint* seed, float* prob)
+        {
+            float r = randomFloat(seed);
+
+            const Material& mat = scene.material(hit.triangle_ID);
+            Vec4 ks = toVec4(mat.ks);
+            Vec4 kd = toVec4(mat.kd);
+
+            if(ks.x*ks.x + ks.y*ks.y + ks.z*ks.z == 0.0f)
+            {
+                *prob = 1.0f;
+                return false;
+            }
+            else if(kd.x*kd.x + kd.y*kd.y + kd.z*kd.z == 0.0f || kd.x + kd.y + kd.z == 0.0f)
+            {
+                *prob = 1.0f;
+                return true;
+            }
+
+            Vec4 sum = ks + kd;
+            float max_val = std::max(sum.x, std::max(sum.y, sum.z));
+            float pd, ps;
+
+            if(max_val == sum.x)
+            {
+                pd = kd.x;
+                ps = ks.x;
+            }
+            else if(max_val == sum.y)
+            {
+                pd = kd.y;
+                ps = ks.y;
+            }
+            else
+            {
+                pd = kd.z;
+                ps = ks.z;
+            }
+
+            if(r < pd)
+            {
+                *prob = pd;
+                return false;
+            }
+            else if(r < pd + ps && r >= pd)
+            {
+                *prob = ps;
+                return true;
+            }
+            *prob = 0;
+            return false;
+        }
+
+        Vec4 evaluateBRDF(const Vec4& w_i, const Vec4& w_o, const HitInfo& hit_info, bool sample_glossy, float rr_prob, const SceneRef& scene)
+        {
+            const Material& mat = scene.material(hit_info.triangle_ID);
+            if(!sample_glossy)
+                return toVec4(mat.kd) * INV_PI / rr_prob;
+
+            Vec4 refl_vec = reflect(w_i, hit_info);
+            float cos_alpha = std::pow(std::max(dot(w_o, refl_vec), 0.0f), mat.px + mat.py);
+            int phong_exp = mat.px + mat.py;
+            return toVec4(mat.ks) * cos_alpha * (phong_exp + 2) * INV_PI * 0.5f / rr_prob;
+        }
+
+        int sampleLights(const HitInfo& hit_info, float* light_pdf, Vec4* w_i, cl_uint* seed)
+        {
+            float r1 = randomFloat(seed);
+            float r2 = randomFloat(seed);
+
+            Vec4 temp_wi = (light_source.pos + r1*light_source.edge_l + r2*light_source.edge_w) - hit_info.hit_point;
+            float distance = dot(temp_wi, temp_wi);
+
+            *w_i = temp_wi;
+            temp_wi = normalize(temp_wi);
+
+            float cosine_falloff = std::max(dot(temp_wi, hit_info.normal), 0.0f) * std::max(dot(-temp_wi, light_source.normal), 0.0f);
+            if(cosine_falloff <= 0.0)
+                return -1;
+
+            float area = length(light_source.edge_l) * length(light_source.edge_w);
+            *light_pdf = 1/area;
+            *light_pdf *= distance / std::max(dot(-temp_wi, light_source.normal), 0.0f);
+            return 0;
+        }
+
+        Vec4 evaluateDirectLighting(const Vec4& w_o, const HitInfo& hit, cl_uint* seed, const SceneRef& scene)
+        {
+            Vec4 emission = toVec4(scene.material(hit.triangle_ID).ke);
+            Vec4 light_sample = makeVec4(0.f, 0.f, 0.f, 0.f);
+            Vec4 w_i;
+            float light_pdf, brdf_prob = 0.0f;
+
+            int j = sampleLights(hit, &light_pdf, &w_i, seed);
+            if(j == -1 || light_pdf <= 0.0f)
+                return emission;
+
+            float len = length(w_i) - EPSILON*1.5f;
+            w_i = normalize(w_i);
+
+            Ray shadow_ray = {hit.hit_point + w_i * EPSILON, w_i, len, true};
+            HitInfo shadow_hitinfo = {-1, -1, makeVec4(0,0,0,1), makeVec4(0,0,0,0)};
+
+            //If ray doesn't hit anything the light source is visible.
+            if(!traceRay(&shadow_ray, &shadow_hitinfo, scene))
+            {
+                bool sample_glossy = sampleGlossyPdf(hit, scene, seed, &brdf_prob);
+                if(brdf_prob == 0.0f)
+                    return emission;
+                light_sample = evaluateBRDF(w_i, w_o, hit, sample_glossy, brdf_prob, scene) * light_source.ke * std::max(dot(w_i, hit.normal), 0.0f);
+                light_sample *= 1/light_pdf;
+            }
+            return light_sample + emission;
+        }
+
+        float getYluminance(const Vec4& color)
+        {
+            return 0.212671f*color.x + 0.715160f*color.y + 0.072169f*color.z;
+        }
+
+        Vec4 shading(Ray ray, bool gi_check, cl_uint* seed, const SceneRef& scene)
+        {
+            HitInfo hit_info = {-1, -1, makeVec4(0,0,0,1), makeVec4(0,0,0,0)};
+
+            if(!traceRay(&ray, &hit_info, scene))
+                return BACKGROUND_COLOR;
+
+            if(hit_info.light_ID >= 0)
+            {
+                if(dot(ray.dir, light_source.normal) < 0)
+                    return makeVec4(1,1,1,1);
+                else
+                    return makeVec4(0.1,.1,.1,1);
+            }
+
+            Vec4 throughput = makeVec4(1.f, 1.f, 1.f, 1.f);
+            Vec4 direct_color = makeVec4(0.f, 0.f, 0.f, 0.f);
+            Vec4 indirect_color = direct_color;
+
+            // Compute Direct Illumination at the first hitpoint.
+            const Material* mat = &scene.material(hit_info.triangle_ID);
+            if(!mat->is_specular)
+                direct_color = evaluateDirectLighting(-ray.dir, hit_info, seed, scene);
+
+            if(!gi_check)
+                return direct_color;
+
+            for(int i = 0; i < 100000; i++)
+            {
+                HitInfo new_hitinfo = {-1, -1, makeVec4(0,0,0,1), makeVec4(0,0,0,0)};
+                Ray new_ray;
+                float pdf = 1, brdf_prob = 0.0f, ior_factor = 1.0f;
+                bool is_glossy = false;
+                if(mat->is_specular)
+                    sampleFresnelIncidence(&new_ray, hit_info, -ray.dir, &ior_factor, seed, scene);
+                else
+                {
+                    is_glossy = sampleGlossyPdf(hit_info, scene, seed, &brdf_prob);
+                    if(brdf_prob == 0.0f)
+                        break;
+
+                    if(is_glossy)
+                        phongSampleHemisphere(&new_ray, &pdf, -ray.dir, hit_info, seed, scene);
+                    else
+                        cosineWeightedHemisphere(&new_ray, &pdf, hit_info, seed);
+                }
+
+                // If GI_ray hits nothing, pdf is zero or it hits the light source the path ends. Specular surfaces account for the light.
+                if(pdf <= 0.0f || !traceRay(&new_ray, &new_hitinfo, scene) || new_hitinfo.light_ID >= 0)
+                {
+                    if(mat->is_specular && new_hitinfo.light_ID >= 0)
+                        indirect_color += throughput * light_source.ke;
+                    break;
+                }
+
+                indirect_color += throughput * toVec4(scene.material(new_hitinfo.triangle_ID).ke);
+
+                if(mat->is_specular)
+                    throughput = throughput * ior_factor;
+                else
+                    throughput = throughput * evaluateBRDF(new_ray.dir, -ray.dir, hit_info, is_glossy, brdf_prob, scene) * std::max(dot(new_ray.dir, hit_info.normal), 0.0f) / pdf;
+
+                // Russian Roulette after a few bounces.
+                if(i > RR_THRESHOLD)
+                {
+                    float p = std::min(getYluminance(throughput), 0.95f);
+                    float r = randomFloat(seed);
+                    if(r >= p)
+                        break;
+                    throughput *= 1/p;
+                }
+
+                mat = &scene.material(new_hitinfo.triangle_ID);
+                if(!mat->is_specular)
+                    indirect_color += throughput * evaluateDirectLighting(-new_ray.dir, new_hitinfo, seed, scene);
+                hit_info = new_hitinfo;
+                ray = new_ray;
+            }
+            return direct_color + indirect_color;
+        }
+
+        Ray createRay(float pixel_x, float pixel_y, int img_width, int img_height, const Cam& cam)
+        {
+            float aspect_ratio = (img_width*1.0)/img_height;
+            Vec4 dir = makeVec4(aspect_ratio * ((2.0 * pixel_x/img_width) - 1), (2.0 * pixel_y/img_height) - 1, -cam.view_plane_dist, 0);
+
+            Ray eye_ray;
+            eye_ray.dir = normalize(makeVec4(dot(toVec4(cam.r1), dir), dot(toVec4(cam.r2), dir), dot(toVec4(cam.r3), dir), dot(toVec4(cam.r4), dir)));
+            eye_ray.origin = makeVec4(cam.r1.s[3], cam.r2.s[3], cam.r3.s[3], cam.r4.s[3]);
+            eye_ray.is_shadow_ray = false;
+            eye_ray.length = std::numeric_limits<float>::infinity();
+            return eye_ray;
+        }
+
+        inline float randomFloat(cl_uint* seed)
+        {
+            *seed = xor_shift(*seed);
+            return *seed / (float) UINT_MAX;
+        }
+
+        inline cl_uint wang_hash(cl_uint seed)
+        {
+            seed = (seed ^ 61) ^ (seed >> 16);
+            seed *= 9;
+            seed = seed ^ (seed >> 4);
+            seed *= 0x27d4eb2d;
+            seed = seed ^ (seed >> 15);
+            return seed;
+        }
+
+        inline cl_uint xor_shift(cl_uint seed)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return seed;
+        }
+    }
+
+    CPURenderer::CPURenderer()
+    {
+        vert_data = NULL;
+        mat_data = NULL;
+        bvh = NULL;
+        width = height = tiles_x = num_tiles = 0;
+        tile_size = 32;
+        frame_id = 0;
+        frame_ms = 0;
+        frame_done = true;
+        quit = false;
+        next_tile = 0;
+        tiles_left = 0;
+        //ctor
+    }
+
+    CPURenderer::~CPURenderer()
+    {
+        stopWorkers();
+    }
+
+    void CPURenderer::setFrameCompletedCb(std::function<void()> cb)
+    {
+        frameCompletedCb = cb;
+    }
+
+    void CPURenderer::setScene(const std::vector<TriangleGPU>* vert_data, const std::vector<Material>* mat_data, const std::vector<BVHNodeGPU>* bvh)
+    {
+        waitForFrame();
+        this->vert_data = vert_data;
+        this->mat_data = mat_data;
+        this->bvh = bvh;
+    }
+
+    void CPURenderer::setup(int width, int height, int num_threads)
+    {
+        stopWorkers();
+
+        this->width = width;
+        this->height = height;
+        tile_size = std::max(tile_size, 1);
+        tiles_x = (width + tile_size - 1) / tile_size;
+        num_tiles = tiles_x * ((height + tile_size - 1) / tile_size);
+        accum_image.assign(width * height * 4, 0.0f);
+        display_image.assign(width * height * 4, 0.0f);
+
+        if(num_threads <= 0)
+            num_threads = std::max((int) std::thread::hardware_concurrency(), 1);
+        for(int i = 0; i < num_threads; i++)
+            workers.push_back(std::thread(&CPURenderer::workerLoop, this));
+    }
+
+    void CPURenderer::stopWorkers()
+    {
+        waitForFrame();
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            quit = true;
+        }
+        pool_cv.notify_all();
+        for(std::thread& worker : workers)
+            worker.join();
+        workers.clear();
+        quit = false;
+    }
+
+    void CPURenderer::startFrame(const Cam& cam, bool gi_check, bool reset, cl_uint rand, int spp, bool tonemap)
+    {
+        waitForFrame();
+        if(num_tiles == 0 || workers.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            params.cam = cam;
+            params.gi_check = gi_check;
+            params.reset = reset;
+            params.tonemap = tonemap;
+            params.rand = rand;
+            params.spp = std::max(spp, 1);
+            frame_done = false;
+            frame_start = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            tiles_left = num_tiles;
+            next_tile = 0;
+            frame_id++;
+        }
+        pool_cv.notify_all();
+    }
+
+    bool CPURenderer::isFrameDone()
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        return frame_done;
+    }
+
+    void CPURenderer::waitForFrame()
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        done_cv.wait(lock, [this]{ return frame_done; });
+    }
+
+    const std::vector<cl_float>& CPURenderer::getDisplayImage()
+    {
+        return display_image;
+    }
+
+    void CPURenderer::workerLoop()
+    {
+        unsigned long last_frame = 0;
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        while(true)
+        {
+            pool_cv.wait(lock, [&]{ return quit || frame_id != last_frame; });
+            if(quit)
+                return;
+            last_frame = frame_id;
+            lock.unlock();
+
+            // Tiles are handed out one at a time so threads that finish early keep taking work until the frame runs out.
+            int tile;
+            while((tile = next_tile.fetch_add(1)) < num_tiles)
+            {
+                renderTile(tile);
+                if(tiles_left.fetch_sub(1) == 1)
+                {
+                    double now = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                    {
+                        std::lock_guard<std::mutex> done_lock(pool_mutex);
+                        frame_ms = now - frame_start;
+                        frame_done = true;
+                    }
+                    done_cv.notify_all();
+                    if(frameCompletedCb)
+                        frameCompletedCb();
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    void CPURenderer::renderTile(int tile)
+    {
+        YUNE_TRACE_SCOPE("cpu", "Render Tile");
+        SceneRef scene;
+        scene.scene_data = vert_data ? vert_data->data() : NULL;
+        scene.mat_data = mat_data ? mat_data->data() : NULL;
+        scene.bvh = bvh ? bvh->data() : NULL;
+        scene.scene_size = vert_data ? vert_data->size() : 0;
+        scene.bvh_size = bvh ? bvh->size() : 0;
+
+        int x0 = (tile % tiles_x) * tile_size;
+        int y0 = (tile / tiles_x) * tile_size;
+        int x1 = std::min(x0 + tile_size, width);
+        int y1 = std::min(y0 + tile_size, height);
+        int spp = params.spp;
+
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x++)
+            {
+                cl_uint seed = (y+1) * width + (x+1);
+                seed = params.rand * seed;
+                seed = wang_hash(seed);
+                //Since wang_hash can returns 0 and Xor Shift cant handle 0.
+                if(seed == 0)
+                    seed = wang_hash(seed);
+
+                Vec4 sum = makeVec4(0.f, 0.f, 0.f, 0.f);
+                for(int s = 0; s < spp; s++)
+                {
+                    float r1 = randomFloat(&seed);
+                    float r2 = randomFloat(&seed);
+                    Vec4 color = shading(createRay(x + r1, y + r2, width, height, params.cam), params.gi_check, &seed, scene);
+                    if(anyNan(color))
+                        color = PINK;
+                    sum += color;
+                }
+                Vec4 color = sum / spp;
+
+                cl_float* accum = &accum_image[(y * width + x) * 4];
+                if(params.reset)
+                    color.w = spp;
+                else
+                {
+                    int num_passes = accum[3];
+                    Vec4 prev_color = makeVec4(accum[0], accum[1], accum[2], accum[3]);
+                    color = (color * spp) + (prev_color * num_passes);
+                    color = color / (num_passes + spp);
+                    color.w = num_passes + spp;
+                }
+                accum[0] = color.x;
+                accum[1] = color.y;
+                accum[2] = color.z;
+                accum[3] = color.w;
+
+                // Reinhard tonemapping followed by gamma correction, same as kernels/post-proc/tonemap.cl.
+                if(params.tonemap)
+                {
+                    const float lum_white = 1.0f;
+                    float lum_world = getYluminance(color) + 0.001f;
+                    float lum_display = lum_world * (1 + lum_world/(lum_white * lum_white)) / (1 + lum_world);
+                    color = color * (lum_display / lum_world);
+                    color = makeVec4(std::pow(color.x, 1/2.2f), std::pow(color.y, 1/2.2f), std::pow(color.z, 1/2.2f), 1.0f);
+                }
+
+                cl_float* display = &display_image[(y * width + x) * 4];
+                display[0] = color.x;
+                display[1] = color.y;
+                display[2] = color.z;
+                display[3] = color.w;
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ConvergenceEstimator.h"
+#include "Tracer.h"
+
+namespace yune
+{
+    ConvergenceEstimator::ConvergenceEstimator(CLManager& cl_manager) : cl_manager(cl_manager)
+    {
+        snapshot_samples = 0;
+        frames_since_error = 0;
+        error_event = NULL;
+        error_estimate = -1.0f;
+    }
+
+    void ConvergenceEstimator::setup(int width, int height)
+    {
+        int group = CLManager::ERROR_GROUP_SIZE;
+        error_sums.resize(((width + group - 1) / group) * ((height + group - 1) / group));
+    }
+
+    void ConvergenceEstimator::evaluate(cl_mem image, int width, int height, unsigned long samples, int interval)
+    {
+        // Each pixel is scaled by it's own sample counts, which differ under adaptive sampling.
+        frames_since_error++;
+        bool estimate = snapshot_samples > 0 && !error_event && frames_since_error >= interval && 4 * (samples - snapshot_samples) >= snapshot_samples;
+        bool snapshot = snapshot_samples == 0 || (estimate && samples >= 2 * snapshot_samples);
+        if(!estimate && !snapshot)
+            return;
+
+        YUNE_TRACE_SCOPE("cl", "Evaluate Convergence");
+        cl_int err = 0;
+        if(estimate)
+        {
+            err  = clSetKernelArg(cl_manager.error_kernel, 0, sizeof(cl_mem), &image);
+            err |= clSetKernelArg(cl_manager.error_kernel, 1, sizeof(cl_mem), &cl_manager.snapshot_image);
+            err |= clSetKernelArg(cl_manager.error_kernel, 2, sizeof(cl_mem), &cl_manager.error_sum_buffer);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+            size_t group = CLManager::ERROR_GROUP_SIZE;
+            size_t lws[2] = {group, group};
+            size_t gws[2] = {(width + group - 1) / group * group, (height + group - 1) / group * group};
+            err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.error_kernel, 2, NULL, gws, lws, 0, NULL, NULL);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+            err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.error_sum_buffer, CL_FALSE, 0, error_sums.size() * sizeof(cl_float2),
+                                      error_sums.data(), 0, NULL, &error_event);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            frames_since_error = 0;
+        }
+
+        if(snapshot)
+        {
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {(size_t) width, (size_t) height, 1};
+            err = clEnqueueCopyImage(cl_manager.comm_queue, image, cl_manager.snapshot_image, origin, origin, region, 0, NULL, NULL);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            snapshot_samples = samples;
+        }
+        clFlush(cl_manager.comm_queue);
+    }
+
+    void ConvergenceEstimator::poll()
+    {
+        if(!error_event)
+            return;
+        cl_int status;
+        clGetEventInfo(error_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        if(status != CL_COMPLETE)
+            return;
+        Tracer::deviceEvent("device", "Read Convergence Error", error_event);
+        clReleaseEvent(error_event);
+        error_event = NULL;
+
+        // Only pixels that were sampled since the snapshot are averaged. If there's none, the last estimate stands.
+        double sum = 0, pixels = 0;
+        for(const cl_float2& s : error_sums)
+        {
+            sum += s.s[0];
+            pixels += s.s[1];
+        }
+        if(pixels > 0)
+            error_estimate = sum / pixels;
+    }
+
+    void ConvergenceEstimator::reset()
+    {
+        if(error_event)
+        {
+            clWaitForEvents(1, &error_event);
+            clReleaseEvent(error_event);
+            error_event = NULL;
+        }
+        snapshot_samples = 0;
+        frames_since_error = 0;
+        error_estimate = -1.0f;
+    }
+
+    void ConvergenceEstimator::release()
+    {
+        if(error_event)
+            clReleaseEvent(error_event);
+        error_event = NULL;
+    }
+
+    float ConvergenceEstimator::getError() const
+    {
+        return error_estimate;
+    }
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ExposureMeter.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace yune
+{
+    ExposureMeter::ExposureMeter(CLManager& cl_manager) : cl_manager(cl_manager)
+    {
+        pixels = 1;
+        read_event = NULL;
+        reset();
+    }
+
+    void ExposureMeter::setup(int width, int height)
+    {
+        int group = CLManager::LUMINANCE_GROUP_SIZE;
+        luminance_stats.resize(((width + group - 1) / group) * ((height + group - 1) / group));
+        luminance_histogram.resize(CLManager::LUMINANCE_BINS);
+        pixels = std::max(width * height, 1);
+    }
+
+    void ExposureMeter::enqueueReduction(cl_mem image, const size_t gws[2], cl_event* event)
+    {
+        if(read_event)
+            return;
+
+        YUNE_TRACE_SCOPE("cl", "Enqueue Luminance Reduction");
+        cl_int err = 0;
+        cl_uint zero = 0;
+        err = clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.histogram_buffer, &zero, sizeof(cl_uint), 0, CLManager::LUMINANCE_BINS * sizeof(cl_uint), 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        err  = clSetKernelArg(cl_manager.luminance_kernel, 0, sizeof(cl_mem), &image);
+        err |= clSetKernelArg(cl_manager.luminance_kernel, 1, sizeof(cl_mem), &cl_manager.luminance_stats_buffer);
+        err |= clSetKernelArg(cl_manager.luminance_kernel, 2, sizeof(cl_mem), &cl_manager.histogram_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        size_t group = CLManager::LUMINANCE_GROUP_SIZE;
+        size_t lws[2] = {group, group};
+        size_t group_gws[2] = {(gws[0] + group - 1) / group * group, (gws[1] + group - 1) / group * group};
+        err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.luminance_kernel, 2, NULL, group_gws, lws, 0, NULL, event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        err  = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.luminance_stats_buffer, CL_FALSE, 0, luminance_stats.size() * sizeof(cl_float2),
+                                   luminance_stats.data(), 0, NULL, NULL);
+        err |= clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.histogram_buffer, CL_FALSE, 0, luminance_histogram.size() * sizeof(cl_uint),
+                                   luminance_histogram.data(), 0, NULL, &read_event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    void ExposureMeter::poll(float key, float adapt_time, bool histogram, float white_percentile, double now)
+    {
+        if(!read_event)
+            return;
+        cl_int status;
+        clGetEventInfo(read_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        if(status != CL_COMPLETE)
+            return;
+        Tracer::deviceEvent("device", "Read Luminance", read_event);
+        clReleaseEvent(read_event);
+        read_event = NULL;
+
+        double log_sum = 0;
+        float max_lum = 0;
+        for(const cl_float2& stats : luminance_stats)
+        {
+            log_sum += stats.s[0];
+            max_lum = std::max(max_lum, stats.s[1]);
+        }
+        float log_average = std::exp(log_sum / pixels);
+
+        // The upper edge of the bin the percentile falls in. A few fireflies then don't darken the whole image.
+        float white = max_lum;
+        if(histogram)
+        {
+            double threshold = pixels * std::min(std::max(white_percentile, 0.0f), 1.0f);
+            double count = 0;
+            for(int i = 0; i < CLManager::LUMINANCE_BINS; i++)
+            {
+                count += luminance_histogram[i];
+                if(count >= threshold)
+                {
+                    float bin_width = (float) (CLManager::LUMINANCE_LOG2_MAX - CLManager::LUMINANCE_LOG2_MIN) / CLManager::LUMINANCE_BINS;
+                    white = std::min(white, std::exp2(CLManager::LUMINANCE_LOG2_MIN + (i + 1) * bin_width));
+                    break;
+                }
+            }
+        }
+        float target = key / std::max(log_average, 1e-4f);
+        white = std::max(white, 1e-4f);
+
+        // Exponential smoothing in log space, so brightening and darkening by the same factor take equally long.
+        if(!exposure_valid)
+        {
+            exposure_scale = target;
+            white_luminance = white;
+        }
+        else
+        {
+            float blend = 1.0f - std::exp(-(now - exposure_time) / std::max(adapt_time, 1e-3f));
+            exposure_scale = std::exp(std::log(exposure_scale) + (std::log(target) - std::log(exposure_scale)) * blend);
+            white_luminance = std::exp(std::log(white_luminance) + (std::log(white) - std::log(white_luminance)) * blend);
+        }
+        exposure_time = now;
+        exposure_valid = true;
+    }
+
+    void ExposureMeter::reset()
+    {
+        exposure_scale = white_luminance = 1.0f;
+        exposure_valid = false;
+        exposure_time = 0;
+    }
+
+    void ExposureMeter::release()
+    {
+        if(read_event)
+            clReleaseEvent(read_event);
+        read_event = NULL;
+    }
+
+    float ExposureMeter::getScale() const
+    {
+        return exposure_scale;
+    }
+
+    float ExposureMeter::getWhitePoint() const
+    {
+        // Reinhard's curve needs the white point at 1 or above.
+        return std::max(white_luminance * exposure_scale, 1.0f);
+    }
+}
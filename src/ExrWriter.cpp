@@ -0,0 +1,246 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ExrWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdint.h>
+#include <thread>
+
+// Defined with the rest of stb_image_write in RendererCore.cpp, but not declared by the header.
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+namespace yune
+{
+    /* Everything is written in the host's byte order. The format is little endian, like every platform Yune builds on. */
+    namespace
+    {
+        const int LINES_PER_BLOCK = 16;     // Fixed by ZIP_COMPRESSION.
+        const unsigned char ZIP_COMPRESSION = 3;
+        const int PIXEL_TYPE_HALF = 1, PIXEL_TYPE_FLOAT = 2;
+
+        // Round to nearest even. Values beyond the half range become infinity, NaNs stay NaNs.
+        uint16_t floatToHalf(float value)
+        {
+            const uint32_t f32_infinity = 255u << 23, f16_max = (127u + 16) << 23, denorm_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+            uint32_t f;
+            std::memcpy(&f, &value, sizeof(f));
+            uint32_t sign = f & 0x80000000u;
+            f ^= sign;
+
+            uint16_t h;
+            if(f >= f16_max)
+                h = f > f32_infinity ? 0x7e00 : 0x7c00;
+            else if(f < (113u << 23))
+            {
+                // Let the FPU do the rounding of denormals by adding a number whose exponent aligns the mantissa.
+                float tmp, magic;
+                std::memcpy(&tmp, &f, sizeof(f));
+                std::memcpy(&magic, &denorm_magic, sizeof(magic));
+                tmp += magic;
+                std::memcpy(&f, &tmp, sizeof(f));
+                h = f - denorm_magic;
+            }
+            else
+            {
+                uint32_t mant_odd = (f >> 13) & 1;
+                f += ((uint32_t) (15 - 127) << 23) + 0xfff;
+                f += mant_odd;
+                h = f >> 13;
+            }
+            return h | (sign >> 16);
+        }
+
+        template<typename T>
+        void append(std::vector<unsigned char>& out, const T& value)
+        {
+            const unsigned char* bytes = (const unsigned char*) &value;
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        void appendString(std::vector<unsigned char>& out, const std::string& str)
+        {
+            out.insert(out.end(), str.begin(), str.end());
+            out.push_back(0);
+        }
+
+        void appendAttribute(std::vector<unsigned char>& out, const std::string& name, const std::string& type, const std::vector<unsigned char>& value)
+        {
+            appendString(out, name);
+            appendString(out, type);
+            append(out, (int32_t) value.size());
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        /* ZIP blocks hold the bytes of a block split into even and odd ones, delta encoded and deflated. If deflating doesn't help,
+         * the raw bytes are stored, which readers recognize by the size.
+         */
+        std::vector<unsigned char> compressBlock(const std::vector<unsigned char>& raw)
+        {
+            std::vector<unsigned char> tmp(raw.size());
+            size_t half = (raw.size() + 1) / 2;
+            for(size_t i = 0; i < raw.size(); i++)
+                tmp[(i % 2 == 0) ? i / 2 : half + i / 2] = raw[i];
+
+            int prev = tmp.empty() ? 0 : tmp[0];
+            for(size_t i = 1; i < tmp.size(); i++)
+            {
+                int value = tmp[i];
+                tmp[i] = (unsigned char) (value - prev + (128 + 256));
+                prev = value;
+            }
+
+            int packed_size = 0;
+            unsigned char* packed = stbi_zlib_compress(tmp.data(), (int) tmp.size(), &packed_size, 5);
+            if(!packed || packed_size >= (int) raw.size())
+            {
+                std::free(packed);
+                return raw;
+            }
+            std::vector<unsigned char> result(packed, packed + packed_size);
+            std::free(packed);
+            return result;
+        }
+    }
+
+    bool ExrWriter::write(const std::string& filename, int width, int height, std::vector<Channel> channels, int num_threads)
+    {
+        if(width <= 0 || height <= 0 || channels.empty())
+            return false;
+        std::sort(channels.begin(), channels.end(), [](const Channel& a, const Channel& b){ return a.name < b.name; });
+        size_t pixel_size = 0;
+        for(const Channel& channel : channels)
+            pixel_size += channel.half ? 2 : 4;
+
+        std::vector<unsigned char> header, value;
+        append(header, (int32_t) 20000630);     // Magic number
+        append(header, (int32_t) 2);            // Version 2, single part scanline image
+
+        for(const Channel& channel : channels)
+        {
+            appendString(value, channel.name);
+            append(value, (int32_t) (channel.half ? PIXEL_TYPE_HALF : PIXEL_TYPE_FLOAT));
+            append(value, (int32_t) 0);         // pLinear and reserved bytes
+            append(value, (int32_t) 1);         // x sampling
+            append(value, (int32_t) 1);         // y sampling
+        }
+        value.push_back(0);
+        appendAttribute(header, "channels", "chlist", value);
+
+        appendAttribute(header, "compression", "compression", std::vector<unsigned char>(1, ZIP_COMPRESSION));
+
+        value.clear();
+        for(int32_t coord : {0, 0, width - 1, height - 1})
+            append(value, coord);
+        appendAttribute(header, "dataWindow", "box2i", value);
+        appendAttribute(header, "displayWindow", "box2i", value);
+
+        appendAttribute(header, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0));
+
+        value.clear();
+        append(value, 1.0f);
+        appendAttribute(header, "pixelAspectRatio", "float", value);
+        appendAttribute(header, "screenWindowWidth", "float", value);
+
+        value.clear();
+        append(value, 0.0f);
+        append(value, 0.0f);
+        appendAttribute(header, "screenWindowCenter", "v2f", value);
+        header.push_back(0);
+
+        // Blocks are picked up by the threads one at a time, like tiles by CPURenderer.
+        int num_blocks = (height + LINES_PER_BLOCK - 1) / LINES_PER_BLOCK;
+        std::vector<std::vector<unsigned char>> blocks(num_blocks);
+        std::atomic<int> next_block(0);
+        auto compressBlocks = [&]()
+        {
+            std::vector<unsigned char> raw;
+            int block;
+            while((block = next_block.fetch_add(1)) < num_blocks)
+            {
+                int first_line = block * LINES_PER_BLOCK;
+                int lines = std::min(LINES_PER_BLOCK, height - first_line);
+                raw.resize((size_t) lines * width * pixel_size);
+                unsigned char* out = raw.data();
+                for(int y = first_line; y < first_line + lines; y++)
+                {
+                    // The file starts with the top row.
+                    size_t row = (size_t) (height - 1 - y) * width;
+                    for(const Channel& channel : channels)
+                    {
+                        const float* in = channel.data + row * channel.stride;
+                        for(int x = 0; x < width; x++, in += channel.stride)
+                        {
+                            if(channel.half)
+                            {
+                                uint16_t h = floatToHalf(*in);
+                                std::memcpy(out, &h, sizeof(h));
+                                out += sizeof(h);
+                            }
+                            else
+                            {
+                                std::memcpy(out, in, sizeof(float));
+                                out += sizeof(float);
+                            }
+                        }
+                    }
+                }
+                blocks[block] = compressBlock(raw);
+            }
+        };
+
+        if(num_threads <= 0)
+            num_threads = std::max((int) std::thread::hardware_concurrency(), 1);
+        num_threads = std::min(num_threads, num_blocks);
+        std::vector<std::thread> threads;
+        for(int i = 1; i < num_threads; i++)
+            threads.push_back(std::thread(compressBlocks));
+        compressBlocks();
+        for(std::thread& thread : threads)
+            thread.join();
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write((const char*) header.data(), header.size());
+
+        uint64_t offset = header.size() + num_blocks * sizeof(uint64_t);
+        for(const std::vector<unsigned char>& block : blocks)
+        {
+            file.write((const char*) &offset, sizeof(offset));
+            offset += 2 * sizeof(int32_t) + block.size();
+        }
+        for(int i = 0; i < num_blocks; i++)
+        {
+            int32_t first_line = i * LINES_PER_BLOCK, size = blocks[i].size();
+            file.write((const char*) &first_line, sizeof(first_line));
+            file.write((const char*) &size, sizeof(size));
+            file.write((const char*) blocks[i].data(), blocks[i].size());
+        }
+        return (bool) file.flush();
+    }
+}
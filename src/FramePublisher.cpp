@@ -0,0 +1,360 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "FramePublisher.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace yune
+{
+    namespace
+    {
+        const char ring_magic[8] = {'Y', 'U', 'N', 'E', 'F', 'R', 'M', '1'};
+        const size_t RING_HEADER_SIZE = 64;     // The header and every slot header take a cache line of their own.
+        const size_t SLOT_HEADER_SIZE = 64;
+
+        std::string sharedName(const std::string& name)
+        {
+#ifdef _WIN32
+            return name;
+#else
+            return name.empty() || name[0] != '/' ? "/" + name : name;
+#endif
+        }
+
+        void* createShared(const std::string& name, size_t size, void*& handle, std::string& error)
+        {
+#ifdef _WIN32
+            HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, name.c_str());
+            if(!mapping)
+            {
+                error = "CreateFileMapping failed with error " + std::to_string(GetLastError()) + ".";
+                return NULL;
+            }
+            void* memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+            if(!memory)
+            {
+                error = "MapViewOfFile failed with error " + std::to_string(GetLastError()) + ".";
+                CloseHandle(mapping);
+                return NULL;
+            }
+            handle = mapping;
+            return memory;
+#else
+            // A ring left behind by a crashed process is replaced, readers of it see a new inode once they reopen.
+            shm_unlink(name.c_str());
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if(fd < 0)
+            {
+                error = "shm_open failed: " + std::string(std::strerror(errno)) + ".";
+                return NULL;
+            }
+            void* memory = MAP_FAILED;
+            if(ftruncate(fd, size) == 0)
+                memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(memory == MAP_FAILED)
+                error = "Mapping the shared memory failed: " + std::string(std::strerror(errno)) + ".";
+            ::close(fd);
+            if(memory == MAP_FAILED)
+            {
+                shm_unlink(name.c_str());
+                return NULL;
+            }
+            handle = NULL;
+            return memory;
+#endif
+        }
+
+        void* openShared(const std::string& name, size_t& size, void*& handle)
+        {
+#ifdef _WIN32
+            HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+            if(!mapping)
+                return NULL;
+            void* memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            MEMORY_BASIC_INFORMATION info;
+            if(!memory || !VirtualQuery(memory, &info, sizeof(info)))
+            {
+                if(memory)
+                    UnmapViewOfFile(memory);
+                CloseHandle(mapping);
+                return NULL;
+            }
+            size = info.RegionSize;
+            handle = mapping;
+            return memory;
+#else
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if(fd < 0)
+                return NULL;
+            struct stat info;
+            void* memory = MAP_FAILED;
+            if(fstat(fd, &info) == 0 && info.st_size > 0)
+                memory = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(memory == MAP_FAILED)
+                return NULL;
+            size = info.st_size;
+            handle = NULL;
+            return memory;
+#endif
+        }
+
+        void unmapShared(void* memory, size_t size, void* handle)
+        {
+#ifdef _WIN32
+            (void) size;
+            UnmapViewOfFile(memory);
+            CloseHandle((HANDLE) handle);
+#else
+            (void) handle;
+            munmap(memory, size);
+#endif
+        }
+
+        FrameSlot* slotAt(const FrameRing* ring, uint64_t sequence)
+        {
+            char* base = (char*) ring + RING_HEADER_SIZE;
+            return (FrameSlot*) (base + (sequence % ring->slot_count) * ring->slot_stride);
+        }
+
+        float* pixelsOf(FrameSlot* slot)
+        {
+            return (float*) ((char*) slot + SLOT_HEADER_SIZE);
+        }
+
+        double secondsNow()
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    FramePublisher::FramePublisher()
+    {
+        ring = NULL;
+        handle = NULL;
+        size = 0;
+        sequence = 0;
+        open_time = 0;
+    }
+
+    FramePublisher::~FramePublisher()
+    {
+        close();
+    }
+
+    bool FramePublisher::open(const std::string& name, int width, int height, int slot_count)
+    {
+        close();
+        if(width <= 0 || height <= 0 || slot_count < 2)
+        {
+            error = "The frame ring needs a valid size and at least 2 slots.";
+            return false;
+        }
+
+        // Slots are page aligned, so the pixels of every frame start on a cache line and can be streamed without splits.
+        uint64_t pixel_bytes = (uint64_t) width * height * 4 * sizeof(float);
+        uint64_t stride = (SLOT_HEADER_SIZE + pixel_bytes + 4095) / 4096 * 4096;
+        size = RING_HEADER_SIZE + stride * slot_count;
+
+        std::string shared_name = sharedName(name);
+        void* memory = createShared(shared_name, size, handle, error);
+        if(!memory)
+            return false;
+
+        ring = new (memory) FrameRing();
+        ring->width = width;
+        ring->height = height;
+        ring->channels = 4;
+        ring->slot_count = slot_count;
+        ring->slot_stride = stride;
+        for(int i = 0; i < slot_count; i++)
+        {
+            FrameSlot* slot = new (slotAt(ring, i)) FrameSlot();
+            slot->sequence.store(0, std::memory_order_relaxed);
+            slot->samples = 0;
+            slot->time = 0;
+        }
+        ring->closed.store(0, std::memory_order_relaxed);
+        ring->latest.store(0, std::memory_order_relaxed);
+
+        // Readers check the magic first, so it goes in once the rest of the header is.
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(ring->magic, ring_magic, sizeof(ring_magic));
+
+        this->name = shared_name;
+        sequence = 0;
+        open_time = secondsNow();
+        return true;
+    }
+
+    void FramePublisher::close()
+    {
+        if(!ring)
+            return;
+        ring->closed.store(1, std::memory_order_release);
+        unmapShared(ring, size, handle);
+#ifndef _WIN32
+        shm_unlink(name.c_str());
+#endif
+        ring = NULL;
+        handle = NULL;
+        name.clear();
+    }
+
+    void FramePublisher::publish(const float* pixels, uint64_t samples)
+    {
+        if(!ring)
+            return;
+
+        // The odd sequence has to be visible before any pixel changes, and the pixels before the even one.
+        sequence++;
+        FrameSlot* slot = slotAt(ring, sequence);
+        slot->sequence.store(2 * sequence - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(pixelsOf(slot), pixels, (size_t) ring->width * ring->height * 4 * sizeof(float));
+        slot->samples = samples;
+        slot->time = secondsNow() - open_time;
+        slot->sequence.store(2 * sequence, std::memory_order_release);
+        ring->latest.store(sequence, std::memory_order_release);
+    }
+
+    bool FramePublisher::isOpen() const
+    {
+        return ring != NULL;
+    }
+
+    bool FramePublisher::matches(const std::string& name, int width, int height) const
+    {
+        return ring && this->name == sharedName(name) && ring->width == width && ring->height == height;
+    }
+
+    uint64_t FramePublisher::getSequence() const
+    {
+        return sequence;
+    }
+
+    const std::string& FramePublisher::getError() const
+    {
+        return error;
+    }
+
+    FrameSubscriber::FrameSubscriber()
+    {
+        ring = NULL;
+        handle = NULL;
+        size = 0;
+    }
+
+    FrameSubscriber::~FrameSubscriber()
+    {
+        close();
+    }
+
+    bool FrameSubscriber::open(const std::string& name)
+    {
+        close();
+        void* memory = openShared(sharedName(name), size, handle);
+        if(!memory)
+            return false;
+
+        // The publisher fills the header in right after creating the memory, a reader that came in between tries again later.
+        FrameRing* mapped = (FrameRing*) memory;
+        bool valid = size >= RING_HEADER_SIZE && std::memcmp(mapped->magic, ring_magic, sizeof(ring_magic)) == 0;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        valid = valid && mapped->slot_count > 0 && size >= RING_HEADER_SIZE + mapped->slot_stride * mapped->slot_count;
+        if(!valid)
+        {
+            unmapShared(memory, size, handle);
+            handle = NULL;
+            return false;
+        }
+        ring = mapped;
+        return true;
+    }
+
+    void FrameSubscriber::close()
+    {
+        if(!ring)
+            return;
+        unmapShared(ring, size, handle);
+        ring = NULL;
+        handle = NULL;
+    }
+
+    const float* FrameSubscriber::latest(uint64_t after, uint64_t& sequence)
+    {
+        if(!ring)
+            return NULL;
+        uint64_t newest = ring->latest.load(std::memory_order_acquire);
+        if(newest == 0 || newest <= after)
+            return NULL;
+
+        // The slot may already be overwritten by a later frame if the reader stalled since loading latest.
+        FrameSlot* slot = slotAt(ring, newest);
+        if(slot->sequence.load(std::memory_order_acquire) != 2 * newest)
+            return NULL;
+        sequence = newest;
+        return pixelsOf(slot);
+    }
+
+    bool FrameSubscriber::isValid(uint64_t sequence) const
+    {
+        if(!ring)
+            return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slotAt(ring, sequence)->sequence.load(std::memory_order_relaxed) == 2 * sequence;
+    }
+
+    bool FrameSubscriber::isClosed() const
+    {
+        return !ring || ring->closed.load(std::memory_order_acquire) != 0;
+    }
+
+    const FrameRing* FrameSubscriber::getRing() const
+    {
+        return ring;
+    }
+
+    const FrameSlot* FrameSubscriber::getSlot(uint64_t sequence) const
+    {
+        return ring ? slotAt(ring, sequence) : NULL;
+    }
+}
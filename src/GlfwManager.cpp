@@ -48,6 +48,9 @@ namespace yune
             throw std::runtime_error("GLFW failed to initialize.");
         window = NULL;
         space_flag = false;
+        upload_fbo_ID = upload_tex_ID = 0;
+        display_tex_IDs[0] = display_tex_IDs[1] = 0;
+        display_program = display_vao = 0;
         createWindow(window_width, window_height);
         initImGui();
     }
@@ -57,8 +60,13 @@ namespace yune
         //Release OpenGL RBOs and FBO
         if(window)
         {
-            glDeleteRenderbuffers(3, rbo_IDs);
+            glDeleteRenderbuffers(2, rbo_IDs);
+            glDeleteTextures(2, display_tex_IDs);
             glDeleteFramebuffers(1, &fbo_ID);
+            glDeleteFramebuffers(1, &upload_fbo_ID);
+            glDeleteTextures(1, &upload_tex_ID);
+            glDeleteProgram(display_program);
+            glDeleteVertexArrays(1, &display_vao);
         }
 
         ImGui_ImplOpenGL3_Shutdown();
@@ -135,6 +143,7 @@ namespace yune
         glfwSetKeyCallback(window, keyCallback);
         glfwSetCursorPosCallback(window, cursorPosCallback);
         glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+        createDisplayProgram();
 
         glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
         glViewport(0,0, framebuffer_width, framebuffer_height);
@@ -144,16 +153,86 @@ namespace yune
         glfwPollEvents();
     }
 
+    void GlfwManager::createDisplayProgram()
+    {
+        //The triangle covers the viewport with vertices at (-1,-1), (3,-1) and (-1,3). Texels are fetched 1:1 so no filtering is involved.
+        const char* vertex_src = "#version 330 core\n"
+                                 "void main()\n"
+                                 "{\n"
+                                 "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+                                 "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+                                 "}\n";
+        const char* fragment_src = "#version 330 core\n"
+                                   "uniform sampler2D image;\n"
+                                   "out vec4 frag_color;\n"
+                                   "void main()\n"
+                                   "{\n"
+                                   "    frag_color = vec4(texelFetch(image, ivec2(gl_FragCoord.xy), 0).rgb, 1.0);\n"
+                                   "}\n";
+
+        GLuint shaders[2] = {glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER)};
+        const char* sources[2] = {vertex_src, fragment_src};
+        display_program = glCreateProgram();
+        for(int i = 0; i < 2; i++)
+        {
+            GLint status = 0;
+            glShaderSource(shaders[i], 1, &sources[i], NULL);
+            glCompileShader(shaders[i]);
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+            if(!status)
+            {
+                char log[1024];
+                glGetShaderInfoLog(shaders[i], sizeof(log), NULL, log);
+                throw std::runtime_error(std::string("Display shader failed to compile: ") + log);
+            }
+            glAttachShader(display_program, shaders[i]);
+        }
+
+        GLint status = 0;
+        glLinkProgram(display_program);
+        glGetProgramiv(display_program, GL_LINK_STATUS, &status);
+        glDeleteShader(shaders[0]);
+        glDeleteShader(shaders[1]);
+        if(!status)
+        {
+            char log[1024];
+            glGetProgramInfoLog(display_program, sizeof(log), NULL, log);
+            throw std::runtime_error(std::string("Display program failed to link: ") + log);
+        }
+
+        glUseProgram(display_program);
+        glUniform1i(glGetUniformLocation(display_program, "image"), 0);
+        glUseProgram(0);
+        glGenVertexArrays(1, &display_vao);
+    }
+
+    void GlfwManager::drawDisplay(GLuint texture)
+    {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glViewport(0, 0, framebuffer_width, framebuffer_height);
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glUseProgram(display_program);
+        glBindVertexArray(display_vao);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
     bool GlfwManager::setupGlBuffer()
     {
         //Delete any previous RenderBuffer/FrameBuffer. Note that delete calls silently ignore any unused names and 0's
-        glDeleteRenderbuffers(4, rbo_IDs);
+        glDeleteRenderbuffers(2, rbo_IDs);
+        glDeleteTextures(2, display_tex_IDs);
         glDeleteFramebuffers(1, &fbo_ID);
 
         glGenFramebuffers(1,&fbo_ID);
         glBindFramebuffer(GL_FRAMEBUFFER,fbo_ID);
 
-        glGenRenderbuffers(4, rbo_IDs);
+        glGenRenderbuffers(2, rbo_IDs);
 
         glBindRenderbuffer(GL_RENDERBUFFER, rbo_IDs[0]);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32F, framebuffer_width, framebuffer_height);
@@ -163,13 +242,17 @@ namespace yune
         glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32F, framebuffer_width, framebuffer_height);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_RENDERBUFFER, rbo_IDs[1]);
 
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo_IDs[2]);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32F, framebuffer_width, framebuffer_height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_RENDERBUFFER, rbo_IDs[2]);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo_IDs[3]);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32F, framebuffer_width, framebuffer_height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_RENDERBUFFER, rbo_IDs[3]);
+        //Display textures, attached so they can be cleared and read back. They are drawn to the window with drawDisplay().
+        glGenTextures(2, display_tex_IDs);
+        for(int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, display_tex_IDs[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2 + i, GL_TEXTURE_2D, display_tex_IDs[i], 0);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
 
         GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 
@@ -205,6 +288,27 @@ namespace yune
         glDrawBuffer(GL_COLOR_ATTACHMENT3);
         glClear(GL_COLOR_BUFFER_BIT);
 
+        //Images rendered on the host are uploaded to a texture. It's drawn directly, or blitted from it's own FBO into the RBOs above to resume a checkpoint.
+        glDeleteFramebuffers(1, &upload_fbo_ID);
+        glDeleteTextures(1, &upload_tex_ID);
+
+        glGenTextures(1, &upload_tex_ID);
+        glBindTexture(GL_TEXTURE_2D, upload_tex_ID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &upload_fbo_ID);
+        glBindFramebuffer(GL_FRAMEBUFFER, upload_fbo_ID);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, upload_tex_ID, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            setMessageCb("Framebuffer for host rendered images not complete.", "FrameBuffer Incomplete!", "");
+            return false;
+        }
+
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
         return true;
@@ -0,0 +1,268 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "HelperDispatcher.h"
+
+#include <algorithm>
+
+namespace yune
+{
+    HelperDispatcher::HelperDispatcher(CLManager& cl_manager, TileScheduler& tile_scheduler) : cl_manager(cl_manager), tile_scheduler(tile_scheduler)
+    {
+        grid = glm::ivec2(1,1);
+        width = height = 0;
+    }
+
+    void HelperDispatcher::setup()
+    {
+        blocks.assign(cl_manager.helper_devices.size(), std::vector<int>());
+        staging.assign(cl_manager.helper_devices.size(), std::vector<cl_float>());
+    }
+
+    std::vector<std::vector<int>>& HelperDispatcher::getBlocks()
+    {
+        return blocks;
+    }
+
+    void HelperDispatcher::enqueue(int input, bool history, glm::ivec2 grid, int width, int height, const size_t gws[2], const size_t lws[2],
+                                   bool persistent, size_t persistent_lws, int groups_per_cu)
+    {
+        cl_int err = 0;
+        cl_mem input_image = cl_manager.image_buffers[input];
+        this->grid = grid;
+        this->width = width;
+        this->height = height;
+        events.assign(2 * cl_manager.helper_devices.size(), NULL);
+        writes.resize(cl_manager.helper_devices.size(), NULL);
+
+        for(size_t i = 0; i < cl_manager.helper_devices.size(); i++)
+        {
+            CLManager::HelperDevice& helper = cl_manager.helper_devices[i];
+            if(blocks[i].empty())
+                continue;
+
+            size_t origin[3], region[3], offset = 0;
+            for(int block : blocks[i])
+            {
+                TileScheduler::getBlockRegion(grid, width, height, block, origin, region);
+                offset += region[0] * region[1] * 4;
+            }
+
+            // The last frame's blocks may still be written from the staging memory. It can only move once they are.
+            if(offset > staging[i].capacity() && writes[i])
+                clWaitForEvents(1, &writes[i]);
+            staging[i].resize(offset);
+
+            /* Read the accumulated history of the helper's blocks from the shared image and upload it to the helper's private image.
+             * None of the transfers block. The uploads wait on the device for the last read, the devices don't share a context, so
+             * through a user event of the helper's context.
+             */
+            cl_event read_event = NULL;
+            offset = 0;
+            for(int block : blocks[i])
+            {
+                TileScheduler::getBlockRegion(grid, width, height, block, origin, region);
+                if(region[0] == 0 || region[1] == 0)
+                    continue;
+                if(history)
+                {
+                    if(read_event)
+                        clReleaseEvent(read_event);
+                    err = clEnqueueReadImage(cl_manager.comm_queue, input_image, CL_FALSE, origin, region, 0, 0, staging[i].data() + offset,
+                                             0, NULL, &read_event);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+                }
+                offset += region[0] * region[1] * 4;
+            }
+
+            if(read_event)
+            {
+                cl_event gate = chainEvent(read_event, helper.context);
+                clReleaseEvent(read_event);
+                offset = 0;
+                for(int block : blocks[i])
+                {
+                    TileScheduler::getBlockRegion(grid, width, height, block, origin, region);
+                    if(region[0] == 0 || region[1] == 0)
+                        continue;
+
+                    // The queue is in-order, the first upload waiting on the reads holds back everything after it.
+                    bool first = !events[2*i];
+                    err = clEnqueueWriteImage(helper.comm_queue, helper.image_buffers[input], CL_FALSE, origin, region, 0, 0,
+                                              staging[i].data() + offset, first ? 1 : 0, first ? &gate : NULL, first ? &events[2*i] : NULL);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+                    offset += region[0] * region[1] * 4;
+                }
+                clReleaseEvent(gate);
+            }
+
+            const size_t* group = lws[0] > 0 && lws[1] > 0 ? lws : NULL;
+
+            //Persistent-threads launches are sized for the helper's own compute units.
+            size_t helper_lws = std::min(persistent_lws, std::max(helper.rendk_wgs, (size_t) 1));
+            size_t helper_gws = helper_lws * helper.device.compute_units * std::max(groups_per_cu, 1);
+
+            for(int block : blocks[i])
+            {
+                cl_int b = block;
+                err = clSetKernelArg(helper.rend_kernel, 11, sizeof(cl_int), &b);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+                if(persistent)
+                {
+                    cl_int zero = 0;
+                    err = clEnqueueFillBuffer(helper.comm_queue, helper.work_counter_buffer, &zero, sizeof(cl_int), 0, sizeof(cl_int), 0, NULL, NULL);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+                    err = clEnqueueNDRangeKernel(helper.comm_queue, helper.rend_kernel, 1, NULL, &helper_gws, &helper_lws, 0, NULL,
+                                                 events[2*i] ? NULL : &events[2*i]);
+                }
+                else
+                    err = clEnqueueNDRangeKernel(helper.comm_queue, helper.rend_kernel, 2, NULL, gws, group, 0, NULL, events[2*i] ? NULL : &events[2*i]);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            // Read back the rendered blocks. They are written to the shared image once the frame completes.
+            offset = 0;
+            for(size_t j = 0; j < blocks[i].size(); j++)
+            {
+                TileScheduler::getBlockRegion(grid, width, height, blocks[i][j], origin, region);
+                if(region[0] == 0 || region[1] == 0)
+                    continue;
+
+                if(events[2*i + 1])
+                    clReleaseEvent(events[2*i + 1]);
+                err = clEnqueueReadImage(helper.comm_queue, helper.image_buffers[1 - input], CL_FALSE, origin, region, 0, 0,
+                                         staging[i].data() + offset, 0, NULL, &events[2*i + 1]);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                offset += region[0] * region[1] * 4;
+            }
+            clFlush(helper.comm_queue);
+        }
+        clFlush(cl_manager.comm_queue);
+    }
+
+    void HelperDispatcher::composite(int output)
+    {
+        if(cl_manager.helper_devices.empty())
+            return;
+
+        cl_int err = 0;
+        cl_mem output_image = cl_manager.image_buffers[output];
+
+        for(size_t i = 0; i < cl_manager.helper_devices.size(); i++)
+        {
+            if(blocks[i].empty() || !events[2*i + 1])
+                continue;
+
+            // The writes wait on the device for the helper's last read back, through a user event of the shared image's context.
+            cl_event gate = chainEvent(events[2*i + 1], cl_manager.context);
+            if(writes[i])
+                clReleaseEvent(writes[i]);
+            writes[i] = NULL;
+
+            size_t origin[3], region[3], offset = 0;
+            for(int block : blocks[i])
+            {
+                TileScheduler::getBlockRegion(grid, width, height, block, origin, region);
+                if(region[0] == 0 || region[1] == 0)
+                    continue;
+
+                bool first = !writes[i];
+                if(writes[i])
+                    clReleaseEvent(writes[i]);
+                err = clEnqueueWriteImage(cl_manager.comm_queue, output_image, CL_FALSE, origin, region, 0, 0, staging[i].data() + offset,
+                                          first ? 1 : 0, first ? &gate : NULL, &writes[i]);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                offset += region[0] * region[1] * 4;
+            }
+            clReleaseEvent(gate);
+        }
+        clFlush(cl_manager.comm_queue);
+    }
+
+    void HelperDispatcher::retire(bool wait)
+    {
+        for(size_t i = 0; i < events.size() / 2; i++)
+        {
+            // Time from the first upload to the last read back, so transfer cost is part of the device's measured throughput.
+            cl_event first = events[2*i], last = events[2*i + 1];
+            cl_int status = CL_COMPLETE;
+            if(last && wait)
+                clWaitForEvents(1, &last);
+            else if(last)
+                clGetEventInfo(last, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if(first && last && status == CL_COMPLETE && !blocks[i].empty())
+            {
+                cl_ulong time_start = 0, time_finish = 0;
+                clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+                clGetEventProfilingInfo(last, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+                tile_scheduler.measure(i + 1, (time_finish - time_start)/1000000.0 / blocks[i].size());
+            }
+            for(cl_event event : {first, last})
+                if(event)
+                    clReleaseEvent(event);
+        }
+        events.clear();
+
+        // The last writes of the staging memory are kept until the next frame replaces them, unless everything has to be done.
+        if(wait)
+        {
+            for(cl_event event : writes)
+            {
+                if(!event)
+                    continue;
+                clWaitForEvents(1, &event);
+                clReleaseEvent(event);
+            }
+            writes.clear();
+        }
+    }
+
+    void CL_CALLBACK HelperDispatcher::completeGate(cl_event, cl_int status, void* user_data)
+    {
+        cl_event gate = static_cast<cl_event>(user_data);
+        clSetUserEventStatus(gate, status < 0 ? status : CL_COMPLETE);
+        clReleaseEvent(gate);
+    }
+
+    cl_event HelperDispatcher::chainEvent(cl_event source, cl_context context)
+    {
+        cl_int err = 0;
+        cl_event gate = clCreateUserEvent(context, &err);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        // One reference for the callback, one for the caller.
+        clRetainEvent(gate);
+        err = clSetEventCallback(source, CL_COMPLETE, &HelperDispatcher::completeGate, gate);
+        if(err != CL_SUCCESS)
+        {
+            completeGate(source, err, gate);
+            clReleaseEvent(gate);
+        }
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        return gate;
+    }
+}
@@ -0,0 +1,192 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ImageWriter.h"
+#include "ExrWriter.h"
+#include "stb_image_write.h"
+#include "Tracer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+namespace yune
+{
+    ImageWriter::ImageWriter()
+    {
+        busy = quit = false;
+        writer = std::thread(&ImageWriter::writerLoop, this);
+        //ctor
+    }
+
+    ImageWriter::~ImageWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            quit = true;
+        }
+        queue_cv.notify_all();
+        writer.join();
+    }
+
+    void ImageWriter::setJobCompletedCb(std::function<void()> cb)
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        jobCompletedCb = cb;
+    }
+
+    ImageWriter::Job ImageWriter::acquireJob()
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        Job job;
+        if(!free_jobs.empty())
+        {
+            job = std::move(free_jobs.back());
+            free_jobs.pop_back();
+        }
+        job.width = job.height = 0;
+        job.channels = 3;
+        job.half = false;
+        job.threads = 0;
+        job.albedo.clear();
+        job.normal_depth.clear();
+        job.header.clear();
+        return job;
+    }
+
+    void ImageWriter::submit(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            jobs.push_back(std::move(job));
+        }
+        queue_cv.notify_all();
+    }
+
+    std::vector<std::string> ImageWriter::takeFailures()
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        std::vector<std::string> result;
+        result.swap(failures);
+        return result;
+    }
+
+    bool ImageWriter::isIdle()
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return jobs.empty() && !busy;
+    }
+
+    void ImageWriter::waitForIdle()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        idle_cv.wait(lock, [this]{ return jobs.empty() && !busy; });
+    }
+
+    bool ImageWriter::writeCheckpoint(const Job& job)
+    {
+        std::string tmp_fn = job.filename + ".tmp";
+        {
+            std::ofstream file(tmp_fn, std::ios::binary | std::ios::trunc);
+            file.write(job.header.data(), job.header.size());
+            file.write((const char*) job.hdr_pixels.data(), job.hdr_pixels.size() * sizeof(float));
+            if(!file.flush())
+                return false;
+        }
+        // rename() doesn't replace an existing file on every platform.
+        std::remove(job.filename.c_str());
+        return std::rename(tmp_fn.c_str(), job.filename.c_str()) == 0;
+    }
+
+    bool ImageWriter::writeExr(const Job& job)
+    {
+        // Sample counts and depth lose integers beyond 2048 as half floats, so they're always stored as full floats.
+        std::vector<ExrWriter::Channel> channels;
+        const float* beauty = job.hdr_pixels.data();
+        channels.push_back({"R", beauty, 4, job.half});
+        channels.push_back({"G", beauty + 1, 4, job.half});
+        channels.push_back({"B", beauty + 2, 4, job.half});
+        channels.push_back({"samples", beauty + 3, 4, false});
+        if(!job.albedo.empty())
+        {
+            channels.push_back({"albedo.R", job.albedo.data(), 4, job.half});
+            channels.push_back({"albedo.G", job.albedo.data() + 1, 4, job.half});
+            channels.push_back({"albedo.B", job.albedo.data() + 2, 4, job.half});
+        }
+        if(!job.normal_depth.empty())
+        {
+            channels.push_back({"N.X", job.normal_depth.data(), 4, job.half});
+            channels.push_back({"N.Y", job.normal_depth.data() + 1, 4, job.half});
+            channels.push_back({"N.Z", job.normal_depth.data() + 2, 4, job.half});
+            channels.push_back({"Z", job.normal_depth.data() + 3, 4, false});
+        }
+        return ExrWriter::write(job.filename, job.width, job.height, channels, job.threads);
+    }
+
+    void ImageWriter::writerLoop()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while(true)
+        {
+            // Queued images are still written on shutdown, only then the thread exits.
+            queue_cv.wait(lock, [this]{ return quit || !jobs.empty(); });
+            if(jobs.empty())
+                return;
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+            lock.unlock();
+
+            bool status = false;
+            {
+                YUNE_TRACE_SCOPE("io", "Encode Image");
+                stbi_flip_vertically_on_write(1);
+                if(job.ext == ".hdr")
+                    status = stbi_write_hdr(job.filename.c_str(), job.width, job.height, 3, job.hdr_pixels.data());
+                else if(job.ext == ".png")
+                    status = stbi_write_png(job.filename.c_str(), job.width, job.height, 3, job.pixels.data(), job.width * 3);
+                else if(job.ext == ".jpg")
+                    status = stbi_write_jpg(job.filename.c_str(), job.width, job.height, 3, job.pixels.data(), 100);
+                else if(job.ext == ".exr")
+                    status = writeExr(job);
+                else if(job.ext == ".yck")
+                    status = writeCheckpoint(job);
+            }
+
+            lock.lock();
+            if(!status)
+                failures.push_back(job.filename);
+            free_jobs.push_back(std::move(job));
+            busy = false;
+            if(jobs.empty())
+                idle_cv.notify_all();
+            std::function<void()> cb = jobCompletedCb;
+            lock.unlock();
+            if(cb)
+                cb();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "RayCounterSampler.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace yune
+{
+    RayCounterSampler::RayCounterSampler(CLManager& cl_manager) : cl_manager(cl_manager)
+    {
+        read_event = NULL;
+        frame_ms = 0;
+        tile_count = 0;
+        reset();
+    }
+
+    void RayCounterSampler::beginFrame(int interval)
+    {
+        if(read_event || frames_since_sample < interval)
+            return;
+        cl_ulong zero = 0;
+        cl_int err = clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.ray_counter_buffer, &zero, sizeof(cl_ulong), 0,
+                                         CLManager::RAY_COUNTER_COUNT * sizeof(cl_ulong), 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        sampling = true;
+        frames_since_sample = 0;
+    }
+
+    void RayCounterSampler::reserveTiles(size_t tiles)
+    {
+        tile_count = 0;
+        if(sampling && !cl_manager.ray_counters_64)
+            counter_tiles.assign(tiles * CLManager::RAY_COUNTER_COUNT, 0);
+    }
+
+    void RayCounterSampler::tileEnqueued()
+    {
+        // Only exact while a single tile stays below 2^32 of each event.
+        if(!sampling || cl_manager.ray_counters_64)
+            return;
+        cl_int err = 0;
+        cl_ulong zero = 0;
+        err  = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.ray_counter_buffer, CL_FALSE, 0, CLManager::RAY_COUNTER_COUNT * sizeof(cl_uint),
+                                   &counter_tiles[tile_count * CLManager::RAY_COUNTER_COUNT], 0, NULL, NULL);
+        err |= clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.ray_counter_buffer, &zero, sizeof(cl_ulong), 0,
+                                   CLManager::RAY_COUNTER_COUNT * sizeof(cl_ulong), 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        tile_count++;
+    }
+
+    void RayCounterSampler::finishFrame(double frame_ms)
+    {
+        if(!sampling)
+        {
+            frames_since_sample++;
+            return;
+        }
+
+        // 32 bit counters have already been read after every tile. The marker completes after the last of them.
+        cl_int err = 0;
+        if(cl_manager.ray_counters_64)
+            err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.ray_counter_buffer, CL_FALSE, 0, sizeof(counter_data), counter_data,
+                                      0, NULL, &read_event);
+        else
+            err = clEnqueueMarkerWithWaitList(cl_manager.comm_queue, 0, NULL, &read_event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        this->frame_ms = frame_ms;
+        sampling = false;
+    }
+
+    void RayCounterSampler::poll(RayStats& stats)
+    {
+        if(!read_event)
+            return;
+        cl_int status;
+        clGetEventInfo(read_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        if(status != CL_COMPLETE)
+            return;
+        Tracer::deviceEvent("device", "Read Ray Counters", read_event);
+        clReleaseEvent(read_event);
+        read_event = NULL;
+
+        if(!cl_manager.ray_counters_64)
+        {
+            std::fill(counter_data, counter_data + CLManager::RAY_COUNTER_COUNT, 0);
+            for(size_t t = 0; t < tile_count; t++)
+            {
+                for(int i = 0; i < CLManager::RAY_COUNTER_COUNT; i++)
+                    counter_data[i] += counter_tiles[t * CLManager::RAY_COUNTER_COUNT + i];
+            }
+        }
+
+        cl_ulong rays = counter_data[CLManager::RC_RAYS];
+        float inv_rays = 1.0f / std::max(rays, (cl_ulong) 1);
+        stats.valid = true;
+        stats.rays = rays;
+        stats.mrays_per_sec = frame_ms > 0 ? rays / (frame_ms * 1000.0) : 0;
+        stats.nodes_per_ray = counter_data[CLManager::RC_NODES_VISITED] * inv_rays;
+        stats.triangle_tests_per_ray = counter_data[CLManager::RC_TRIANGLE_TESTS] * inv_rays;
+        stats.shadow_ray_share = counter_data[CLManager::RC_SHADOW_RAYS] * inv_rays;
+        for(int i = 0; i < CLManager::PATH_LENGTH_BINS; i++)
+            stats.path_length[i] = counter_data[CLManager::RC_PATH_LENGTH + i];
+    }
+
+    void RayCounterSampler::reset()
+    {
+        sampling = false;
+        frames_since_sample = std::numeric_limits<int>::max() / 2;
+    }
+
+    void RayCounterSampler::release()
+    {
+        if(read_event)
+            clReleaseEvent(read_event);
+        read_event = NULL;
+    }
+}
@@ -31,9 +31,12 @@
 
 #include "stb_image_write.h"
 #include "RendererCore.h"
+#include "Tracer.h"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstring>
 #include <vector>
 #include <string>
 #include <random>
@@ -42,18 +45,76 @@
 #include <cmath>
 #include <stdint.h>
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
 
 namespace yune
 {
     std::function<void(const std::string&, const std::string&, const std::string&)> RendererCore::setMessageCb;
 
-    RendererCore::RendererCore(CLManager& cl_manager, GlfwManager& glfw_manager) : cl_manager(cl_manager), glfw_manager(glfw_manager)
+    static const char* wf_stage_names[CLManager::WF_KERNEL_COUNT] = {"Generate", "Extend", "Shade Diffuse", "Shade Specular", "Connect"};
+
+    RendererCore::RendererCore(CLManager& cl_manager, GlfwManager& glfw_manager) : cl_manager(cl_manager), glfw_manager(glfw_manager), convergence(cl_manager),
+                               exposure_meter(cl_manager), ray_counters(cl_manager), wf_stages(cl_manager), helpers(cl_manager, tile_scheduler)
     {
         resetValues();
         skip_ticks = 16.666;
 
         save_editor = false;
+        checkpoint_samples = 0;
+        checkpoint_minutes = 0;
+        fused_tonemap = false;
+        half_targets = false;
+        half_images = false;
+        fused_arg = -1;
+        builtin_tonemap = false;
+        auto_exposure = true;
+        exposure_key = 0.18f;
+        exposure_adapt_time = 0.5f;
+        exposure_histogram = true;
+        exposure_white_percentile = 0.99f;
+        exposure_arg = -1;
+        exr_half = true;
+        exr_threads = 0;
+        publish_frames = false;
+        publish_name = "yune_frames";
+        publish_interval = 1;
+        publish_in_flight = false;
+        publish_read = NULL;
+        frames_since_publish = 0;
         blocks = glm::ivec2(2,2);
+        wavefront = persistent = ray_counting = cost_heatmap = adaptive_sampling = feature_buffers = temporal = false;
+        persistent_gws = persistent_lws = 0;
+        show_heatmap = false;
+        heatmap_channel = 0;
+        heatmap_max = 100.0f;
+        adaptive_threshold = 0.02f;
+        adaptive_min_spp = 16;
+        active_pixel_share = active_share = 1.0f;
+        target_error = 0.0f;
+        time_budget = 0.0f;
+        convergence_interval = 16;
+        denoise = true;
+        denoise_passes = 5;
+        denoise_sigma_color = 0.5f;
+        denoise_sigma_normal = 64.0f;
+        denoise_sigma_depth = 0.1f;
+        temporal_reprojection = true;
+        temporal_max_history = 8;
+        preview_enabled = true;
+        preview_target_ms = 16.0f;
+        preview_max_scale = 8;
+        preview_settle_ms = 150.0f;
+        preview_scale = preview_divisor = 2;
+        depth_switch = 0;
+        depth_valid = false;
+        camera_slot = 0;
+        active_count_event = compact_event = NULL;
+        counter_interval = 8;
+        write_report = false;
+        adaptive_tiles = false;
+        cpu_backend = false;
+        cpu_threads = 0;
         save_samples_ext = ".jpg";
 
         updateKernelWGSize(true);
@@ -61,12 +122,38 @@ namespace yune
         mt_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
         mt_engine = std::mt19937(mt_seed);
         dist = std::uniform_int_distribution<unsigned int>(0,  std::numeric_limits<unsigned int>::max() );
+
+        //Completed host frames wake the GUI thread the same way completed OpenCL commands do.
+        cpu_renderer.setFrameCompletedCb([this]()
+                                         {
+                                             gpu_signalled = true;
+                                             glfwPostEmptyEvent();
+                                         });
+        image_writer.setJobCompletedCb([this]()
+                                       {
+                                           gpu_signalled = true;
+                                           glfwPostEmptyEvent();
+                                       });
+
+        submit_active = submit_hold = submit_parked = submit_quit = false;
+        submit_abort = false;
+        input_camera_changed = input_cap_fps = input_checkpoint = save_requested = false;
+        input_gi_check = true;
+        input_settings = frame_settings = currentSettings();
+        tile_grid = blocks;
+        submit_thread = std::thread(&RendererCore::submitLoop, this);
         //ctor
     }
 
     RendererCore::~RendererCore()
     {
-        //dtor
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            submit_quit = true;
+        }
+        submit_abort = true;
+        submit_cv.notify_all();
+        submit_thread.join();
     }
 
     void RendererCore::setGuiMessageCb(std::function<void(const std::string&, const std::string&, const std::string&)> cb)
@@ -74,20 +161,245 @@ namespace yune
         RendererCore::setMessageCb = cb;
     }
 
+    void CL_CALLBACK RendererCore::eventCompleted(cl_event, cl_int, void* user_data)
+    {
+        RendererCore* renderer = static_cast<RendererCore*>(user_data);
+        renderer->gpu_signalled = true;
+        glfwPostEmptyEvent();
+    }
+
+    void RendererCore::watchEvent(cl_event event)
+    {
+        cl_int err = clSetEventCallback(event, CL_COMPLETE, &RendererCore::eventCompleted, this);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    void RendererCore::acquireGLObjects(bool accumulation, int display)
+    {
+        YUNE_TRACE_SCOPE("gl", "Acquire GL Objects");
+        cl_int err = 0;
+        cl_mem objects[3];
+        cl_uint count = 0;
+        if(accumulation)
+        {
+            objects[count++] = cl_manager.image_buffers[0];
+            objects[count++] = cl_manager.image_buffers[1];
+        }
+        if(display >= 0)
+            objects[count++] = cl_manager.display_images[display];
+
+        /* GL has to be done with the images before OpenCL takes them over. The GUI thread fences every use of them, see fenceGL(), and
+         * the acquire waits on those fences on the device. The other direction needs nothing, the flushed release is waited on
+         * implicitly by GL commands issued after it.
+         */
+        std::vector<cl_event> waits;
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            waits.swap(gl_waits);
+        }
+        err = clEnqueueAcquireGLObjects(cl_manager.comm_queue, count, objects, waits.size(), waits.empty() ? NULL : waits.data(), NULL);
+        for(cl_event event : waits)
+            clReleaseEvent(event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        accumulation_acquired |= accumulation;
+        if(display >= 0)
+            display_acquired = display;
+    }
+
+    void RendererCore::releaseGLObjects()
+    {
+        YUNE_TRACE_SCOPE("gl", "Release GL Objects");
+        cl_mem objects[3];
+        cl_uint count = 0;
+        if(accumulation_acquired)
+        {
+            objects[count++] = cl_manager.image_buffers[0];
+            objects[count++] = cl_manager.image_buffers[1];
+        }
+        if(display_acquired >= 0)
+            objects[count++] = cl_manager.display_images[display_acquired];
+        accumulation_acquired = false;
+        display_acquired = -1;
+        if(count == 0)
+            return;
+
+        cl_int err = clEnqueueReleaseGLObjects(cl_manager.comm_queue, count, objects, 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    void RendererCore::fenceGL()
+    {
+        // With cl_khr_gl_event a fence behind the last GL command becomes an event, so neither the host nor the GPU idles. Otherwise the only safe way is to finish GL.
+        if(!cl_manager.createEventFromGLsync)
+        {
+            glFinish();
+            return;
+        }
+        cl_int err = 0;
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        cl_event gl_event = cl_manager.createEventFromGLsync(cl_manager.context, (cl_GLsync) fence, &err);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        gl_syncs.push_back({fence, gl_event});
+        clRetainEvent(gl_event);
+        gl_waits.push_back(gl_event);
+    }
+
+    void RendererCore::retireGLSyncs(bool wait)
+    {
+        // The fence has to outlive the event made from it. Fences signal in order, so the oldest ones are retired first.
+        while(!gl_syncs.empty())
+        {
+            cl_int status = CL_COMPLETE;
+            if(wait)
+                clWaitForEvents(1, &gl_syncs.front().second);
+            else
+                clGetEventInfo(gl_syncs.front().second, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if(status != CL_COMPLETE)
+                break;
+            clReleaseEvent(gl_syncs.front().second);
+            glDeleteSync(gl_syncs.front().first);
+            gl_syncs.pop_front();
+        }
+    }
+
+    bool RendererCore::canMakeProgress()
+    {
+        return gpu_signalled;
+    }
+
+    bool RendererCore::hasPendingSaves()
+    {
+        return !pending_saves.empty();
+    }
+
+    void RendererCore::requestSave(const std::string& fn, const std::string& ext)
+    {
+        save_fn = fn;
+        save_ext = ext;
+        save_pending = true;
+        std::lock_guard<std::mutex> lock(submit_mutex);
+        save_requested = !cpu_backend;
+    }
+
     void RendererCore::resetValues()
     {
         buffer_switch = gi_check = render_nextframe = true;
-        save_pending = rk_enqueued = ppk_enqueued = false;
+        save_pending = false;
+
+        last_time = start_time = samples_taken = samples_rendered = save_at_samples = time_passed = 0;
+        fps = mspf_uncapped_avg = mspf_avg = ms_per_ppk = ms_per_rk = 0;
+        frame_time_rk = 0;
+        ms_per_denoise = ms_per_exposure = 0;
+        mb_per_frame = 0;
+        frame_stats = bench_stats = FrameStats();
+        exposure = 1.0f;
+        exposure_meter.reset();
+        reset = 0;
+        curr_block = 0;
+        frame_spp = 1;
+        for(int i = 0; i <= CLManager::WF_KERNEL_COUNT; i++)
+            ms_per_stage[i] = 0;
+        tile_scheduler.reset();
+        device_share.clear();
+        rk_status = CL_COMPLETE;
+        frame_blocks.clear();
+        cpu_frame_pending = false;
+        ray_counters.reset();
+        frame_preview = force_reset = fused_frame = false;
+        display_target = display_acquired = -1;
+        accumulation_acquired = false;
+        shown_display = 1;
+        save_display = save_accumulation = 0;
+        save_preview = false;
+        mailbox = FrameResult();
+        frame_save = frame_checkpoints = false;
+        last_frame_start = last_camera_move = 0;
+        ray_stats = frame_ray_stats = RayStats();
+        convergence.reset();
+        convergence_error = -1.0f;
+        stop_reason = auto_stop = STOP_NONE;
+        stop_elapsed = auto_stop_elapsed = 0;
+        budget_start = 0;
+        last_checkpoint = glfwGetTime();
+        resuming = false;
+        frames_since_publish = 0;
+        gpu_signalled = true;
+    }
+
+    bool RendererCore::parkSubmission(bool abort)
+    {
+        std::unique_lock<std::mutex> lock(submit_mutex);
+        submit_active = false;
+        submit_abort = abort;
+        submit_cv.notify_all();
+        submit_cv.wait(lock, [this](){ return submit_parked; });
+        submit_abort = false;
+        return !submit_hold;
+    }
+
+    void RendererCore::discardMailbox()
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex);
+        for(cl_event event : {mailbox.display_event, mailbox.publish_event})
+            if(event)
+                clReleaseEvent(event);
+        mailbox = FrameResult();
+        submit_hold = false;
+        for(cl_event event : gl_waits)
+            clReleaseEvent(event);
+        gl_waits.clear();
+    }
 
-        last_time = start_time = samples_taken = save_at_samples = time_passed = 0;
-        fps = sum_mspf = mspf_uncapped_avg = mspf_avg = ms_per_ppk = ms_per_rk = 0;
-        reset = curr_block = frame_count = 0;
-        rk_status = ppk_status = CL_COMPLETE;
+    void RendererCore::releaseTileEvents()
+    {
+        for(cl_event event : rk_events)
+            clReleaseEvent(event);
+        rk_events.clear();
+        for(std::vector<cl_event>& events : wf_events)
+            for(cl_event event : events)
+                clReleaseEvent(event);
+        wf_events.clear();
+        if(active_count_event)
+        {
+            clReleaseEvent(active_count_event);
+            clReleaseEvent(compact_event);
+        }
+        active_count_event = compact_event = NULL;
     }
 
     void RendererCore::stop()
     {
-        clFinish(cl_manager.comm_queue);
+        // Readbacks are handed to the writer before their buffers go away. Images still being encoded are finished in the background.
+        pollSaves(true);
+        if(!free_pbos.empty())
+            glDeleteBuffers(free_pbos.size(), free_pbos.data());
+        free_pbos.clear();
+        if(cpu_backend)
+            cpu_renderer.waitForFrame();
+        else
+        {
+            // The submission thread drops the rest of the frame in flight and waits between frames until the next start.
+            parkSubmission(true);
+            clFinish(cl_manager.comm_queue);
+            for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+                clFinish(helper.comm_queue);
+            discardMailbox();
+            retireDisplayPasses(true);
+            helpers.retire(true);
+            retireGLSyncs(true);
+        }
+        releaseTileEvents();
+        ray_counters.release();
+        wf_stages.release();
+        convergence.release();
+        for(int i = 0; i < CLManager::CAMERA_RING_SIZE; i++)
+            releaseCameraWrites(i);
+        exposure_meter.release();
+        if(publish_read)
+            clReleaseEvent(publish_read);
+        publish_read = NULL;
+        publish_in_flight = false;
         resetValues();
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, glfw_manager.fbo_ID);
         glDrawBuffer(GL_COLOR_ATTACHMENT0);
@@ -105,6 +417,18 @@ namespace yune
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
     }
 
+    bool RendererCore::saveTrace(const std::string& filename)
+    {
+        std::string device_name = cpu_backend ? std::string("CPU Backend") : cl_manager.target_device.name;
+        if(!Tracer::dump(filename, device_name))
+        {
+            setMessageCb("Error writing the trace file \"" + filename + "\".", "Error!", "");
+            return false;
+        }
+        setMessageCb("Trace saved to \"" + filename + "\". Open it in chrome://tracing or ui.perfetto.dev.", "Success!", "");
+        return true;
+    }
+
     bool RendererCore::reloadMatFile()
     {
         try
@@ -141,6 +465,11 @@ namespace yune
         if(reset)
         {
             blocks = glm::vec2(2,2);
+            tiles_in_flight = 2;
+            target_ms_per_tile = 8.0f;
+            persistent_groups_per_cu = 4;
+            spp_per_launch = 1;
+            max_bounces = 8;
             rk_lws[0] = 0;
             rk_lws[1] = 0;
             ppk_lws[0] = 0;
@@ -154,8 +483,43 @@ namespace yune
 
     bool RendererCore::setup(bool& update_image_buffer, bool& update_vertex_buffer,  bool& update_mat_buffer, bool& update_bvh_buffer, bool do_postproc)
     {
+        YUNE_TRACE_SCOPE("setup", "Renderer Setup");
         bool show_error = false;
         this->do_postproc = do_postproc;
+        half_images = half_targets;
+        frame_settings = currentSettings();
+
+        // The CPU backend reads the scene straight from render_scene. It only needs the GL buffers it's image is displayed through.
+        if(cpu_backend)
+        {
+            wavefront = persistent = ray_counting = cost_heatmap = adaptive_sampling = feature_buffers = temporal = false;
+            exposure_arg = fused_arg = -1;
+            if(update_image_buffer)
+            {
+                if(glfw_manager.setupGlBuffer())
+                    update_image_buffer = false;
+                else
+                    return false;
+            }
+
+            try
+            {
+                render_scene.main_camera.setBuffer(&cam_data);
+                render_scene.main_camera.is_changed = true;
+                cpu_renderer.setScene(&render_scene.vert_data, &render_scene.mat_data, &render_scene.bvh.gpu_node_list);
+                cpu_renderer.setup(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height, cpu_threads);
+            }
+            catch(const std::exception& err)
+            {
+                setMessageCb(err.what(), "Error!", "");
+                return false;
+            }
+            return true;
+        }
+
+        wavefront = cl_manager.getFeatureArg("wavefront") >= 0;
+        fused_arg = cl_manager.getFeatureArg("fused-tonemap");
+        builtin_tonemap = cl_manager.ppk_file_path == CLManager::TONEMAP_PATH;
 
         if(update_vertex_buffer)
         {
@@ -183,13 +547,39 @@ namespace yune
 
         if(update_image_buffer)
         {
-            if(glfw_manager.setupGlBuffer() && cl_manager.setupImageBuffers(glfw_manager.rbo_IDs))
+            if(glfw_manager.setupGlBuffer() && cl_manager.setupImageBuffers(glfw_manager.rbo_IDs, glfw_manager.display_tex_IDs, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
                 update_image_buffer = false;
             else
                 show_error = true;
 
         }
 
+        if(cl_manager.getFeatureArg("cost-heatmap") >= 0 && !cl_manager.setupCostImage(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
+            show_error = true;
+
+        if(cl_manager.getFeatureArg("adaptive-sampling") >= 0 && !cl_manager.setupAdaptiveBuffers(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
+            show_error = true;
+
+        if(cl_manager.getFeatureArg("feature-buffers") >= 0 && !cl_manager.setupDenoiseBuffers(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height, half_images))
+            show_error = true;
+
+        if(cl_manager.getFeatureArg("temporal-reprojection") >= 0 && !cl_manager.setupTemporalBuffers(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
+            show_error = true;
+
+        if(cl_manager.setupConvergenceBuffers(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
+            convergence.setup(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height);
+        else
+            show_error = true;
+
+        exposure_arg = do_postproc ? cl_manager.getPostProcFeatureArg("auto-exposure") : -1;
+        if(exposure_arg >= 0)
+        {
+            if(cl_manager.setupLuminanceBuffers(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
+                exposure_meter.setup(glfw_manager.framebuffer_width, glfw_manager.framebuffer_height);
+            else
+                show_error = true;
+        }
+
         /* Pass Scene/Model Data and BVH if present. If not present NULL Buffer will be passed. Since other arguments need to be passed
          * regularly, we pass them in the loop inside start function. Scene and material data remain constant hence passed
          * only once here.
@@ -204,10 +594,14 @@ namespace yune
 
             //Set Camera Argument
             render_scene.main_camera.setBuffer(&cam_data);
+            for(int i = 0; i < CLManager::CAMERA_RING_SIZE; i++)
+                releaseCameraWrites(i);
             cl_manager.setupCameraBuffer(&cam_data);
+            camera_slot = 0;
             render_scene.main_camera.is_changed = true;
 
             //Set Block Arugments
+            tile_grid = blocks;
             cl_int bx = blocks.x;
             cl_int by = blocks.y;
             err = clSetKernelArg(cl_manager.rend_kernel, 12, sizeof(cl_int), &bx);
@@ -216,6 +610,72 @@ namespace yune
             err = clSetKernelArg(cl_manager.rend_kernel, 13, sizeof(cl_int), &by);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
 
+            /* Persistent-threads kernels are launched with just enough work-groups to occupy every compute unit and loop over the pixels
+             * of a tile by taking batches from a global counter. A work-group is a whole number of the kernel's preferred multiple.
+             */
+            int pt_arg = cl_manager.getFeatureArg("persistent-threads");
+            persistent = pt_arg >= 0;
+            if(persistent)
+            {
+                err = clSetKernelArg(cl_manager.rend_kernel, pt_arg, sizeof(cl_mem), &cl_manager.work_counter_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+                size_t multiple = std::max(cl_manager.preferred_workgroup_multiple, (size_t) 1);
+                size_t max_lws = cl_manager.rendk_wgs > 0 ? cl_manager.rendk_wgs : multiple;
+                if(rk_lws[0] > 0 && rk_lws[1] > 0)
+                    persistent_lws = rk_lws[0] * rk_lws[1];
+                else
+                    persistent_lws = std::max(std::min(max_lws, (size_t) 128) / multiple, (size_t) 1) * multiple;
+                persistent_lws = std::min(persistent_lws, max_lws);
+                persistent_gws = persistent_lws * cl_manager.target_device.compute_units * std::max(persistent_groups_per_cu, 1);
+            }
+
+            int rc_arg = cl_manager.getFeatureArg("ray-counters");
+            ray_counting = rc_arg >= 0;
+            if(ray_counting)
+            {
+                err = clSetKernelArg(cl_manager.rend_kernel, rc_arg, sizeof(cl_mem), &cl_manager.ray_counter_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            int ch_arg = cl_manager.getFeatureArg("cost-heatmap");
+            cost_heatmap = ch_arg >= 0;
+            if(cost_heatmap)
+            {
+                err = clSetKernelArg(cl_manager.rend_kernel, ch_arg, sizeof(cl_mem), &cl_manager.image_buffers[2]);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            int as_arg = cl_manager.getFeatureArg("adaptive-sampling");
+            adaptive_sampling = as_arg >= 0;
+            active_pixel_share = active_share = 1.0f;
+            if(adaptive_sampling)
+            {
+                err  = clSetKernelArg(cl_manager.rend_kernel, as_arg, sizeof(cl_mem), &cl_manager.moments_buffer);
+                err |= clSetKernelArg(cl_manager.rend_kernel, as_arg + 1, sizeof(cl_mem), &cl_manager.active_pixel_buffer);
+                err |= clSetKernelArg(cl_manager.rend_kernel, as_arg + 2, sizeof(cl_mem), &cl_manager.active_count_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            int fb_arg = cl_manager.getFeatureArg("feature-buffers");
+            feature_buffers = fb_arg >= 0;
+            if(feature_buffers)
+            {
+                err  = clSetKernelArg(cl_manager.rend_kernel, fb_arg, sizeof(cl_mem), &cl_manager.albedo_buffer);
+                err |= clSetKernelArg(cl_manager.rend_kernel, fb_arg + 1, sizeof(cl_mem), &cl_manager.normal_depth_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            // The distance buffers are bound per reset in updateRenderKernelArgs(). Until a reset frame has filled one, nothing is reprojected.
+            int tr_arg = cl_manager.getFeatureArg("temporal-reprojection");
+            temporal = tr_arg >= 0;
+            depth_valid = false;
+            if(temporal)
+            {
+                err = clSetKernelArg(cl_manager.rend_kernel, tr_arg, sizeof(cl_mem), &cl_manager.prev_camera_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
             //Set Scene Arguments
             cl_int scene_size = render_scene.vert_data.size();
             cl_int bvh_size = render_scene.bvh.gpu_node_list.size();
@@ -235,6 +695,27 @@ namespace yune
             err = clSetKernelArg(cl_manager.rend_kernel, 7, sizeof(cl_mem), cl_manager.bvh_buffer ? &cl_manager.bvh_buffer : NULL);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
 
+            //Secondary devices get the same arguments but with their own replicas of the buffers.
+            for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+            {
+                cl_kernel kernel = helper.rend_kernel;
+                cl_int check = gi_check;
+                err  = clSetKernelArg(kernel, 2, sizeof(cl_mem), &helper.camera_buffer);
+                err |= clSetKernelArg(kernel, 3, sizeof(cl_int), &scene_size);
+                err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), helper.vert_buffer ? &helper.vert_buffer : NULL);
+                err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), helper.mat_buffer ? &helper.mat_buffer : NULL);
+                err |= clSetKernelArg(kernel, 6, sizeof(cl_int), &bvh_size);
+                err |= clSetKernelArg(kernel, 7, sizeof(cl_mem), helper.bvh_buffer ? &helper.bvh_buffer : NULL);
+                err |= clSetKernelArg(kernel, 8, sizeof(cl_int), &check);
+                err |= clSetKernelArg(kernel, 9, sizeof(cl_int), &reset);
+                err |= clSetKernelArg(kernel, 12, sizeof(cl_int), &bx);
+                err |= clSetKernelArg(kernel, 13, sizeof(cl_int), &by);
+                if(persistent)
+                    err |= clSetKernelArg(kernel, pt_arg, sizeof(cl_mem), &helper.work_counter_buffer);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+            helpers.setup();
+            tile_scheduler.setup(cl_manager.helper_devices.size() + 1);
         }
         catch(const std::exception& err)
         {
@@ -247,7 +728,15 @@ namespace yune
 
     bool RendererCore::enqueueKernels(bool new_gi_check, bool cap_fps)
     {
-        bool show_error = false;
+        if(cpu_backend)
+            return renderCPUFrame(new_gi_check, cap_fps);
+
+        YUNE_TRACE_SCOPE("frame", "enqueueKernels");
+        gpu_signalled = false;
+        bool show_error = !pollSaves(false);
+        retireGLSyncs(false);
+        if(!publish_frames)
+            frame_publisher.close();
 
         //Setup RBO as the source from where to read pixel data. Set default framebuffer for writing.
         glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.fbo_ID);
@@ -255,305 +744,1102 @@ namespace yune
         glDrawBuffer(GL_BACK);
         try
         {
-            cl_int err = 0;
-
-            //Enqueue Kernel only if previous kernel completed it's execution
-            if(rk_status == CL_COMPLETE && ppk_status == CL_COMPLETE)
+            /* The submission thread renders frames back to back on it's own and leaves the latest completed one in the mailbox. It's
+             * taken here once it's display image is written. Only a frame this thread reads the images of, to save it or to copy it
+             * into the display image, holds the submission thread until it's done, so the device doesn't wait for the GUI otherwise.
+             */
+            FrameResult frame = FrameResult();
             {
-                //If first curr_block, this means one frame has been processed or it's the initial frame. We start rendering the next frame only if previous frame was blitted through render().
-                if(!render_nextframe && cap_fps && curr_block == 0)
-                    return true;
-                if(curr_block == 0)
+                std::lock_guard<std::mutex> lock(submit_mutex);
+                cl_int status = CL_COMPLETE;
+                if(mailbox.valid && mailbox.display_event)
+                    clGetEventInfo(mailbox.display_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+                if(mailbox.valid && status <= CL_COMPLETE)
                 {
-                    cl_uint seed = dist(mt_engine);
-                    updateRenderKernelArgs(new_gi_check, seed);
-                    if(reset == 1)
-                        samples_taken = 0;
-                    start_time = glfwGetTime();
-                    render_nextframe = false;
-                }
-
-                //Enqueue Kernel.
-                if(!cl_manager.target_device.clgl_event_ext)
-                    glFinish();
-
-                err = clEnqueueAcquireGLObjects(cl_manager.comm_queue, 2, cl_manager.image_buffers, 0, NULL, NULL);
-                CLManager::checkError(err, __FILE__, __LINE__ -1);
-                clFlush(cl_manager.comm_queue);
+                    std::swap(frame, mailbox);
 
-                err = clSetKernelArg(cl_manager.rend_kernel, 11, sizeof(cl_int), &curr_block);
-                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                    // The image shown until now is the next one written. GL has to be done drawing it before that.
+                    if(frame.display >= 0 && frame.show)
+                    {
+                        shown_display = frame.display;
+                        fenceGL();
+                    }
+                }
+            }
 
-                size_t* lws = NULL;
-                if(rk_lws[0] > 0 && rk_lws[1] > 0)
-                    lws = rk_lws;
-                err = clEnqueueNDRangeKernel(cl_manager.comm_queue, // command queue
-                                         cl_manager.rend_kernel,    // kernel
-                                         2,                         // global work dimensions
-                                         NULL,                      // global work offset
-                                         rk_gws,                    // global workgroup size
-                                         lws,                    // local workgroup size
-                                         0,                         // Number of events in wait list.
-                                         NULL,                      // Events in wait list
-                                         &rk_event
-                                        );
-                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            if(frame.valid)
+            {
+                if(frame.display_event)
+                    clReleaseEvent(frame.display_event);
+                if(frame.failed)
+                {
+                    if(!frame.error.empty())
+                        throw std::runtime_error(frame.error);
+                    return false;
+                }
+                show_error |= !presentFrame(frame);
 
-                err = clEnqueueReleaseGLObjects(cl_manager.comm_queue, 2, cl_manager.image_buffers, 0, NULL, NULL);
-                CLManager::checkError(err, __FILE__, __LINE__ -1);
-                clFlush(cl_manager.comm_queue);
-                curr_block++;
-                rk_enqueued = true;
+                // GL reads and writes of the images were issued by now. The next frame waits for them on the device.
+                if(frame.hold)
+                {
+                    std::lock_guard<std::mutex> lock(submit_mutex);
+                    fenceGL();
+                    submit_hold = false;
+                }
             }
 
-            // Check if all blocks have completed execution. If so, then apply post-processing kernel (Mainly tone mapping and Gamma correction)
-            if(rk_enqueued)
+            // A checkpoint replaces the accumulation between two frames, unless one the GUI thread still has to save from is held.
+            if(!resume_fn.empty() && parkSubmission(false) && !resumeCheckpoint(new_gi_check))
+                return false;
+
             {
-                clGetEventInfo(rk_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &rk_status, NULL);
-                if(rk_status == CL_COMPLETE && curr_block != blocks.x * blocks.y)
+                std::lock_guard<std::mutex> lock(submit_mutex);
+                if(render_scene.main_camera.is_changed)
+                {
+                    input_camera = render_scene.main_camera;
+                    input_camera_changed = true;
+                    render_scene.main_camera.is_changed = false;
+                }
+                input_gi_check = new_gi_check;
+                input_cap_fps = cap_fps;
+                input_checkpoint = !checkpoint_fn.empty();
+                input_settings = currentSettings();
+                if(!submit_active && !show_error)
                 {
-                    // Get Profiling info for rendering kernel
-                    cl_ulong time_start, time_finish;
-                    clGetEventProfilingInfo(rk_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
-                    clGetEventProfilingInfo(rk_event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
-                    clReleaseEvent(rk_event);
-                    exec_time_rk += (time_finish - time_start)/1000000.0;
-                    rk_enqueued = false;
+                    // GL may have written the images while the thread was parked, e.g. cleared them or loaded a checkpoint.
+                    fenceGL();
+                    submit_active = true;
                 }
             }
+            submit_cv.notify_all();
+        }
+        catch(const std::exception& err)
+        {
+            setMessageCb(err.what(), "Error!", "");
+            show_error = true;
+        }
+
+        // Nothing more is taken from the mailbox until the renderer is started again, so no more frames are rendered either.
+        if(show_error)
+            parkSubmission(false);
+        return !show_error;
+    }
+
+    bool RendererCore::presentFrame(FrameResult& frame)
+    {
+        YUNE_TRACE_SCOPE("gl", "Store Frame");
+        bool status = true;
+        endFrame(frame);
+
+        //Without a kernel writing the display image, copy the accumulation into it.
+        glReadBuffer(GL_COLOR_ATTACHMENT0 + frame.accumulation);
+        if(frame.blit)
+        {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, glfw_manager.fbo_ID);
+            glDrawBuffer(GL_COLOR_ATTACHMENT2 + frame.display);
+
+            glBlitFramebuffer(0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
+                              0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
+                              GL_COLOR_BUFFER_BIT,
+                              GL_NEAREST
+                             );
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glDrawBuffer(GL_BACK);
+        }
 
-            //If one whole frame has finished, do post-processing if kernel available else store copy of the frame for blitting later
-            if(rk_status == CL_COMPLETE && curr_block == blocks.x * blocks.y)
+        // The read of a frame to publish completes on it's own. pollSaves() copies it into the ring.
+        if(frame.publish_event)
+        {
+            publish_read = frame.publish_event;
+            publish_read_samples = frame.publish_samples;
+            if(!frame_publisher.matches(publish_name, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height)
+               && !frame_publisher.open(publish_name, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height))
             {
-                rk_enqueued = false;
-                curr_block = 0;
-                //std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                publish_frames = false;
+                setMessageCb("Error Publishing Frames. " + frame_publisher.getError(), "Error!", "");
+                status = false;
+            }
+        }
 
-                // Get Profiling info for rendering kernel
-                cl_ulong time_start, time_finish;
-                clGetEventProfilingInfo(rk_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
-                clGetEventProfilingInfo(rk_event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
-                clReleaseEvent(rk_event);
-                exec_time_rk += (time_finish - time_start)/1000000.0;
+        if(frame.checkpoint)
+            status &= saveCheckpoint(GL_COLOR_ATTACHMENT0 + frame.accumulation, frame.samples);
 
-                 //Enqueue Post Processing kernel if post-proc enabled.
-                if(do_postproc)
-                {
-                    if(!cl_manager.target_device.clgl_event_ext)
-                        glFinish();
+        save_display = frame.display;
+        save_accumulation = frame.accumulation;
+        save_preview = frame.preview;
 
-                    err = clEnqueueAcquireGLObjects(cl_manager.comm_queue, 3, cl_manager.image_buffers, 0, NULL, NULL);
-                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+        //  If samples taken is equal to the option specified at which to take a screen shot, save the image.
+        if(frame.save_samples)
+            status &= saveImage(save_samples_fn, save_samples_ext);
 
-                    updatePostProcessingKernelArgs();
-
-                    size_t* lws = NULL;
-                    if(rk_lws[0] > 0 && rk_lws[1] > 0)
-                        lws = ppk_lws;
-                    err = clEnqueueNDRangeKernel(cl_manager.comm_queue,     // command queue
-                                                 cl_manager.pp_kernel,      // kernel
-                                                 2,                         // global work dimensions
-                                                 NULL,                      // global work offset
-                                                 ppk_gws,                   // global workgroup size
-                                                 lws,                   // local workgroup size
-                                                 0,                         // Number of events in wait list.
-                                                 NULL,                      // Events in wait list
-                                                 &ppk_event                 // Event
-                                                );
-                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+        //If save button was pressed, save the current image output by the newest kernel execution.
+        if(frame.save && save_pending)
+        {
+            status &= saveImage(save_fn, save_ext);
+            save_pending = false;
+        }
 
-                    err = clEnqueueReleaseGLObjects(cl_manager.comm_queue, 3, cl_manager.image_buffers, 0, NULL, NULL);
-                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+        if(frame.auto_stopped)
+            status &= saveAutoStop();
+        return status;
+    }
 
-                    clFlush(cl_manager.comm_queue);
-                    ppk_enqueued = true;
+    void RendererCore::submitLoop()
+    {
+        std::unique_lock<std::mutex> lock(submit_mutex);
+        while(true)
+        {
+            submit_parked = true;
+            submit_cv.notify_all();
+            submit_cv.wait(lock, [this](){ return submit_quit || (submit_active && !submit_hold); });
+            if(submit_quit)
+                return;
+
+            //With the frame rate capped, frames start atmost every 16.66 ms. An automatically stopped render waits for the camera or GI to change.
+            double wait = input_cap_fps ? last_frame_start + skip_ticks / 1000.0 - glfwGetTime() : 0;
+            if(wait > 0)
+            {
+                submit_cv.wait_for(lock, std::chrono::duration<double>(wait));
+                continue;
+            }
+            if(auto_stop != STOP_NONE && !input_camera_changed && input_gi_check == gi_check)
+            {
+                submit_cv.wait(lock);
+                continue;
+            }
 
-                }
-                //Else we keep a copy of the latest frame and blit to the default framebuffer (BACK)
+            submit_parked = false;
+            bool camera_changed = input_camera_changed;
+            if(camera_changed)
+                frame_camera = input_camera;
+            input_camera_changed = false;
+            bool new_gi_check = input_gi_check;
+            frame_save = save_requested;
+            save_requested = false;
+            frame_checkpoints = input_checkpoint;
+            frame_settings = input_settings;
+            last_frame_start = glfwGetTime();
+            lock.unlock();
+
+            FrameResult frame = FrameResult();
+            try
+            {
+                if(!beginFrame(new_gi_check, camera_changed))
+                    frame.failed = true;
                 else
                 {
-                    if(buffer_switch)
-                    {
-                        glReadBuffer(GL_COLOR_ATTACHMENT0);
-                        buffer_switch = false;
-                    }
+                    submitTiles();
+                    if(!submit_abort)
+                        finishFrame(frame);
                     else
                     {
-                        glReadBuffer(GL_COLOR_ATTACHMENT1);
-                        buffer_switch = true;
+                        releaseGLObjects();
+                        clFlush(cl_manager.comm_queue);
                     }
-                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, glfw_manager.fbo_ID);
-                    glDrawBuffer(GL_COLOR_ATTACHMENT3);
-
-                    //Clear previous frame
-                    glClear(GL_COLOR_BUFFER_BIT);
-
-                    glBlitFramebuffer(0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                                      0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                                      GL_COLOR_BUFFER_BIT,
-                                      GL_LINEAR
-                                     );
-                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-                    glDrawBuffer(GL_BACK);
-
-                    //Update benchmarks, advance framecount and samples etc.
-                    endFrame();
                 }
             }
+            catch(const std::exception& err)
+            {
+                frame.failed = true;
+                frame.error = err.what();
+            }
 
-            // If postprocessing was enabled, Check if Post Processing kernel completed execution
-            if(ppk_enqueued && do_postproc)
+            if(frame.failed)
             {
-                //double xx = glfwGetTime();
-                clGetEventInfo(ppk_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &ppk_status, NULL);
-                if(ppk_status == CL_COMPLETE)
+                // The GUI thread reports the error. Whatever was enqueued is finished, and the images go back to GL.
+                clFinish(cl_manager.comm_queue);
+                for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+                    clFinish(helper.comm_queue);
+                releaseTileEvents();
+                try
                 {
-                    ppk_enqueued = false;
-
-                    // Get Profiling info for post-processing kernel
-                    cl_ulong time_start, time_finish;
-                    clGetEventProfilingInfo(ppk_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
-                    clGetEventProfilingInfo(ppk_event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
-                    clReleaseEvent(ppk_event);
-                    exec_time_ppk += (time_finish - time_start)/1000000.0;
-
-                    //Store a copy of the post-processed frame
-                    glBindFramebuffer(GL_FRAMEBUFFER, glfw_manager.fbo_ID);
-                    glReadBuffer(GL_COLOR_ATTACHMENT2);
-                    glDrawBuffer(GL_COLOR_ATTACHMENT3);
-
-                    //Clear previous frame
-                    glClear(GL_COLOR_BUFFER_BIT);
-
-                    glBlitFramebuffer(0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                                      0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                                      GL_COLOR_BUFFER_BIT,
-                                      GL_LINEAR
-                                     );
-                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-                    glDrawBuffer(GL_BACK);
-
-                    if(buffer_switch)
-                    {
-                        glReadBuffer(GL_COLOR_ATTACHMENT0);
-                        buffer_switch = false;
-                    }
-                    else
-                    {
-                        glReadBuffer(GL_COLOR_ATTACHMENT1);
-                        buffer_switch = true;
-                    }
-
-                    //  If samples taken is equal to the option specified at which to take a screen shot, save the image.
-                    if(save_at_samples > 0 && samples_taken == save_at_samples)
-                        show_error |= !saveImage(save_samples_fn, save_samples_ext);
+                    releaseGLObjects();
+                }
+                catch(const std::exception& err)
+                {
+                }
+                clFinish(cl_manager.comm_queue);
+                frame.valid = true;
+            }
 
-                    //If save button was pressed, save the current image output by the newest kernel execution.
-                    if(save_pending)
-                    {
-                        show_error |= !saveImage(save_fn, save_ext);
-                        save_pending = false;
-                    }
+            lock.lock();
+            if(!frame.valid)
+                continue;
 
-                    //Update benchmarks, advance framecount and samples etc.
-                    endFrame();
+            // Latest frame wins. An untaken one is replaced, it's statistics and the read of a frame to publish carry over.
+            if(mailbox.valid)
+            {
+                frame.stats.add(mailbox.stats);
+                if(mailbox.display_event)
+                    clReleaseEvent(mailbox.display_event);
+                if(!frame.publish_event)
+                {
+                    frame.publish_event = mailbox.publish_event;
+                    frame.publish_samples = mailbox.publish_samples;
                 }
             }
+            mailbox = std::move(frame);
+            submit_hold = mailbox.hold;
+            if(mailbox.failed)
+                submit_active = false;
+            gpu_signalled = true;
+            glfwPostEmptyEvent();
         }
-        catch(const std::exception& err)
-        {
-            setMessageCb(err.what(), "Error!", "");
-            return false;
-        }
-        return !show_error;
     }
 
-    void RendererCore::render()
+    bool RendererCore::beginFrame(bool new_gi_check, bool camera_changed)
     {
-        render_nextframe = true;
-        glReadBuffer(GL_COLOR_ATTACHMENT3);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glBlitFramebuffer(0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                          0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
-                          GL_COLOR_BUFFER_BIT,
-                          GL_LINEAR
-                         );
-    }
+        YUNE_TRACE_SCOPE("submit", "Begin Frame");
+        cl_int err = 0;
 
-    void RendererCore::endFrame()
-    {
-        samples_taken++;
-        frame_count++;
-        sum_mspf += (glfwGetTime() - start_time);
+        //Collect the results of earlier frames that completed in the meantime. None of this blocks.
+        retireDisplayPasses(false);
+        ray_counters.poll(frame_ray_stats);
+        convergence.poll();
+        exposure_meter.poll(frame_settings.exposure_key, frame_settings.exposure_adapt_time, frame_settings.exposure_histogram,
+                            frame_settings.exposure_white_percentile, glfwGetTime());
 
-        //Show ms per frame and per kernel averaged over 1 sec intervals...
-        if(glfwGetTime() - last_time >= 1.0)
-        {
-            mspf_uncapped_avg = sum_mspf * 1000.0 /frame_count;     // Redundant calculation, may come handy later
+        // Device timestamps are mapped onto the host clock once per recording. This blocks until the queue is drained.
+        if(Tracer::isEnabled() && !Tracer::isCalibrated())
+            Tracer::calibrate(cl_manager.comm_queue);
 
-            mspf_avg = (glfwGetTime() - last_time) * 1000/frame_count;
-            ms_per_rk = (float) exec_time_rk / (blocks.x * blocks.y * frame_count);
-            ms_per_ppk = (float) exec_time_ppk / frame_count;
+        // Adaptive tiles keep the grid they settled on, otherwise the grid set in the GUI applies from this frame on.
+        applyTileGrid(frame_settings.adaptive_tiles ? tile_grid : frame_settings.blocks);
 
-            time_passed++;
-            fps = frame_count;
-            frame_count = 0;
-            last_time = glfwGetTime();
-            sum_mspf = 0.0f;
-            exec_time_rk = exec_time_ppk = 0;
+        /* While the camera moves, frames are rendered at a reduced resolution and upscaled. Camera input doesn't arrive every frame, so
+         * preview frames go on until the camera has been still for preview_settle_ms, accumulating at the same scale meanwhile. Only then
+         * rendering starts over at full resolution.
+         */
+        bool was_preview = frame_preview;
+        double now = glfwGetTime();
+        if(camera_changed)
+            last_camera_move = now;
+        bool settling = was_preview && (now - last_camera_move) * 1000.0 < frame_settings.preview_settle_ms;
+        frame_preview = frame_settings.preview_enabled && !wavefront && !persistent && cl_manager.helper_devices.empty() && (camera_changed || settling) && !resuming;
+        if(frame_preview && camera_changed && !choosePreviewScale(was_preview))
+            return false;
+        if(was_preview && !frame_preview)
+        {
+            force_reset = true;
+            depth_valid = false;
         }
-    }
 
-    void RendererCore::updateRenderKernelArgs(bool new_gi_check, cl_uint seed)
-    {
-        cl_int err = 0, new_reset = 0;
-        /* Switch Buffers. The image written to earlier is now read only. The color value is read from it the averaged with the new color
-         * computed and written to the image that was previously read-only.
+        // Tile timings of a frame at another resolution say nothing about the next one.
+        if(frame_settings.adaptive_tiles && !frame_preview && !was_preview)
+            adaptTileSize();
+        cl_uint seed = dist(mt_engine);
+        updateRenderKernelArgs(new_gi_check, camera_changed, seed);
+        if(frame_preview)
+            bindPreviewImages();
+
+        /* A fused frame is tonemapped by the rendering kernel itself into the display image that isn't on screen. Anything that
+         * works on the whole accumulated image before display, and preview frames which are upscaled first, needs the split path.
+         * Adaptive sampling skips converged pixels, which would stay stale in the display images. The kernel only has the Reinhard
+         * operator of the built-in tonemap and gets it's white point, so it stands in for neither a custom post-processing kernel nor
+         * auto-exposure, which also scales the color. Blocks of secondary devices are composited without display pixels, so
+         * multi-device frames aren't fused either.
          */
-
-        if(buffer_switch)
+        fused_frame = do_postproc && fused_arg >= 0 && frame_settings.fused_tonemap && builtin_tonemap && !(exposure_arg >= 0 && frame_settings.auto_exposure) && !frame_preview
+                      && !adaptive_sampling && !(cost_heatmap && frame_settings.show_heatmap) && !(feature_buffers && frame_settings.denoise) && cl_manager.helper_devices.empty();
+        display_target = fused_frame ? claimDisplay() : -1;
+        if(fused_arg >= 0)
         {
-            err = clSetKernelArg(cl_manager.rend_kernel, 0, sizeof(cl_manager.image_buffers[0]), &cl_manager.image_buffers[0]);
-            CLManager::checkError(err, __FILE__, __LINE__ -1);
-
-            err = clSetKernelArg(cl_manager.rend_kernel, 1, sizeof(cl_manager.image_buffers[1]), &cl_manager.image_buffers[1]);
+            cl_int write_display = fused_frame ? 1 : 0;
+            cl_float lum_white = whitePoint();
+            err  = clSetKernelArg(cl_manager.rend_kernel, fused_arg, sizeof(cl_mem), &cl_manager.display_images[std::max(display_target, 0)]);
+            err |= clSetKernelArg(cl_manager.rend_kernel, fused_arg + 1, sizeof(cl_int), &write_display);
+            err |= clSetKernelArg(cl_manager.rend_kernel, fused_arg + 2, sizeof(cl_float), &lum_white);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
         }
-        else
+        if(reset == 1)
         {
-            err = clSetKernelArg(cl_manager.rend_kernel, 0, sizeof(cl_manager.image_buffers[1]), &cl_manager.image_buffers[1]);
-            CLManager::checkError(err, __FILE__, __LINE__ -1);
-
-            err = clSetKernelArg(cl_manager.rend_kernel, 1, sizeof(cl_manager.image_buffers[0]), &cl_manager.image_buffers[0]);
-            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            samples_rendered = 0;
+            resetConvergence();
         }
+        start_time = glfwGetTime();
+        frame_time_rk = 0;
+
+        // Secondary devices are measured once their last frame is read back. Until then they keep their share.
+        helpers.retire(false);
+        tile_scheduler.schedule(frame_settings.blocks, frame_blocks, helpers.getBlocks());
+        if(wavefront && !wf_stages.setup(render_scene, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height, frame_settings.blocks,
+                                         frame_settings.rk_gws, frame_settings.max_bounces, gi_check, seed))
+            return false;
 
-        // Set the reset flag to 1 when Camera changes orientation. This configures kernel to write the current color instead of averaging it with the previous one.
-        if(render_scene.main_camera.is_changed)
-        {
-            new_reset = 1;
-            Cam* mapped_memory = (Cam*) clEnqueueMapBuffer( cl_manager.comm_queue,
-                                                                      cl_manager.camera_buffer,
-                                                                      CL_TRUE,
-                                                                      CL_MAP_WRITE,
-                                                                      (size_t) 0,
-                                                                      sizeof(Cam),
-                                                                      0,
-                                                                      NULL,
-                                                                      NULL,
-                                                                      &err
-                                                                     );
+        if(ray_counting)
+            ray_counters.beginFrame(frame_settings.counter_interval);
+
+        // The images stay acquired until the frame is finished.
+        acquireGLObjects(true, display_target);
+        clFlush(cl_manager.comm_queue);
+
+        //Secondary devices start on their share of the frame while the primary device works through it's own blocks.
+        helpers.enqueue(buffer_switch ? 1 : 0, reset != 1, frame_settings.blocks, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height,
+                        frame_settings.rk_gws, frame_settings.rk_lws, persistent, persistent_lws, frame_settings.persistent_groups_per_cu);
+
+        //Adaptive sampling replaces the tiles of the frame with ranges of the list of pixels that haven't converged yet.
+        if(adaptive_sampling)
+            compactActivePixels();
+        curr_block = 0;
+        ray_counters.reserveTiles(frame_blocks.size());
+        return true;
+    }
+
+    void RendererCore::finishFrame(FrameResult& frame)
+    {
+        YUNE_TRACE_SCOPE("submit", "Finish Frame");
+        cl_int err = 0;
+        unsigned long samples = samples_rendered + frame_spp;
+        int accumulation = buffer_switch ? 0 : 1;
+
+        //Read the counters of a sampled frame back without stalling. They are turned into statistics once the read completes.
+        ray_counters.finishFrame(frame_time_rk);
+
+        //The count has arrived by now unless the frame had no tiles left to wait for.
+        if(active_count_event)
+            readActiveCount(true);
+
+        //A preview frame replaces the full resolution frame it's displayed as.
+        if(frame_preview)
+            upscalePreview();
+
+        //Bring in the blocks rendered by secondary devices before the frame is post-processed or displayed.
+        //The primary device is measured along with them, the share of every device follows from the ratio.
+        if(!frame_blocks.empty())
+            tile_scheduler.measure(0, frame_time_rk / frame_blocks.size());
+        helpers.composite(buffer_switch ? 0 : 1);
+
+        //Compare the finished frame against an earlier snapshot to estimate how much noise is left.
+        evaluateConvergence();
+
+        // What the GUI thread does with the frame. Saves and checkpoints read it's images, so no frame is started until they were read.
+        frame.display = -1;
+        frame.accumulation = accumulation;
+        frame.preview = frame_preview;
+        frame.save = frame_save;
+        frame.save_samples = frame_settings.save_at_samples > 0 && samples_rendered <= frame_settings.save_at_samples && samples > frame_settings.save_at_samples && !frame_preview;
+        frame.checkpoint = checkpointDue(samples);
+        frame.auto_stopped = autoStopDue();
+
+        //Enqueue Post Processing kernel if post-proc enabled. The heatmap view takes the post-processing kernel's place.
+        //A frame that's saved is post-processed as usual into the display image that isn't on screen and the heatmap stays up.
+        bool heatmap_view = cost_heatmap && frame_settings.show_heatmap && !frame_preview;
+        bool save_due = frame.save || frame.save_samples || frame.auto_stopped;
+        bool show_cost = heatmap_view && !save_due;
+        countImageTraffic(show_cost);
+
+        //A fused frame is already in it's display image.
+        if(fused_frame)
+            frame.display = display_target;
+        else if(do_postproc || show_cost)
+        {
+            display_target = claimDisplay();
+            acquireGLObjects(false, display_target);
+
+            DisplayPass pass;
+            pass.ppk_event = pass.luminance_event = NULL;
+            size_t* lws = NULL;
+            if(show_cost)
+            {
+                cl_int channel = frame_settings.heatmap_channel;
+                cl_float max_cost = std::max(frame_settings.heatmap_max, 1e-3f);
+                err  = clSetKernelArg(cl_manager.heatmap_kernel, 0, sizeof(cl_mem), &cl_manager.image_buffers[2]);
+                err |= clSetKernelArg(cl_manager.heatmap_kernel, 1, sizeof(cl_mem), &cl_manager.display_images[display_target]);
+                err |= clSetKernelArg(cl_manager.heatmap_kernel, 2, sizeof(cl_int), &channel);
+                err |= clSetKernelArg(cl_manager.heatmap_kernel, 3, sizeof(cl_float), &max_cost);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+            else
+            {
+                updatePostProcessingKernelArgs();
+                cl_mem ppk_input = cl_manager.image_buffers[accumulation];
+                if(feature_buffers && frame_settings.denoise && !frame_preview)
+                    ppk_input = enqueueDenoise(pass.denoise_events);
+                if(exposure_arg >= 0)
+                    enqueueLuminanceReduction(ppk_input, &pass.luminance_event);
+                if(frame_settings.rk_lws[0] > 0 && frame_settings.rk_lws[1] > 0)
+                    lws = frame_settings.ppk_lws;
+            }
+            err = clEnqueueNDRangeKernel(cl_manager.comm_queue,     // command queue
+                                         show_cost ? cl_manager.heatmap_kernel : cl_manager.pp_kernel,      // kernel
+                                         2,                         // global work dimensions
+                                         NULL,                      // global work offset
+                                         frame_settings.ppk_gws,    // global workgroup size
+                                         lws,                   // local workgroup size
+                                         0,                         // Number of events in wait list.
+                                         NULL,                      // Events in wait list
+                                         &pass.ppk_event            // Event
+                                        );
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            display_passes.push_back(pass);
+            watchEvent(pass.ppk_event);
+            clRetainEvent(pass.ppk_event);
+            frame.display_event = pass.ppk_event;
+            frame.display = display_target;
+        }
+        //Else the GUI thread copies the latest frame into the display image that isn't on screen
+        else
+        {
+            frame.display = claimDisplay();
+            frame.blit = true;
+        }
+        frame.show = !(heatmap_view && save_due);
+
+        // A reader wants the progressive render, not upscaled previews. Frames completing while a read is in flight are skipped.
+        if(frame_settings.publish_frames && !frame_preview && !publish_in_flight && ++frames_since_publish >= std::max(frame_settings.publish_interval, 1))
+        {
+            YUNE_TRACE_SCOPE("io", "Publish Frame");
+            frames_since_publish = 0;
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {(size_t) glfw_manager.framebuffer_width, (size_t) glfw_manager.framebuffer_height, 1};
+            publish_pixels.resize(region[0] * region[1] * 4);
+            err = clEnqueueReadImage(cl_manager.comm_queue, cl_manager.image_buffers[accumulation], CL_FALSE, origin, region, 0, 0,
+                                     publish_pixels.data(), 0, NULL, &frame.publish_event);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            watchEvent(frame.publish_event);
+            frame.publish_samples = samples;
+            publish_in_flight = true;
+        }
+
+        releaseGLObjects();
+        clFlush(cl_manager.comm_queue);
+
+        frame.hold = frame.blit || frame.save || frame.save_samples || frame.checkpoint || frame.auto_stopped;
+        buffer_switch = !buffer_switch;
+        samples_rendered = samples;
+        frame_stats.frames++;
+        frame_stats.frame_time += glfwGetTime() - start_time;
+        snapshotStats(frame);
+        frame.valid = true;
+    }
+
+    int RendererCore::claimDisplay()
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex);
+        int target = 1 - shown_display;
+        if(mailbox.valid && mailbox.display == target)
+        {
+            if(mailbox.display_event)
+                clReleaseEvent(mailbox.display_event);
+            mailbox.display_event = NULL;
+            mailbox.display = -1;
+        }
+        return target;
+    }
+
+    RendererCore::FrameSettings RendererCore::currentSettings() const
+    {
+        FrameSettings s;
+        s.blocks = blocks;
+        for(int i = 0; i < 2; i++)
+        {
+            s.rk_gws[i] = rk_gws[i];
+            s.rk_lws[i] = rk_lws[i];
+            s.ppk_gws[i] = ppk_gws[i];
+            s.ppk_lws[i] = ppk_lws[i];
+        }
+        s.max_bounces = max_bounces;
+        s.spp_per_launch = spp_per_launch;
+        s.tiles_in_flight = tiles_in_flight;
+        s.target_ms_per_tile = target_ms_per_tile;
+        s.adaptive_tiles = adaptive_tiles;
+        s.persistent_groups_per_cu = persistent_groups_per_cu;
+        s.counter_interval = counter_interval;
+        s.write_report = write_report;
+        s.show_heatmap = show_heatmap;
+        s.heatmap_channel = heatmap_channel;
+        s.heatmap_max = heatmap_max;
+        s.adaptive_threshold = adaptive_threshold;
+        s.adaptive_min_spp = adaptive_min_spp;
+        s.target_error = target_error;
+        s.time_budget = time_budget;
+        s.convergence_interval = convergence_interval;
+        s.denoise = denoise;
+        s.denoise_passes = denoise_passes;
+        s.denoise_sigma_color = denoise_sigma_color;
+        s.denoise_sigma_normal = denoise_sigma_normal;
+        s.denoise_sigma_depth = denoise_sigma_depth;
+        s.auto_exposure = auto_exposure;
+        s.exposure_key = exposure_key;
+        s.exposure_adapt_time = exposure_adapt_time;
+        s.exposure_histogram = exposure_histogram;
+        s.exposure_white_percentile = exposure_white_percentile;
+        s.fused_tonemap = fused_tonemap;
+        s.temporal_reprojection = temporal_reprojection;
+        s.temporal_max_history = temporal_max_history;
+        s.preview_enabled = preview_enabled;
+        s.preview_target_ms = preview_target_ms;
+        s.preview_max_scale = preview_max_scale;
+        s.preview_settle_ms = preview_settle_ms;
+        s.checkpoint_samples = checkpoint_samples;
+        s.checkpoint_minutes = checkpoint_minutes;
+        s.publish_frames = publish_frames;
+        s.publish_interval = publish_interval;
+        s.save_at_samples = save_at_samples;
+        return s;
+    }
+
+    void RendererCore::snapshotStats(FrameResult& frame)
+    {
+        frame.samples = samples_rendered;
+        frame.convergence_error = convergence.getError();
+        frame.stop_reason = auto_stop;
+        frame.stop_elapsed = auto_stop_elapsed;
+        frame.active_pixel_share = active_share;
+        frame.preview_scale = preview_divisor;
+        frame.exposure = exposure_meter.getScale();
+        frame.ray_stats = frame_ray_stats;
+        frame.device_share = tile_scheduler.getShare();
+        frame.blocks = tile_grid;
+        frame.stats = frame_stats;
+        frame_stats = FrameStats();
+    }
+
+    void RendererCore::retireDisplayPasses(bool wait)
+    {
+        while(!display_passes.empty())
+        {
+            DisplayPass& pass = display_passes.front();
+            cl_int status = CL_COMPLETE;
+            if(wait)
+                clWaitForEvents(1, &pass.ppk_event);
+            else
+                clGetEventInfo(pass.ppk_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if(status > CL_COMPLETE)
+                break;
+
+            // Get Profiling info for post-processing kernel
+            cl_ulong time_start, time_finish;
+            clGetEventProfilingInfo(pass.ppk_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+            clGetEventProfilingInfo(pass.ppk_event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+            Tracer::deviceEvent("device", "Post-Process", pass.ppk_event);
+            clReleaseEvent(pass.ppk_event);
+            frame_stats.ppk += (time_finish - time_start)/1000000.0;
+
+            // The denoising passes ran before the post-processing kernel on the same in-order queue.
+            for(cl_event event : pass.denoise_events)
+            {
+                clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+                clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+                Tracer::deviceEvent("device", "Denoise Pass", event);
+                clReleaseEvent(event);
+                frame_stats.denoise += (time_finish - time_start)/1000000.0;
+            }
+
+            if(pass.luminance_event)
+            {
+                clGetEventProfilingInfo(pass.luminance_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+                clGetEventProfilingInfo(pass.luminance_event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+                Tracer::deviceEvent("device", "Luminance Reduction", pass.luminance_event);
+                clReleaseEvent(pass.luminance_event);
+                frame_stats.exposure += (time_finish - time_start)/1000000.0;
+            }
+            display_passes.pop_front();
+        }
+    }
+
+    void RendererCore::submitTiles()
+    {
+        YUNE_TRACE_SCOPE("submit", "Submit Frame");
+        cl_int err = 0;
+        size_t* lws = NULL;
+        if(frame_settings.rk_lws[0] > 0 && frame_settings.rk_lws[1] > 0)
+            lws = frame_settings.rk_lws;
+
+        while(curr_block < frame_blocks.size() || !rk_events.empty())
+        {
+            if(active_count_event)
+                readActiveCount(false);
+            if(submit_abort)
+                curr_block = frame_blocks.size();
+
+            while((int) rk_events.size() < frame_settings.tiles_in_flight && curr_block < frame_blocks.size())
+            {
+                YUNE_TRACE_SCOPE("cl", "Enqueue Tile");
+                cl_int block = frame_blocks[curr_block];
+                err = clSetKernelArg(cl_manager.rend_kernel, 11, sizeof(cl_int), &block);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+                // With a wavefront program the paths of the tile are traced by the stage kernels first. The rendering kernel only accumulates them.
+                wf_events.push_back(std::vector<cl_event>());
+                if(wavefront)
+                    wf_stages.enqueue(block, frame_settings.rk_gws, frame_settings.rk_lws, wf_events.back());
+
+                // Persistent threads start taking pixels of the tile from 0. The queue is in-order so this can't affect a tile still in flight.
+                if(persistent)
+                {
+                    cl_int zero = 0;
+                    err = clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.work_counter_buffer, &zero, sizeof(cl_int), 0, sizeof(cl_int), 0, NULL, NULL);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+                }
+
+                cl_event rk_event;
+                err = clEnqueueNDRangeKernel(cl_manager.comm_queue, // command queue
+                                         cl_manager.rend_kernel,    // kernel
+                                         persistent ? 1 : 2,        // global work dimensions
+                                         NULL,                      // global work offset
+                                         persistent ? &persistent_gws : (frame_preview ? preview_gws : frame_settings.rk_gws),    // global workgroup size
+                                         persistent ? &persistent_lws : lws,       // local workgroup size
+                                         0,                         // Number of events in wait list.
+                                         NULL,                      // Events in wait list
+                                         &rk_event
+                                        );
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                rk_events.push_back(rk_event);
+                curr_block++;
+                frame_stats.launches++;
+                ray_counters.tileEnqueued();
+            }
+            clFlush(cl_manager.comm_queue);
+
+            if(rk_events.empty())
+                break;
+
+            // Blocking here only holds up this thread. The queue is in-order so tiles complete in the order they were enqueued.
+            err = clWaitForEvents(1, &rk_events.front());
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            while(!rk_events.empty())
+            {
+                clGetEventInfo(rk_events.front(), CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &rk_status, NULL);
+                if(rk_status != CL_COMPLETE)
+                    break;
+
+                // Get Profiling info for rendering kernel
+                cl_ulong time_start, time_finish;
+                clGetEventProfilingInfo(rk_events.front(), CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+                clGetEventProfilingInfo(rk_events.front(), CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+                Tracer::deviceEvent("device", wavefront ? "Accumulate" : "Render Tile", rk_events.front());
+                clReleaseEvent(rk_events.front());
+                rk_events.pop_front();
+                frame_stats.rk += (time_finish - time_start)/1000000.0;
+                frame_time_rk += (time_finish - time_start)/1000000.0;
+                frame_stats.stage[CLManager::WF_KERNEL_COUNT] += (time_finish - time_start)/1000000.0;
+
+                // Stage kernels of a wavefront tile. The first one is generate, followed by extend, shade and connect kernels for every bounce.
+                for(size_t i = 0; i < wf_events.front().size(); i++)
+                {
+                    cl_event event = wf_events.front()[i];
+                    int stage = i == 0 ? (int) CLManager::WF_GENERATE : (int) (CLManager::WF_EXTEND + (i - 1) % (CLManager::WF_KERNEL_COUNT - 1));
+                    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+                    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_finish), &time_finish, NULL);
+                    Tracer::deviceEvent("device", wf_stage_names[stage], event);
+                    clReleaseEvent(event);
+                    frame_stats.rk += (time_finish - time_start)/1000000.0;
+                    frame_time_rk += (time_finish - time_start)/1000000.0;
+                    frame_stats.stage[stage] += (time_finish - time_start)/1000000.0;
+                }
+                wf_events.pop_front();
+            }
+        }
+    }
+
+    bool RendererCore::renderCPUFrame(bool new_gi_check, bool cap_fps)
+    {
+        gpu_signalled = false;
+        frame_settings = currentSettings();
+        bool show_error = !pollSaves(false);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.fbo_ID);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glDrawBuffer(GL_BACK);
+
+        // Once the worker threads are done, upload the frame and store a copy of it for blitting later.
+        if(cpu_frame_pending)
+        {
+            if(!cpu_renderer.isFrameDone())
+                return true;
+            cpu_frame_pending = false;
+
+            frame_stats.frames++;
+            frame_stats.launches++;
+            frame_stats.rk += cpu_renderer.frame_ms;
+            frame_stats.frame_time += glfwGetTime() - start_time;
+
+            glBindTexture(GL_TEXTURE_2D, glfw_manager.upload_tex_ID);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height, GL_RGBA, GL_FLOAT,
+                            cpu_renderer.getDisplayImage().data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            //The upload texture is drawn as is by render(). Saves read it through it's own FBO.
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.upload_fbo_ID);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+            // The host backend has no submission thread, it's statistics are taken over right away.
+            unsigned long samples = samples_rendered + frame_spp;
+            bool save_samples = save_at_samples > 0 && samples_rendered <= save_at_samples && samples > save_at_samples;
+            bool stopped = autoStopDue();
+            samples_rendered = samples;
+            FrameResult frame = FrameResult();
+            snapshotStats(frame);
+            endFrame(frame);
+
+            //  If samples taken is equal to the option specified at which to take a screen shot, save the image.
+            if(save_samples)
+                show_error |= !saveImage(save_samples_fn, save_samples_ext);
+
+            //If save button was pressed, save the current image.
+            if(save_pending)
+            {
+                show_error |= !saveImage(save_fn, save_ext);
+                save_pending = false;
+            }
+
+            if(stopped)
+                show_error |= !saveAutoStop();
+        }
+
+        //We start rendering the next frame only if previous frame was blitted through render().
+        if(!render_nextframe && cap_fps)
+            return !show_error;
+        if(auto_stop != STOP_NONE && !render_scene.main_camera.is_changed && new_gi_check == gi_check)
+            return !show_error;
+
+        // Reset the accumulated samples when the Camera changes orientation or GI is toggled.
+        reset = 0;
+        if(render_scene.main_camera.is_changed)
+        {
+            render_scene.main_camera.setBuffer(&cam_data);
+            reset = 1;
+        }
+        if(gi_check != new_gi_check)
+        {
+            gi_check = new_gi_check;
+            reset = 1;
+        }
+        if(reset == 1)
+        {
+            samples_rendered = 0;
+            resetConvergence();
+        }
+
+        frame_spp = std::max(spp_per_launch, 1);
+        start_time = glfwGetTime();
+        render_nextframe = false;
+        cpu_renderer.startFrame(cam_data, gi_check, reset == 1, dist(mt_engine), frame_spp, do_postproc);
+        cpu_frame_pending = true;
+        return !show_error;
+    }
+
+    void RendererCore::render()
+    {
+        YUNE_TRACE_SCOPE("gl", "Blit to Back Buffer");
+        render_nextframe = true;
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glfw_manager.drawDisplay(cpu_backend ? glfw_manager.upload_tex_ID : glfw_manager.display_tex_IDs[shown_display]);
+    }
+
+    void RendererCore::FrameStats::add(const FrameStats& other)
+    {
+        frames += other.frames;
+        launches += other.launches;
+        frame_time += other.frame_time;
+        rk += other.rk;
+        ppk += other.ppk;
+        denoise += other.denoise;
+        exposure += other.exposure;
+        image_bytes += other.image_bytes;
+        for(int i = 0; i <= CLManager::WF_KERNEL_COUNT; i++)
+            stage[i] += other.stage[i];
+    }
+
+    void RendererCore::endFrame(const FrameResult& frame)
+    {
+        // The next frame can be started right away.
+        gpu_signalled = true;
+        samples_taken = frame.samples;
+        convergence_error = frame.convergence_error;
+        stop_reason = frame.stop_reason;
+        stop_elapsed = frame.stop_elapsed;
+        active_pixel_share = frame.active_pixel_share;
+        preview_scale = frame.preview_scale;
+        exposure = frame.exposure;
+        ray_stats = frame.ray_stats;
+        device_share = frame.device_share;
+        bench_stats.add(frame.stats);
+
+        // Show the grid adaptive tiles settled on. The submission thread keeps it's own, so this doesn't feed back into it.
+        if(adaptive_tiles && !cpu_backend && frame.blocks != blocks)
+        {
+            blocks = frame.blocks;
+            updateKernelWGSize();
+        }
+
+        //Show ms per frame and per kernel averaged over 1 sec intervals...
+        if(glfwGetTime() - last_time >= 1.0 && bench_stats.frames > 0)
+        {
+            int frames = bench_stats.frames;
+            int launches = std::max(bench_stats.launches, 1);
+            mspf_uncapped_avg = bench_stats.frame_time * 1000.0 / frames;     // Redundant calculation, may come handy later
+
+            mspf_avg = (glfwGetTime() - last_time) * 1000/frames;
+            ms_per_rk = (float) bench_stats.rk / launches;
+            ms_per_ppk = (float) bench_stats.ppk / frames;
+            ms_per_denoise = (float) bench_stats.denoise / frames;
+            ms_per_exposure = (float) bench_stats.exposure / frames;
+            mb_per_frame = (float) (bench_stats.image_bytes / frames / 1000000.0);
+            for(int i = 0; i <= CLManager::WF_KERNEL_COUNT; i++)
+                ms_per_stage[i] = (float) bench_stats.stage[i] / launches;
+
+            time_passed++;
+            fps = frames;
+            last_time = glfwGetTime();
+            bench_stats = FrameStats();
+        }
+    }
+
+    void RendererCore::compactActivePixels()
+    {
+        YUNE_TRACE_SCOPE("cl", "Compact Active Pixels");
+        cl_int err = 0;
+        int width = glfw_manager.framebuffer_width, height = glfw_manager.framebuffer_height;
+        cl_mem* images = cl_manager.image_buffers;
+        if(frame_preview)
+        {
+            width = cl_manager.preview_width;
+            height = cl_manager.preview_height;
+            images = cl_manager.preview_images;
+        }
+
+        // The rendering kernel reads from images[1] and writes to images[0] when buffer_switch is set, see updateRenderKernelArgs().
+        cl_mem input = images[buffer_switch ? 1 : 0];
+        cl_mem output = images[buffer_switch ? 0 : 1];
+        cl_float threshold = frame_settings.adaptive_threshold;
+        cl_int min_spp = std::max(frame_settings.adaptive_min_spp, 2);
+        cl_int zero = 0;
+
+        err = clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.active_count_buffer, &zero, sizeof(cl_int), 0, sizeof(cl_int), 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        err  = clSetKernelArg(cl_manager.compact_kernel, 0, sizeof(cl_mem), &input);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 1, sizeof(cl_mem), &output);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 2, sizeof(cl_mem), &cl_manager.moments_buffer);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 3, sizeof(cl_mem), &cl_manager.active_pixel_buffer);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 4, sizeof(cl_mem), &cl_manager.active_count_buffer);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 5, sizeof(cl_float), &threshold);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 6, sizeof(cl_int), &min_spp);
+        err |= clSetKernelArg(cl_manager.compact_kernel, 7, sizeof(cl_int), &reset);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        // 8x8 work-groups keep the pixels of a list range in small square clusters.
+        size_t lws[2] = {8, 8};
+        size_t gws[2] = {(size_t) (width + 7) / 8 * 8, (size_t) (height + 7) / 8 * 8};
+        err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.compact_kernel, 2, NULL, gws, lws, 0, NULL, &compact_event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        /* The frame starts out with enough tiles for every pixel, and tiles past the count return right away. The count is read without
+         * waiting and the remaining tiles are dropped once it arrives. The queue is in-order, so that's no later than the first tile
+         * completing and at most tiles_in_flight tiles are enqueued for nothing.
+         */
+        active_count = 0;
+        err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.active_count_buffer, CL_FALSE, 0, sizeof(cl_int), &active_count, 0, NULL, &active_count_event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        frame_blocks.resize(frame_settings.blocks.x * frame_settings.blocks.y);
+        for(size_t i = 0; i < frame_blocks.size(); i++)
+            frame_blocks[i] = i;
+    }
+
+    void RendererCore::readActiveCount(bool wait)
+    {
+        cl_int status = CL_COMPLETE;
+        if(wait)
+            clWaitForEvents(1, &active_count_event);
+        else
+            clGetEventInfo(active_count_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        if(status > CL_COMPLETE)
+            return;
+        Tracer::deviceEvent("device", "Compact Active Pixels", compact_event);
+        clReleaseEvent(compact_event);
+        clReleaseEvent(active_count_event);
+        active_count_event = compact_event = NULL;
+
+        int width = frame_preview ? cl_manager.preview_width : glfw_manager.framebuffer_width;
+        int height = frame_preview ? cl_manager.preview_height : glfw_manager.framebuffer_height;
+        int tile_pixels = (int) std::ceil((float) width / frame_settings.blocks.x) * (int) std::ceil((float) height / frame_settings.blocks.y);
+        size_t num_blocks = std::max((active_count + tile_pixels - 1) / tile_pixels, 1);
+        frame_blocks.resize(std::max(std::min(num_blocks, frame_blocks.size()), curr_block));
+        active_share = (float) active_count / std::max(width * height, 1);
+    }
+
+    void RendererCore::evaluateConvergence()
+    {
+        // The estimate is only needed to stop automatically or to be reported. Preview frames are reset every frame anyway.
+        if((frame_settings.target_error <= 0 && !frame_settings.write_report) || frame_preview)
+            return;
+
+        // The frame that just finished was written to image_buffers[0] if buffer_switch is set, see updateRenderKernelArgs().
+        cl_mem image = cl_manager.image_buffers[buffer_switch ? 0 : 1];
+        convergence.evaluate(image, glfw_manager.framebuffer_width, glfw_manager.framebuffer_height, samples_rendered + frame_spp, frame_settings.convergence_interval);
+    }
+
+    void RendererCore::resetConvergence()
+    {
+        convergence.reset();
+        auto_stop = STOP_NONE;
+        auto_stop_elapsed = 0;
+        budget_start = glfwGetTime();
+    }
+
+    bool RendererCore::autoStopDue()
+    {
+        if(auto_stop != STOP_NONE)
+            return false;
+        if(frame_settings.target_error > 0 && convergence.getError() >= 0 && convergence.getError() <= frame_settings.target_error)
+            auto_stop = STOP_CONVERGED;
+        else if(frame_settings.time_budget > 0 && glfwGetTime() - budget_start >= frame_settings.time_budget)
+            auto_stop = STOP_TIME_BUDGET;
+        else
+            return false;
+        auto_stop_elapsed = glfwGetTime() - budget_start;
+        return true;
+    }
+
+    bool RendererCore::saveAutoStop()
+    {
+        //The image is saved where "Save At Samples" would save it, always with a report of the error reached. No new frames are started until the accumulation is reset.
+        bool status = saveImage(save_samples_fn, save_samples_ext);
+        if(status && !write_report)
+            status = writeReport(save_samples_fn);
+        return status;
+    }
+
+    bool RendererCore::writeReport(const std::string& image_fn)
+    {
+        std::string report_fn = image_fn.substr(0, image_fn.find_last_of('.')) + ".txt";
+        std::ofstream report(report_fn);
+        if(!report)
+        {
+            setMessageCb("Error writing the render report \"" + report_fn + "\".", "Error!", "");
+            return false;
+        }
+
+        report << "Image           : " << image_fn << "\n"
+               << "Resolution      : " << glfw_manager.framebuffer_width << "x" << glfw_manager.framebuffer_height << "\n"
+               << "Rendering Kernel: " << (cpu_backend ? std::string("CPU Backend") : cl_manager.rk_file) << "\n"
+               << "Post-Proc Kernel: " << (do_postproc ? cl_manager.ppk_file : std::string("None")) << "\n"
+               << "Render Time     : " << time_passed << " sec\n"
+               << "Samples Taken   : " << samples_taken << " spp\n"
+               << "FPS             : " << fps << "\n"
+               << "ms/frame        : " << mspf_avg << "\n"
+               << "ms/rk           : " << ms_per_rk << "\n"
+               << "ms/ppk          : " << ms_per_ppk << "\n";
+
+        if(adaptive_sampling)
+            report << "Active pixels   : " << active_pixel_share * 100 << " %\n";
+        if(convergence_error >= 0)
+            report << "Relative MSE    : " << convergence_error << "\n";
+        if(target_error > 0)
+            report << "Target rel. MSE : " << target_error << "\n";
+        if(time_budget > 0)
+            report << "Time budget     : " << time_budget << " sec\n";
+        if(stop_reason != STOP_NONE)
+            report << "Stopped by      : " << (stop_reason == STOP_CONVERGED ? "Error target" : "Time budget") << " after "
+                   << stop_elapsed << " sec\n";
+
+        if(ray_stats.valid)
+        {
+            report << "Mrays/s         : " << ray_stats.mrays_per_sec << "\n"
+                   << "Rays/frame      : " << ray_stats.rays << "\n"
+                   << "Nodes/ray       : " << ray_stats.nodes_per_ray << "\n"
+                   << "Tri tests/ray   : " << ray_stats.triangle_tests_per_ray << "\n"
+                   << "Shadow rays     : " << ray_stats.shadow_ray_share * 100 << " %\n"
+                   << "Path length histogram\n";
+            for(int i = 0; i < CLManager::PATH_LENGTH_BINS; i++)
+                report << "  " << (i + 1) << (i == CLManager::PATH_LENGTH_BINS - 1 ? "+" : "") << "\t: " << ray_stats.path_length[i] << "\n";
+        }
+        return true;
+    }
+
+    void RendererCore::adaptTileSize()
+    {
+        if(frame_blocks.empty() || frame_time_rk <= 0)
+            return;
+        applyTileGrid(tile_scheduler.adaptGrid(frame_settings.blocks, frame_time_rk / frame_blocks.size(), frame_settings.target_ms_per_tile,
+                                               glfw_manager.framebuffer_width, glfw_manager.framebuffer_height));
+    }
+
+    void RendererCore::applyTileGrid(glm::ivec2 grid)
+    {
+        // The launch size set in the GUI belongs to the grid set there. Any other grid gets the size that covers the framebuffer.
+        if(grid != frame_settings.blocks)
+        {
+            frame_settings.blocks = grid;
+            frame_settings.rk_gws[0] = std::ceil((float)glfw_manager.framebuffer_width/grid.x);
+            frame_settings.rk_gws[1] = std::ceil((float)glfw_manager.framebuffer_height/grid.y);
+        }
+        if(grid == tile_grid)
+            return;
+        tile_grid = grid;
+
+        cl_int err = 0;
+        cl_int bx = grid.x;
+        cl_int by = grid.y;
+        err  = clSetKernelArg(cl_manager.rend_kernel, 12, sizeof(cl_int), &bx);
+        err |= clSetKernelArg(cl_manager.rend_kernel, 13, sizeof(cl_int), &by);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+        {
+            err  = clSetKernelArg(helper.rend_kernel, 12, sizeof(cl_int), &bx);
+            err |= clSetKernelArg(helper.rend_kernel, 13, sizeof(cl_int), &by);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
+    }
+
+    void RendererCore::updateRenderKernelArgs(bool new_gi_check, bool camera_changed, cl_uint seed)
+    {
+        cl_int err = 0, new_reset = 0;
+        bool camera_moved = false, gi_toggled = false;
+        /* Switch Buffers. The image written to earlier is now read only. The color value is read from it the averaged with the new color
+         * computed and written to the image that was previously read-only.
+         */
+
+        if(buffer_switch)
+        {
+            err = clSetKernelArg(cl_manager.rend_kernel, 0, sizeof(cl_manager.image_buffers[0]), &cl_manager.image_buffers[0]);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
 
-            render_scene.main_camera.setBuffer(mapped_memory);
+            err = clSetKernelArg(cl_manager.rend_kernel, 1, sizeof(cl_manager.image_buffers[1]), &cl_manager.image_buffers[1]);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
+        else
+        {
+            err = clSetKernelArg(cl_manager.rend_kernel, 0, sizeof(cl_manager.image_buffers[1]), &cl_manager.image_buffers[1]);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
 
-            err = clEnqueueUnmapMemObject(cl_manager.comm_queue, cl_manager.camera_buffer, mapped_memory, 0, NULL, NULL);
+            err = clSetKernelArg(cl_manager.rend_kernel, 1, sizeof(cl_manager.image_buffers[0]), &cl_manager.image_buffers[0]);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
 
-            err = clSetKernelArg(cl_manager.rend_kernel, 2, sizeof(cl_mem), &cl_manager.camera_buffer);
+        for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+        {
+            err  = clSetKernelArg(helper.rend_kernel, 0, sizeof(cl_mem), &helper.image_buffers[buffer_switch ? 0 : 1]);
+            err |= clSetKernelArg(helper.rend_kernel, 1, sizeof(cl_mem), &helper.image_buffers[buffer_switch ? 1 : 0]);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
         }
 
+        // Set the reset flag to 1 when Camera changes orientation. This configures kernel to write the current color instead of averaging it with the previous one.
+        if(camera_changed)
+        {
+            new_reset = 1;
+            camera_moved = true;
+
+            // Keep the camera the accumulated image was rendered with, temporal reprojection looks the history up through it. It's still in the current buffer.
+            if(temporal)
+            {
+                err = clEnqueueCopyBuffer(cl_manager.comm_queue, cl_manager.camera_buffer, cl_manager.prev_camera_buffer, 0, 0, sizeof(Cam), 0, NULL, NULL);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+
+            uploadCamera();
+        }
+
+        // Returning to full resolution after a preview. The full resolution images only hold an upscaled frame, not an accumulation.
+        if(force_reset)
+        {
+            new_reset = 1;
+            force_reset = false;
+        }
+
         // Pass GI check value. Change the reset value to 1.
         if(gi_check != new_gi_check)
         {
@@ -562,7 +1848,38 @@ namespace yune
 
             err = clSetKernelArg(cl_manager.rend_kernel, 8, sizeof(cl_int), &check);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
+            for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+            {
+                err = clSetKernelArg(helper.rend_kernel, 8, sizeof(cl_int), &check);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
             new_reset = 1;
+            gi_toggled = true;
+        }
+
+        // The camera and GI of a loaded checkpoint are set like any change, but the accumulation carries on from the checkpoint.
+        bool resumed = resuming;
+        if(resuming)
+        {
+            new_reset = 0;
+            resuming = false;
+        }
+
+        /* A reset frame writes the first-hit distances into one buffer while reading the ones of the previous reset from the other.
+         * History is only reprojected over a camera move. A GI toggle changes every pixel, so it discards the history like before.
+         */
+        if(temporal && new_reset == 1)
+        {
+            int tr_arg = cl_manager.getFeatureArg("temporal-reprojection");
+            cl_int reproject = frame_settings.temporal_reprojection && camera_moved && !gi_toggled && depth_valid;
+            cl_int max_history = std::max(frame_settings.temporal_max_history, 1);
+            err  = clSetKernelArg(cl_manager.rend_kernel, tr_arg + 1, sizeof(cl_mem), &cl_manager.depth_buffers[depth_switch]);
+            err |= clSetKernelArg(cl_manager.rend_kernel, tr_arg + 2, sizeof(cl_mem), &cl_manager.depth_buffers[1 - depth_switch]);
+            err |= clSetKernelArg(cl_manager.rend_kernel, tr_arg + 3, sizeof(cl_int), &reproject);
+            err |= clSetKernelArg(cl_manager.rend_kernel, tr_arg + 4, sizeof(cl_int), &max_history);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            depth_switch = 1 - depth_switch;
+            depth_valid = true;
         }
 
         // Pass reset value. If there was no change in reset value, no need to pass again.
@@ -571,11 +1888,253 @@ namespace yune
             reset = new_reset;
             err = clSetKernelArg(cl_manager.rend_kernel, 9, sizeof(cl_int), &reset);
             CLManager::checkError(err, __FILE__, __LINE__ -1);
+            for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+            {
+                err = clSetKernelArg(helper.rend_kernel, 9, sizeof(cl_int), &reset);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
+        }
+
+        // The feature buffers aren't part of a checkpoint, so the frame resuming one fills them like a reset would.
+        if(feature_buffers)
+        {
+            cl_int write_features = reset == 1 || resumed;
+            err = clSetKernelArg(cl_manager.rend_kernel, cl_manager.getFeatureArg("feature-buffers") + 2, sizeof(cl_int), &write_features);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
+
+        /* Samples taken per launch are latched for the whole frame. The kernel loops over them in registers and touches the
+         * accumulation image once, so more samples per launch trade latency for less launch overhead and image bandwidth.
+         */
+        frame_spp = 1;
+        int spp_arg = cl_manager.getFeatureArg("spp-per-launch");
+        if(spp_arg >= 0)
+        {
+            frame_spp = std::max(frame_settings.spp_per_launch, 1);
+            err = clSetKernelArg(cl_manager.rend_kernel, spp_arg, sizeof(cl_int), &frame_spp);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+            {
+                err = clSetKernelArg(helper.rend_kernel, spp_arg, sizeof(cl_int), &frame_spp);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+            }
         }
 
         // Pass a random seed value.
         err = clSetKernelArg(cl_manager.rend_kernel, 10, sizeof(cl_uint), &seed);
         CLManager::checkError(err, __FILE__, __LINE__ -1);
+        for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+        {
+            err = clSetKernelArg(helper.rend_kernel, 10, sizeof(cl_uint), &seed);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
+    }
+
+    cl_mem RendererCore::enqueueDenoise(std::vector<cl_event>& events)
+    {
+        YUNE_TRACE_SCOPE("cl", "Enqueue Denoise");
+        cl_int err = 0;
+        cl_mem image = cl_manager.image_buffers[buffer_switch ? 0 : 1];
+        cl_float sigma_normal = frame_settings.denoise_sigma_normal;
+        cl_float sigma_depth = std::max(frame_settings.denoise_sigma_depth, 1e-4f);
+        int passes = std::max(frame_settings.denoise_passes, 1);
+
+        err  = clSetKernelArg(cl_manager.denoise_kernel, 2, sizeof(cl_mem), &cl_manager.albedo_buffer);
+        err |= clSetKernelArg(cl_manager.denoise_kernel, 3, sizeof(cl_mem), &cl_manager.normal_depth_buffer);
+        err |= clSetKernelArg(cl_manager.denoise_kernel, 6, sizeof(cl_float), &sigma_normal);
+        err |= clSetKernelArg(cl_manager.denoise_kernel, 7, sizeof(cl_float), &sigma_depth);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        // Pass i reads the output of pass i-1, the first one reads the accumulated frame. The last output replaces the current frame given to the post-processing kernel.
+        for(int i = 0; i < passes; i++)
+        {
+            cl_mem input = i == 0 ? image : cl_manager.denoise_images[(i - 1) % 2];
+            cl_int step = 1 << i;
+            cl_float sigma_color = frame_settings.denoise_sigma_color / step;
+            cl_int demodulate = i == 0;
+            cl_int remodulate = i == passes - 1;
+
+            err  = clSetKernelArg(cl_manager.denoise_kernel, 0, sizeof(cl_mem), &input);
+            err |= clSetKernelArg(cl_manager.denoise_kernel, 1, sizeof(cl_mem), &cl_manager.denoise_images[i % 2]);
+            err |= clSetKernelArg(cl_manager.denoise_kernel, 4, sizeof(cl_int), &step);
+            err |= clSetKernelArg(cl_manager.denoise_kernel, 5, sizeof(cl_float), &sigma_color);
+            err |= clSetKernelArg(cl_manager.denoise_kernel, 8, sizeof(cl_int), &demodulate);
+            err |= clSetKernelArg(cl_manager.denoise_kernel, 9, sizeof(cl_int), &remodulate);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+            cl_event event;
+            err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.denoise_kernel, 2, NULL, frame_settings.ppk_gws, NULL, 0, NULL, &event);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            events.push_back(event);
+        }
+
+        err = clSetKernelArg(cl_manager.pp_kernel, 0, sizeof(cl_mem), &cl_manager.denoise_images[(passes - 1) % 2]);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        return cl_manager.denoise_images[(passes - 1) % 2];
+    }
+
+    void RendererCore::enqueueLuminanceReduction(cl_mem image, cl_event* event)
+    {
+        // A new reduction starts once the last one was read. The exposure lags the image by a frame or so, which the smoothing hides.
+        if(frame_settings.auto_exposure)
+            exposure_meter.enqueueReduction(image, frame_settings.ppk_gws, event);
+
+        cl_int err = 0;
+        cl_float scale = frame_settings.auto_exposure ? exposure_meter.getScale() : 1.0f;
+        cl_float lum_white = whitePoint();
+        err  = clSetKernelArg(cl_manager.pp_kernel, exposure_arg, sizeof(cl_float), &scale);
+        err |= clSetKernelArg(cl_manager.pp_kernel, exposure_arg + 1, sizeof(cl_float), &lum_white);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    cl_float RendererCore::whitePoint() const
+    {
+        return frame_settings.auto_exposure ? exposure_meter.getWhitePoint() : 1.0f;
+    }
+
+    bool RendererCore::choosePreviewScale(bool was_preview)
+    {
+        // frame_time_rk still holds the previous frame. The number of pixels, and roughly the cost of a frame, falls with the square of the scale.
+        if(was_preview && frame_time_rk > 0 && frame_settings.preview_target_ms > 0)
+        {
+            float ratio = std::sqrt(frame_time_rk / frame_settings.preview_target_ms);
+            if(ratio > 1.25f || ratio < 0.8f)
+                preview_divisor = std::round(preview_divisor * ratio);
+        }
+        preview_divisor = std::min(std::max(preview_divisor, 2), std::max(frame_settings.preview_max_scale, 2));
+
+        int width = (glfw_manager.framebuffer_width + preview_divisor - 1) / preview_divisor;
+        int height = (glfw_manager.framebuffer_height + preview_divisor - 1) / preview_divisor;
+
+        // Reprojected history has to come from a frame of the same size.
+        if(!was_preview || width != cl_manager.preview_width || height != cl_manager.preview_height)
+            depth_valid = false;
+        if(!cl_manager.setupPreviewImages(width, height, half_images))
+            return false;
+
+        for(int i = 0; i < 2; i++)
+        {
+            preview_gws[i] = std::ceil((float) (i == 0 ? width : height) / frame_settings.blocks[i]);
+            if(frame_settings.rk_lws[0] > 0 && frame_settings.rk_lws[1] > 0)
+                preview_gws[i] = (preview_gws[i] + frame_settings.rk_lws[i] - 1) / frame_settings.rk_lws[i] * frame_settings.rk_lws[i];
+        }
+        return true;
+    }
+
+    void RendererCore::bindPreviewImages()
+    {
+        cl_int err = 0;
+        err  = clSetKernelArg(cl_manager.rend_kernel, 0, sizeof(cl_mem), &cl_manager.preview_images[buffer_switch ? 0 : 1]);
+        err |= clSetKernelArg(cl_manager.rend_kernel, 1, sizeof(cl_mem), &cl_manager.preview_images[buffer_switch ? 1 : 0]);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    void RendererCore::upscalePreview()
+    {
+        YUNE_TRACE_SCOPE("cl", "Upscale Preview");
+        cl_int err = 0;
+
+        err  = clSetKernelArg(cl_manager.upscale_kernel, 0, sizeof(cl_mem), &cl_manager.preview_images[buffer_switch ? 0 : 1]);
+        err |= clSetKernelArg(cl_manager.upscale_kernel, 1, sizeof(cl_mem), &cl_manager.image_buffers[buffer_switch ? 0 : 1]);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.upscale_kernel, 2, NULL, frame_settings.ppk_gws, NULL, 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        clFlush(cl_manager.comm_queue);
+    }
+
+    void RendererCore::uploadCamera()
+    {
+        YUNE_TRACE_SCOPE("upload", "Upload Camera");
+        cl_int err = 0;
+
+        /* The camera goes to the next buffer of the ring with non-blocking writes, so a camera move doesn't wait for the queue to drain.
+         * The queues are in-order, so kernels still in flight finish with the camera they were enqueued with either way. The staging
+         * copy of a slot is only reused after it's writes completed, which a frame later they always have.
+         */
+        camera_slot = (camera_slot + 1) % CLManager::CAMERA_RING_SIZE;
+        releaseCameraWrites(camera_slot);
+        frame_camera.setBuffer(&cam_data);
+        camera_staging[camera_slot] = cam_data;
+
+        cl_event event;
+        err = clEnqueueWriteBuffer(cl_manager.comm_queue, cl_manager.camera_buffers[camera_slot], CL_FALSE, 0, sizeof(Cam), &camera_staging[camera_slot],
+                                   0, NULL, &event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        camera_writes[camera_slot].push_back(event);
+
+        for(CLManager::HelperDevice& helper : cl_manager.helper_devices)
+        {
+            err = clEnqueueWriteBuffer(helper.comm_queue, helper.camera_buffer, CL_FALSE, 0, sizeof(Cam), &camera_staging[camera_slot], 0, NULL, &event);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+            camera_writes[camera_slot].push_back(event);
+        }
+
+        cl_manager.camera_buffer = cl_manager.camera_buffers[camera_slot];
+        err = clSetKernelArg(cl_manager.rend_kernel, 2, sizeof(cl_mem), &cl_manager.camera_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+    }
+
+    void RendererCore::releaseCameraWrites(int slot)
+    {
+        if(camera_writes[slot].empty())
+            return;
+        clWaitForEvents(camera_writes[slot].size(), camera_writes[slot].data());
+        for(cl_event event : camera_writes[slot])
+            clReleaseEvent(event);
+        camera_writes[slot].clear();
+    }
+
+    void RendererCore::countImageTraffic(bool show_cost)
+    {
+        /* Every pass over an image is counted as reading or writing each pixel once. Taps shared between neighbours are assumed to hit the
+         * cache, so this is a lower bound, but it follows the formats and passes in use closely enough to compare settings.
+         */
+        double pixels = (double) glfw_manager.framebuffer_width * glfw_manager.framebuffer_height;
+        double accum = sizeof(cl_float4);
+        double display = 4 * sizeof(cl_uchar);
+        double target = half_images ? 4 * sizeof(cl_half) : sizeof(cl_float4);
+        double bytes = 0;
+
+        // The rendering kernel reads and writes the accumulation of every pixel it renders. A preview frame is upscaled afterwards.
+        if(frame_preview)
+        {
+            double preview_pixels = (double) cl_manager.preview_width * cl_manager.preview_height;
+            bytes += preview_pixels * 3 * target + pixels * accum;
+        }
+        else
+        {
+            double rendered = pixels * (adaptive_sampling ? active_share : 1.0f);
+            bytes += rendered * 2 * accum;
+            if(cost_heatmap)
+                bytes += rendered * sizeof(cl_float4);
+            if(feature_buffers)
+                bytes += rendered * 2 * sizeof(cl_float4);
+        }
+
+        if(fused_frame)
+            bytes += pixels * display;
+        else if(show_cost)
+            bytes += pixels * (sizeof(cl_float4) + display);
+        else if(do_postproc)
+        {
+            double input = accum;
+            if(feature_buffers && frame_settings.denoise && !frame_preview)
+            {
+                // Every pass also reads the albedo and the normal and depth of it's pixels.
+                for(int i = 0; i < std::max(frame_settings.denoise_passes, 1); i++)
+                {
+                    bytes += pixels * (input + 2 * sizeof(cl_float4) + target);
+                    input = target;
+                }
+            }
+            if(exposure_arg >= 0 && frame_settings.auto_exposure)
+                bytes += pixels * input;
+            bytes += pixels * (input + display);
+        }
+        else
+            bytes += pixels * (accum + display);
+        frame_stats.image_bytes += bytes;
     }
 
     void RendererCore::updatePostProcessingKernelArgs()
@@ -596,8 +2155,8 @@ namespace yune
             err = clSetKernelArg(cl_manager.pp_kernel, 1, sizeof(cl_manager.image_buffers[0]), &cl_manager.image_buffers[0]);
         CLManager::checkError(err, __FILE__, __LINE__ -1);
 
-        //Pass Output Image to contain tonemapped data
-        err = clSetKernelArg(cl_manager.pp_kernel, 2, sizeof(cl_manager.image_buffers[2]), &cl_manager.image_buffers[2]);
+        //Pass Output Image to contain tonemapped data. It's the display image that isn't on screen.
+        err = clSetKernelArg(cl_manager.pp_kernel, 2, sizeof(cl_mem), &cl_manager.display_images[std::max(display_target, 0)]);
         CLManager::checkError(err, __FILE__, __LINE__ -1);
 
         //Pass Reset Value. This tells the kernel if previous frame is available for calculating exposure value
@@ -607,41 +2166,325 @@ namespace yune
 
     bool RendererCore::saveImage(std::string save_fn, std::string save_ext)
     {
-        int width = glfw_manager.framebuffer_width;
-        int height = glfw_manager.framebuffer_height;
+        YUNE_TRACE_SCOPE("io", "Save Image");
+        if(save_ext != ".hdr" && save_ext != ".exr" && save_ext != ".png" && save_ext != ".jpg")
+        {
+            setMessageCb("Error Saving Image. Please make sure a valid save file name is provided", "Error!", "");
+            return false;
+        }
+
+        /* The pixels are read into a pixel buffer object, so glReadPixels() returns without waiting for the GPU. pollSaves() copies them
+         * out once the fence has passed and the writer thread encodes them, so the render loop never waits on either.
+         */
+        PendingSave save;
+        save.job = image_writer.acquireJob();
+        save.job.filename = save_fn;
+        save.job.ext = save_ext;
+        save.floats = save_ext == ".hdr" || save_ext == ".exr";
+        save.aov_event = NULL;
+
+        // EXR images carry the raw accumulation with the sample count, plus the feature buffers if the kernel writes them.
+        if(save_ext == ".exr")
+        {
+            save.job.channels = 4;
+            save.job.half = exr_half;
+            save.job.threads = exr_threads;
+            if(feature_buffers && !save_preview && !cpu_backend)
+            {
+                size_t size = (size_t) glfw_manager.framebuffer_width * glfw_manager.framebuffer_height * 4;
+                save.job.albedo.resize(size);
+                save.job.normal_depth.resize(size);
+                try
+                {
+                    cl_int err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.albedo_buffer, CL_FALSE, 0, size * sizeof(cl_float), save.job.albedo.data(), 0, NULL, NULL);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+                    err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.normal_depth_buffer, CL_FALSE, 0, size * sizeof(cl_float), save.job.normal_depth.data(),
+                                              0, NULL, &save.aov_event);
+                    CLManager::checkError(err, __FILE__, __LINE__ -1);
+                }
+                catch(const std::exception& err)
+                {
+                    // The albedo read may still be writing into the job, which goes away on return.
+                    clFinish(cl_manager.comm_queue);
+                    setMessageCb(std::string("Error reading the feature buffers to save.\n") + err.what(), "Error!", "");
+                    return false;
+                }
+                clFlush(cl_manager.comm_queue);
+            }
+        }
+
+        // Floats come from the accumulation of the frame, 8-bit images from it's display image or the editor's back buffer.
+        if(save_editor && !save_pending && !save.floats)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glReadBuffer(GL_BACK);
+        }
+        else if(cpu_backend)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.upload_fbo_ID);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+        }
+        else
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.fbo_ID);
+            glReadBuffer(save.floats ? GL_COLOR_ATTACHMENT0 + save_accumulation : GL_COLOR_ATTACHMENT2 + save_display);
+        }
+        enqueueReadback(std::move(save));
+
+        // The report describes the render at the time it's saved, so it's written right away.
+        if(write_report)
+            return writeReport(save_fn);
+        return true;
+    }
 
-        int stride = (width % 4) + (width * 3);
-        bool status = false;
-        stbi_flip_vertically_on_write(1);
+    void RendererCore::enqueueReadback(PendingSave save)
+    {
+        save.job.width = glfw_manager.framebuffer_width;
+        save.job.height = glfw_manager.framebuffer_height;
+        save.size = (size_t) save.job.width * save.job.height * save.job.channels * (save.floats ? sizeof(float) : 1);
 
-        if(save_ext == ".hdr")
+        if(free_pbos.empty())
         {
-            float* img_data = new float[stride*height*3];
-            glReadPixels(0, 0, width, height, GL_RGB, GL_FLOAT, img_data);
-            status = stbi_write_hdr(save_fn.c_str(), width, height, 3, img_data);
-            delete[] img_data;
+            save.pbo = 0;
+            glGenBuffers(1, &save.pbo);
         }
         else
         {
-            unsigned char* img_data = new unsigned char[stride*height*3];
-            if(save_editor && !save_pending)
+            save.pbo = free_pbos.back();
+            free_pbos.pop_back();
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, save.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, save.size, NULL, GL_STREAM_READ);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, save.job.width, save.job.height, save.job.channels == 4 ? GL_RGBA : GL_RGB, save.floats ? GL_FLOAT : GL_UNSIGNED_BYTE, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        save.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pending_saves.push_back(std::move(save));
+    }
+
+    /* A checkpoint holds everything needed to continue the accumulation bit for bit: the raw RGBA32F image with the sample count of
+     * every pixel in alpha, the camera, the GI setting and the state of the random engine the frame seeds are drawn from.
+     */
+    static const char checkpoint_magic[8] = {'Y', 'U', 'N', 'E', 'C', 'K', 'P', '1'};
+
+    template<typename T>
+    static void appendBytes(std::string& header, const T& value)
+    {
+        header.append((const char*) &value, sizeof(T));
+    }
+
+    bool RendererCore::checkpointDue(unsigned long samples)
+    {
+        if(!frame_checkpoints || frame_preview)
+            return false;
+
+        // samples_rendered doesn't include the frame that just completed yet.
+        bool due = frame_settings.checkpoint_samples > 0 && samples / frame_settings.checkpoint_samples != samples_rendered / frame_settings.checkpoint_samples;
+        due |= frame_settings.checkpoint_minutes > 0 && glfwGetTime() - last_checkpoint >= frame_settings.checkpoint_minutes * 60;
+        if(due)
+            last_checkpoint = glfwGetTime();
+        return due;
+    }
+
+    bool RendererCore::saveCheckpoint(GLenum attachment, unsigned long samples)
+    {
+        YUNE_TRACE_SCOPE("io", "Checkpoint");
+        PendingSave save;
+        save.job = image_writer.acquireJob();
+        save.job.filename = checkpoint_fn;
+        save.job.ext = ".yck";
+        save.job.channels = 4;
+        save.floats = true;
+        save.aov_event = NULL;
+
+        // The submission thread is held until the frame was read, so the engine and camera are still the ones of this frame.
+        std::ostringstream engine_state;
+        engine_state << mt_engine;
+        std::string engine = engine_state.str();
+        const Camera& camera = frame_camera;
+
+        save.job.header.assign(checkpoint_magic, sizeof(checkpoint_magic));
+        appendBytes(save.job.header, (cl_int) glfw_manager.framebuffer_width);
+        appendBytes(save.job.header, (cl_int) glfw_manager.framebuffer_height);
+        appendBytes(save.job.header, (cl_int) gi_check);
+        appendBytes(save.job.header, (cl_ulong) samples);
+        appendBytes(save.job.header, camera.side);
+        appendBytes(save.job.header, camera.up);
+        appendBytes(save.job.header, camera.look_at);
+        appendBytes(save.job.header, camera.eye);
+        appendBytes(save.job.header, camera.y_FOV);
+        appendBytes(save.job.header, (cl_uint) engine.size());
+        save.job.header += engine;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.fbo_ID);
+        glReadBuffer(attachment);
+        enqueueReadback(std::move(save));
+        return true;
+    }
+
+    bool RendererCore::resumeCheckpoint(bool new_gi_check)
+    {
+        YUNE_TRACE_SCOPE("io", "Resume Checkpoint");
+        std::string fn = resume_fn;
+        resume_fn.clear();
+
+        // Per-pixel state other than the image isn't part of a checkpoint.
+        if(adaptive_sampling || !cl_manager.helper_devices.empty())
+        {
+            setMessageCb("Checkpoints can't be resumed with adaptive sampling or multiple devices.", "Error!", "");
+            return false;
+        }
+
+        std::ifstream file(fn, std::ios::binary);
+        char magic[sizeof(checkpoint_magic)];
+        cl_int width = 0, height = 0, gi = 0;
+        cl_ulong samples = 0;
+        glm::vec4 side, up, look_at, eye;
+        float y_FOV = 0;
+        cl_uint engine_size = 0;
+        file.read(magic, sizeof(magic));
+        file.read((char*) &width, sizeof(width));
+        file.read((char*) &height, sizeof(height));
+        file.read((char*) &gi, sizeof(gi));
+        file.read((char*) &samples, sizeof(samples));
+        file.read((char*) &side, sizeof(side));
+        file.read((char*) &up, sizeof(up));
+        file.read((char*) &look_at, sizeof(look_at));
+        file.read((char*) &eye, sizeof(eye));
+        file.read((char*) &y_FOV, sizeof(y_FOV));
+        file.read((char*) &engine_size, sizeof(engine_size));
+        if(!file || std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 || engine_size > 65536)
+        {
+            setMessageCb("\"" + fn + "\" is not a valid checkpoint.", "Error!", "");
+            return false;
+        }
+        if(width != glfw_manager.framebuffer_width || height != glfw_manager.framebuffer_height)
+        {
+            setMessageCb("The checkpoint was rendered at " + std::to_string(width) + "x" + std::to_string(height) + ". Set the same window size to resume it.", "Error!", "");
+            return false;
+        }
+        if((gi != 0) != new_gi_check)
+        {
+            setMessageCb(std::string("The checkpoint was rendered with Global Illumination ") + (gi ? "on" : "off") + ". Toggle it to match before resuming.", "Error!", "");
+            return false;
+        }
+
+        std::string engine(engine_size, '\0');
+        std::vector<float> pixels((size_t) width * height * 4);
+        file.read(&engine[0], engine_size);
+        file.read((char*) pixels.data(), pixels.size() * sizeof(float));
+        std::istringstream engine_state(engine);
+        std::mt19937 engine_restored;
+        engine_state >> engine_restored;
+        if(!file || !engine_state)
+        {
+            setMessageCb("\"" + fn + "\" is truncated.", "Error!", "");
+            return false;
+        }
+
+        // The next frame reads the accumulation from the image it didn't write last, see updateRenderKernelArgs().
+        glBindTexture(GL_TEXTURE_2D, glfw_manager.upload_tex_ID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.upload_fbo_ID);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, glfw_manager.fbo_ID);
+        glDrawBuffer(buffer_switch ? GL_COLOR_ATTACHMENT1 : GL_COLOR_ATTACHMENT0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, glfw_manager.fbo_ID);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glDrawBuffer(GL_BACK);
+
+        render_scene.main_camera.setViewMatrix(side, up, look_at, eye);
+        render_scene.main_camera.y_FOV = y_FOV;
+        render_scene.main_camera.updateViewPlaneDist();
+        render_scene.main_camera.is_changed = true;
+        mt_engine = engine_restored;
+        samples_rendered = samples_taken = samples;
+        depth_valid = false;
+        resetConvergence();
+        resuming = true;
+        last_checkpoint = glfwGetTime();
+        return true;
+    }
+
+    bool RendererCore::pollSaves(bool wait)
+    {
+        // A published frame only goes through the ring, readers use it in place from there.
+        if(publish_read)
+        {
+            cl_int status = CL_COMPLETE;
+            if(wait)
+                clWaitForEvents(1, &publish_read);
+            else
+                clGetEventInfo(publish_read, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if(status <= CL_COMPLETE)
+            {
+                YUNE_TRACE_SCOPE("io", "Publish Frame");
+                clReleaseEvent(publish_read);
+                publish_read = NULL;
+                if(status == CL_COMPLETE && publish_frames && frame_publisher.isOpen())
+                    frame_publisher.publish(publish_pixels.data(), publish_read_samples);
+                publish_in_flight = false;
+            }
+        }
+
+        while(!pending_saves.empty())
+        {
+            PendingSave& save = pending_saves.front();
+            if(save.aov_event)
             {
-                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-                glReadBuffer(GL_BACK);
+                cl_int status = CL_COMPLETE;
+                if(wait)
+                    clWaitForEvents(1, &save.aov_event);
+                else
+                    clGetEventInfo(save.aov_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+                if(status > CL_COMPLETE)
+                    break;
+                clReleaseEvent(save.aov_event);
+                save.aov_event = NULL;
             }
+
+            GLenum result = glClientWaitSync(save.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? std::numeric_limits<GLuint64>::max() : 0);
+            if(result == GL_TIMEOUT_EXPIRED)
+                break;
+            glDeleteSync(save.fence);
+
+            YUNE_TRACE_SCOPE("io", "Copy Readback");
+            if(save.floats)
+                save.job.hdr_pixels.resize(save.size / sizeof(float));
             else
-                glReadBuffer(GL_COLOR_ATTACHMENT3);
-            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, img_data);
+                save.job.pixels.resize(save.size);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, save.pbo);
+            void* data = result == GL_WAIT_FAILED ? NULL : glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, save.size, GL_MAP_READ_BIT);
+            if(data)
+            {
+                std::copy((unsigned char*) data, (unsigned char*) data + save.size,
+                          save.floats ? (unsigned char*) save.job.hdr_pixels.data() : save.job.pixels.data());
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            free_pbos.push_back(save.pbo);
 
-            if(save_ext == ".png")
-                status = stbi_write_png(save_fn.c_str(), width, height, 3, img_data, stride);
-            else if(save_ext == ".jpg")
-                status = stbi_write_jpg(save_fn.c_str(), width, height, 3, img_data, 100);
+            if(!data)
+            {
+                pending_saves.pop_front();
+                setMessageCb("Error reading back the image to save.", "Error!", "");
+                return false;
+            }
+            image_writer.submit(std::move(save.job));
+            pending_saves.pop_front();
+        }
 
-            delete[] img_data;
+        std::vector<std::string> failures = image_writer.takeFailures();
+        if(!failures.empty())
+        {
+            setMessageCb("Error Saving Image \"" + failures.front() + "\". Please make sure a valid save file name is provided", "Error!", "");
+            return false;
         }
-        if(!status)
-            setMessageCb("Error Saving Image. Please make sure a valid save file name is provided", "Error!", "");
-        return status;
+        return true;
     }
 }
@@ -25,10 +25,12 @@
 
 #include "RendererGUI.h"
 #include "Scene.h"
+#include "Tracer.h"
 #include "imgui_internal.h"
 #include "glm/vec2.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include <cstdio>
 #include <functional>
 #include <iostream>
 #include <chrono>
@@ -46,8 +48,12 @@ namespace yune {
         do_postproc = gi_check = misc_settings_shown = scene_info_shown = benchmark_shown = true;
         update_mat_buffer = update_vertex_buffer = update_bvh_buffer  = is_fullscreen = renderer_start = false;
         cap_fps = update_image_buffer = true;
+        multi_device = false;
+        cl_available = true;
         bvh_bins = 20;
         input_fn[0] = '\0';
+        checkpoint_input[0] = '\0';
+        std::snprintf(publish_input, sizeof(publish_input), "%s", renderer.publish_name.c_str());
         benchmark_wheight = 0;
 
         selected_size = 3;
@@ -63,6 +69,7 @@ namespace yune {
         supported_exts.push_back(".png");
         supported_exts.push_back(".jpg");
         supported_exts.push_back(".hdr");
+        supported_exts.push_back(".exr");
     }
 
     RendererGUI::~RendererGUI()
@@ -79,6 +86,7 @@ namespace yune {
 
     void RendererGUI::renderFrame()
     {
+        YUNE_TRACE_SCOPE("gui", "ImGui Render");
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
@@ -105,10 +113,23 @@ namespace yune {
                                                     std::placeholders::_2,
                                                     std::placeholders::_3)
                                          );
-        cl_manager.setup();
+        try
+        {
+            cl_manager.setup();
+        }
+        catch(const std::exception& err)
+        {
+            //Without a usable OpenCL device we can still render on the CPU.
+            cl_available = false;
+            renderer.cpu_backend = true;
+            RendererGUI::mb_title = "OpenCL unavailable!";
+            RendererGUI::mb_msg = std::string(err.what()) + "\nFalling back to the CPU backend. Load an OBJ file and press Start to render it.";
+            return true;
+        }
+
         bool kernel_loaded = false;
         kernel_loaded = cl_manager.createRenderProgram("udpt-primitives.cl", "./kernels/legacy/udpt-primitives.cl", false);
-        kernel_loaded &= cl_manager.createPostProcProgram("tonemap.cl", "./kernels/post-proc/tonemap.cl", false);
+        kernel_loaded &= cl_manager.createPostProcProgram("tonemap.cl", CLManager::TONEMAP_PATH, false);
         if(kernel_loaded)
         {
             RendererGUI::mb_title = "Success!";
@@ -126,7 +147,7 @@ namespace yune {
     {
         bool show_message = false;
         unsigned long time_passed = 0;
-        double start_time = 0, skip_ticks = 16.66666;
+        double start_time = 0, skip_ticks = 16.66666, save_poll_ms = 2.0;
 
         show_message = setup();
         glfw_manager.showWindow();
@@ -135,8 +156,8 @@ namespace yune {
         std::cout << "\nStarting Renderer..." << std::endl;
         while(!glfwWindowShouldClose(glfw_manager.window))
         {
-            /* We need to call enqueueKernels method of RendererCore as it enqueues kernels in blocks of a single image. If gpu has already finished processing
-             * one whole frame, it can be rendered through render() call. If last frame is not rendered, we don't enqueue kernels for the next frame.
+            /* We need to call enqueueKernels method of RendererCore as it hands new frames to the submission thread, which enqueues them in blocks, and
+             * post-processes the frames that thread finished. Those can be rendered through render() call. If last frame is not rendered, we don't start the next one.
              */
             if(renderer_start)
             {
@@ -147,9 +168,24 @@ namespace yune {
                 }
             }
 
-            //Lock GUI frame rate to 16.66 ms. This ensures that we don't render GUI at very high fps (1k+, only possible if kernel has very low execution time).
-            if( (glfwGetTime() - start_time) * 1000 < skip_ticks)
-                continue;
+            /* Lock GUI frame rate to 16.66 ms. This ensures that we don't render GUI at very high fps (1k+, only possible if kernel has very low execution time).
+             * Instead of spinning until the next GUI frame, sleep until then. Input or a completed OpenCL command (which posts an empty event) wakes us up early.
+             */
+            double remaining_ms = skip_ticks - (glfwGetTime() - start_time) * 1000;
+            if(remaining_ms > 0)
+            {
+                if(!renderer_start || !renderer.canMakeProgress())
+                {
+                    //Readbacks of saves are polled every few ms instead, without spinning.
+                    double timeout_ms = remaining_ms;
+                    if(renderer_start && renderer.hasPendingSaves())
+                        timeout_ms = std::min(timeout_ms, save_poll_ms);
+                    YUNE_TRACE_SCOPE("gui", "Wait Events");
+                    glfwWaitEventsTimeout(timeout_ms / 1000.0);
+                }
+                if( (glfwGetTime() - start_time) * 1000 < skip_ticks)
+                    continue;
+            }
 
             //Start Drawing a new frame
             start_time = glfwGetTime();
@@ -179,14 +215,17 @@ namespace yune {
             }
             showMessageBox(mb_title, mb_msg, mb_log);
             renderFrame();
-            glfwSwapBuffers(glfw_manager.window);
+            {
+                YUNE_TRACE_SCOPE("gl", "Swap Buffers");
+                glfwSwapBuffers(glfw_manager.window);
+            }
             glfwPollEvents();
         }
     }
 
     bool RendererGUI::showMenu()
     {
-        bool open_obj = false, save_fildialog = false, open_rk = false, open_ppk = false, open_about = false, open_usage = false, show_message = false;
+        bool open_obj = false, save_fildialog = false, open_checkpoint = false, open_rk = false, open_ppk = false, open_about = false, open_usage = false, show_message = false;
         if(ImGui::BeginMainMenuBar())
         {
             if (ImGui::BeginMenu("File"))
@@ -194,10 +233,10 @@ namespace yune {
                 if (ImGui::MenuItem("Load OBJ", NULL, false, !renderer_start))
                     open_obj = true;
 
-                if (ImGui::MenuItem("Load Render Kernel", NULL, false, !renderer_start))
+                if (ImGui::MenuItem("Load Render Kernel", NULL, false, !renderer_start && cl_available))
                     open_rk = true;
 
-                if (ImGui::MenuItem("Load Post-Proc Kernel", NULL, false, !renderer_start))
+                if (ImGui::MenuItem("Load Post-Proc Kernel", NULL, false, !renderer_start && cl_available))
                     open_ppk = true;
 
                 if(ImGui::MenuItem("Reload Render Kernel", NULL, false, !cl_manager.rk_file.empty() && !renderer_start))
@@ -222,10 +261,24 @@ namespace yune {
                 if(ImGui::MenuItem("Save Image", NULL, false, renderer_start))
                     save_fildialog = true;
 
+                if(ImGui::MenuItem("Resume Checkpoint", NULL, false, renderer_start && !renderer.cpu_backend))
+                    open_checkpoint = true;
+
+                bool tracing = Tracer::isEnabled();
+                if(ImGui::MenuItem("Record Trace", NULL, &tracing))
+                    Tracer::setEnabled(tracing);
+
+                if(ImGui::MenuItem("Save Trace", NULL, false, tracing))
+                {
+                    show_message = true;
+                    renderer.saveTrace("yune_trace.json");
+                }
+
                 ImGui::Separator();
-                if(ImGui::MenuItem("Start", NULL, &renderer_start, !cl_manager.rk_file.empty()))
+                if(ImGui::MenuItem("Start", NULL, &renderer_start, !cl_manager.rk_file.empty() || renderer.cpu_backend))
                 {
-                    if(renderer_start && !renderer.setup(update_image_buffer, update_vertex_buffer, update_mat_buffer, update_bvh_buffer, !cl_manager.ppk_file.empty() && do_postproc))
+                    bool postproc = (renderer.cpu_backend || !cl_manager.ppk_file.empty()) && do_postproc;
+                    if(renderer_start && !renderer.setup(update_image_buffer, update_vertex_buffer, update_mat_buffer, update_bvh_buffer, postproc))
                     {
                         renderer_start = false;
                         show_message = true;
@@ -303,6 +356,9 @@ namespace yune {
         if(save_fildialog)
             ImGui::OpenPopup("Save Image");
 
+        if(open_checkpoint)
+            ImGui::OpenPopup("Open Checkpoint");
+
         if(file_dialog.showFileDialog("Open OBJ File", imgui_addons::ImGuiFileBrowser::DialogMode::OPEN, ImVec2(700, 310), ".obj,.rtt"))
         {
             show_message = true;
@@ -325,12 +381,11 @@ namespace yune {
             cl_manager.createPostProcProgram(file_dialog.selected_fn, file_dialog.selected_path, false);
         }
 
-        if(file_dialog.showFileDialog("Save Image", imgui_addons::ImGuiFileBrowser::DialogMode::SAVE, ImVec2(700, 310), ".png,.jpg,.hdr"))
-        {
-            renderer.save_pending = true;
-            renderer.save_fn = file_dialog.selected_path;
-            renderer.save_ext = file_dialog.ext;
-        }
+        if(file_dialog.showFileDialog("Save Image", imgui_addons::ImGuiFileBrowser::DialogMode::SAVE, ImVec2(700, 310), ".png,.jpg,.hdr,.exr"))
+            renderer.requestSave(file_dialog.selected_path, file_dialog.ext);
+
+        if(file_dialog.showFileDialog("Open Checkpoint", imgui_addons::ImGuiFileBrowser::DialogMode::OPEN, ImVec2(700, 310), ".yck"))
+            renderer.resume_fn = file_dialog.selected_path;
 
         if(open_about)
             ImGui::OpenPopup("About");
@@ -403,6 +458,61 @@ namespace yune {
             ImGui::SetCursorPosX(140);
             ImGui::Text(": %.2f ms", renderer.ms_per_ppk);
 
+            if(cl_manager.getFeatureArg("feature-buffers") >= 0 && !renderer.cpu_backend)
+            {
+                ImGui::Text("ms/denoise");
+                ImGui::SameLine();
+                showHelpMarker("Time per frame taken by all passes of the denoiser, which runs right before the post-processing kernel.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.2f ms", renderer.ms_per_denoise);
+            }
+
+            if(cl_manager.getPostProcFeatureArg("auto-exposure") >= 0 && !renderer.cpu_backend)
+            {
+                ImGui::Text("ms/exposure");
+                ImGui::SameLine();
+                showHelpMarker("Time per frame taken by the luminance reduction. It runs every frame or two, once the previous result has been read.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.2f ms", renderer.ms_per_exposure);
+
+                ImGui::Text("Exposure");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.3f", renderer.exposure);
+            }
+
+            if(!renderer.cpu_backend)
+            {
+                ImGui::Text("Est. MB/frame");
+                ImGui::SameLine();
+                showHelpMarker("Estimate, not a measurement. Image data the device would read and write per frame, computed from the formats of the images "
+                               "and the passes in use. Counts every pass as touching each pixel once, so it's a lower bound. Use a vendor profiler for "
+                               "the actual memory traffic.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": ~%.1f MB (~%.1f GB/s)", renderer.mb_per_frame, renderer.mb_per_frame * renderer.fps / 1000.0f);
+            }
+
+            if(!cl_manager.helper_device_names.empty() && renderer.device_share.size() == cl_manager.helper_device_names.size() + 1)
+            {
+                ImGui::Text("Primary Device");
+                ImGui::SameLine();
+                showHelpMarker("Share of blocks rendered by each device in the last frame. Blocks are assigned according to the measured speed of each device.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.0f %%", renderer.device_share[0] * 100);
+
+                for(size_t i = 0; i < cl_manager.helper_device_names.size(); i++)
+                {
+                    ImGui::Text("%.16s", cl_manager.helper_device_names[i].c_str());
+                    ImGui::SameLine();
+                    ImGui::SetCursorPosX(140);
+                    ImGui::Text(": %.0f %%", renderer.device_share[i+1] * 100);
+                }
+            }
+
             ImGui::Text("Render Time");
             ImGui::SameLine();
             ImGui::SetCursorPosX(140);
@@ -413,6 +523,100 @@ namespace yune {
             ImGui::SetCursorPosX(140);
             ImGui::Text(": %lu spp", renderer.samples_taken);
 
+            if(cl_manager.getFeatureArg("wavefront") >= 0)
+            {
+                const char* stage_names[] = {"Generate", "Extend", "Shade Diffuse", "Shade Specular", "Connect", "Accumulate"};
+                ImGui::Text("Wavefront Stages");
+                ImGui::SameLine();
+                showHelpMarker("Average time per block spent in each stage of the wavefront kernels, summed over all bounces.");
+                for(int i = 0; i <= CLManager::WF_KERNEL_COUNT; i++)
+                {
+                    ImGui::Text("  %s", stage_names[i]);
+                    ImGui::SameLine();
+                    ImGui::SetCursorPosX(140);
+                    ImGui::Text(": %.2f ms", renderer.ms_per_stage[i]);
+                }
+            }
+
+            if(cl_manager.getFeatureArg("spp-per-launch") >= 0 || renderer.cpu_backend)
+            {
+                ImGui::Text("Samples/Launch");
+                ImGui::SameLine();
+                showHelpMarker("Samples per pixel accumulated in registers by one kernel launch before the image is written. ms/rk grows accordingly.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %d spp", std::max(renderer.spp_per_launch, 1));
+            }
+
+            if(renderer.convergence_error >= 0)
+            {
+                ImGui::Text("Rel. MSE");
+                ImGui::SameLine();
+                showHelpMarker("Estimated relative mean squared error of the accumulated image. Only measured while a target is set or reports are written.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.5f", renderer.convergence_error);
+            }
+
+            if(renderer.stop_reason != RendererCore::STOP_NONE)
+            {
+                ImGui::Text("Status");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %s", renderer.stop_reason == RendererCore::STOP_CONVERGED ? "Converged" : "Time budget spent");
+            }
+
+            if(renderer.preview_enabled && !renderer.cpu_backend)
+            {
+                ImGui::Text("Preview Scale");
+                ImGui::SameLine();
+                showHelpMarker("Fraction of the width and height the last frame rendered while moving the camera was rendered at.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": 1/%d", renderer.preview_scale);
+            }
+
+            if(cl_manager.getFeatureArg("adaptive-sampling") >= 0 && !renderer.cpu_backend)
+            {
+                ImGui::Text("Active Pixels");
+                ImGui::SameLine();
+                showHelpMarker("Pixels that haven't converged yet and are still being rendered every frame.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.1f %%", renderer.active_pixel_share * 100);
+            }
+
+            if(cl_manager.getFeatureArg("ray-counters") >= 0 && renderer.ray_stats.valid)
+            {
+                const RayStats& stats = renderer.ray_stats;
+                ImGui::Text("Mrays/s");
+                ImGui::SameLine();
+                showHelpMarker("Rays traced per second of rendering kernel time, shadow rays included. Counted by the kernel in one frame out of every few.");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.1f", stats.mrays_per_sec);
+
+                ImGui::Text("Nodes/ray");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.1f", stats.nodes_per_ray);
+
+                ImGui::Text("Tri tests/ray");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.1f", stats.triangle_tests_per_ray);
+
+                ImGui::Text("Shadow rays");
+                ImGui::SameLine();
+                ImGui::SetCursorPosX(140);
+                ImGui::Text(": %.0f %%", stats.shadow_ray_share * 100);
+
+                float hist[CLManager::PATH_LENGTH_BINS];
+                for(int i = 0; i < CLManager::PATH_LENGTH_BINS; i++)
+                    hist[i] = stats.path_length[i];
+                ImGui::PlotHistogram("##PathLength", hist, CLManager::PATH_LENGTH_BINS, 0, "Path Length", 0.0f, FLT_MAX, ImVec2(250, 50));
+            }
+
             benchmark_wheight = 35 + ImGui::GetWindowHeight();
         }
         ImGui::End();
@@ -541,6 +745,157 @@ namespace yune {
                 ImGui::Checkbox("Save Image as Screencap", &renderer.save_editor);
                 ImGui::SameLine();
                 showHelpMarker("Checking this causes \"Save At Samples\" to work as screen capture and saves Editor to the image as well.");
+                ImGui::Checkbox("Write Report", &renderer.write_report);
+                ImGui::SameLine();
+                showHelpMarker("Write the benchmark figures and ray statistics to a .txt file with the same name as every saved image.");
+                ImGui::Checkbox("EXR Half Floats", &renderer.exr_half);
+                ImGui::SameLine();
+                showHelpMarker(".exr images hold the raw accumulated radiance, the sample count and, if the kernel writes feature buffers, the albedo, "
+                               "normal and depth of the first hit. Half floats take half the space at reduced precision. "
+                               "The sample count and depth are always stored as full floats.");
+                ImGui::PushItemWidth(120);
+                ImGui::DragInt("EXR Threads", &renderer.exr_threads, 0.1f, 0, 64, renderer.exr_threads == 0 ? "All" : "%d");
+                ImGui::PopItemWidth();
+
+                if(!renderer.cpu_backend)
+                {
+                    ImGui::PushItemWidth(120);
+                    if(ImGui::InputText("Checkpoint File", checkpoint_input, 256, ImGuiInputTextFlags_AutoSelectAll))
+                        renderer.checkpoint_fn = std::string(checkpoint_input);
+                    ImGui::SameLine();
+                    showHelpMarker("Periodically write the raw accumulated image, the camera and the random state to this file, usually ending in .yck. "
+                                   "File > Resume Checkpoint continues from it after a crash. Empty disables checkpoints.");
+                    ImGui::DragScalar("Checkpoint Every", ImGuiDataType_U32, &renderer.checkpoint_samples, 0.5, &min_samples);
+                    ImGui::SameLine();
+                    showHelpMarker("Samples between two checkpoints. 0 disables the sample interval.");
+                    ImGui::DragFloat("Checkpoint Minutes", &renderer.checkpoint_minutes, 0.1f, 0.0f, 1440.0f, "%.1f min");
+                    ImGui::SameLine();
+                    showHelpMarker("Minutes between two checkpoints. 0 disables the time interval.");
+                    ImGui::PopItemWidth();
+
+                    ImGui::Checkbox("Publish Frames", &renderer.publish_frames);
+                    ImGui::SameLine();
+                    showHelpMarker("Copy the raw accumulation, with the sample count in alpha, into a ring of frames in shared memory so a local viewer "
+                                   "can read them in place without touching the disk. tools/frame_consumer.cpp is a reference reader.");
+                    ImGui::PushItemWidth(120);
+                    if(ImGui::InputText("Shared Memory Name", publish_input, 256, ImGuiInputTextFlags_AutoSelectAll))
+                        renderer.publish_name = std::string(publish_input);
+                    ImGui::DragInt("Publish Every", &renderer.publish_interval, 0.1f, 1, 1000, "%d frames");
+                    ImGui::PopItemWidth();
+                }
+
+                ImGui::PushItemWidth(120);
+                ImGui::DragFloat("Target Rel. MSE", &renderer.target_error, 0.00001f, 0.0f, 1.0f, "%.5f");
+                ImGui::SameLine();
+                showHelpMarker("Save the image to \"Save Filename\" and stop once the estimated relative MSE of the image drops below this. 0 disables it. "
+                               "Rendering resumes when the camera moves or GI is toggled.");
+                ImGui::DragFloat("Time Budget", &renderer.time_budget, 1.0f, 0.0f, 86400.0f, "%.0f sec");
+                ImGui::SameLine();
+                showHelpMarker("Save the image and stop after this many seconds even if the target hasn't been reached. 0 disables it.");
+                ImGui::DragInt("Check Interval", &renderer.convergence_interval, 0.2f, 1, 1000, "%d frames");
+                ImGui::SameLine();
+                showHelpMarker("Frames between two estimates of the relative MSE. Each estimate compares the image against a copy taken at fewer samples.");
+                ImGui::PopItemWidth();
+
+                if(cl_manager.getFeatureArg("cost-heatmap") >= 0 && !renderer.cpu_backend)
+                {
+                    const char* cost_names[] = {"BVH Nodes", "Triangle Tests", "Rays"};
+                    ImGui::Checkbox("Cost Heatmap", &renderer.show_heatmap);
+                    ImGui::SameLine();
+                    showHelpMarker("Display how much work every pixel costs per sample instead of the rendered image. Blue is cheap, red reaches Max Cost. "
+                                   "Replaces post-processing while enabled, accumulation carries on underneath.");
+                    ImGui::PushItemWidth(120);
+                    ImGui::Combo("Cost", &renderer.heatmap_channel, cost_names, IM_ARRAYSIZE(cost_names));
+                    ImGui::DragFloat("Max Cost", &renderer.heatmap_max, 1.0f, 1.0f, 100000.0f, "%.0f");
+                    ImGui::PopItemWidth();
+                }
+
+                if(!renderer.cpu_backend)
+                {
+                    ImGui::Checkbox("Low-Res Preview", &renderer.preview_enabled);
+                    ImGui::SameLine();
+                    showHelpMarker("Render at a fraction of the resolution while the camera moves and upscale it, so navigating stays responsive. "
+                                   "Rendering starts over at full resolution once the camera has been still for the settle time. Not used with wavefront or persistent kernels or multiple devices.");
+                    if(renderer.preview_enabled)
+                    {
+                        ImGui::PushItemWidth(120);
+                        ImGui::DragFloat("Preview Target", &renderer.preview_target_ms, 0.1f, 1.0f, 200.0f, "%.1f ms");
+                        ImGui::SameLine();
+                        showHelpMarker("Rendering kernel time per frame the preview resolution is adjusted towards.");
+                        ImGui::DragInt("Max Scale", &renderer.preview_max_scale, 0.05f, 2, 16, "1/%d");
+                        ImGui::DragFloat("Settle Time", &renderer.preview_settle_ms, 1.0f, 0.0f, 1000.0f, "%.0f ms");
+                        ImGui::SameLine();
+                        showHelpMarker("Time without camera input the preview continues for, so it doesn't flicker between resolutions while navigating.");
+                        ImGui::PopItemWidth();
+                    }
+                }
+
+                if(cl_manager.getFeatureArg("temporal-reprojection") >= 0 && !renderer.cpu_backend)
+                {
+                    ImGui::Checkbox("Temporal Reprojection", &renderer.temporal_reprojection);
+                    ImGui::SameLine();
+                    showHelpMarker("Keep the accumulated image while the camera moves by reprojecting it into the new view. Pixels that were hidden "
+                                   "before start over. Toggling GI still discards everything.");
+                    ImGui::PushItemWidth(120);
+                    ImGui::DragInt("Max History", &renderer.temporal_max_history, 0.2f, 1, 256, "%d spp");
+                    ImGui::SameLine();
+                    showHelpMarker("Samples the reprojected image is worth at most after a move. Higher values are less noisy while navigating but leave longer trails.");
+                    ImGui::PopItemWidth();
+                }
+
+                if(cl_manager.getFeatureArg("feature-buffers") >= 0 && !renderer.cpu_backend)
+                {
+                    ImGui::Checkbox("Denoise", &renderer.denoise);
+                    ImGui::SameLine();
+                    showHelpMarker("Filter the image with an edge-avoiding a-trous wavelet guided by the first-hit albedo, normal and depth written by the kernel. "
+                                   "Runs before the post-processing kernel, so post-processing must be enabled. Accumulation isn't affected.");
+                    ImGui::PushItemWidth(120);
+                    ImGui::DragInt("Passes", &renderer.denoise_passes, 0.05f, 1, 8);
+                    ImGui::DragFloat("Sigma Color", &renderer.denoise_sigma_color, 0.01f, 0.01f, 10.0f, "%.2f");
+                    ImGui::DragFloat("Sigma Normal", &renderer.denoise_sigma_normal, 1.0f, 1.0f, 256.0f, "%.0f");
+                    ImGui::DragFloat("Sigma Depth", &renderer.denoise_sigma_depth, 0.005f, 0.001f, 1.0f, "%.3f");
+                    ImGui::PopItemWidth();
+                }
+
+                if(cl_manager.getPostProcFeatureArg("auto-exposure") >= 0 && !renderer.cpu_backend)
+                {
+                    ImGui::Checkbox("Auto Exposure", &renderer.auto_exposure);
+                    ImGui::SameLine();
+                    showHelpMarker("Scale the image so it's log-average luminance maps to the key before tonemapping. The luminance is reduced on the device "
+                                   "and read back asynchronously, so the exposure trails the image by a frame.");
+                    ImGui::PushItemWidth(120);
+                    ImGui::DragFloat("Key", &renderer.exposure_key, 0.005f, 0.01f, 1.0f, "%.3f");
+                    ImGui::DragFloat("Adaptation Time", &renderer.exposure_adapt_time, 0.01f, 0.0f, 10.0f, "%.2f s");
+                    ImGui::PopItemWidth();
+                    ImGui::Checkbox("Histogram White Point", &renderer.exposure_histogram);
+                    ImGui::SameLine();
+                    showHelpMarker("Map the luminance below which the given share of pixels lie to white, instead of the brightest pixel. Keeps fireflies from dimming the image.");
+                    ImGui::PushItemWidth(120);
+                    ImGui::DragFloat("Percentile", &renderer.exposure_white_percentile, 0.001f, 0.5f, 1.0f, "%.3f");
+                    ImGui::PopItemWidth();
+                }
+
+                if(cl_manager.getFeatureArg("fused-tonemap") >= 0 && !renderer.cpu_backend)
+                {
+                    ImGui::Checkbox("Fused Tonemap", &renderer.fused_tonemap);
+                    ImGui::SameLine();
+                    showHelpMarker("The rendering kernel writes the tonemapped, gamma corrected frame to an 8-bit display image itself and the post-processing kernel is "
+                                   "skipped, saving several full float image passes per frame. Needs post-processing enabled with the built-in tonemap.cl and "
+                                   "auto-exposure off. Preview frames, the heatmap view, denoising and adaptive sampling still use the post-processing kernel.");
+                }
+
+                if(cl_manager.getFeatureArg("adaptive-sampling") >= 0 && !renderer.cpu_backend)
+                {
+                    ImGui::PushItemWidth(120);
+                    ImGui::DragFloat("Error Threshold", &renderer.adaptive_threshold, 0.001f, 0.001f, 1.0f, "%.3f");
+                    ImGui::SameLine();
+                    showHelpMarker("A pixel stops being rendered once the standard error of it's mean luminance falls below this fraction of the mean. "
+                                   "Lower values take longer to converge but leave less noise.");
+                    ImGui::DragInt("Min Samples", &renderer.adaptive_min_spp, 0.5f, 2, 4096);
+                    ImGui::SameLine();
+                    showHelpMarker("Samples every pixel takes before it's error estimate is trusted.");
+                    ImGui::PopItemWidth();
+                }
             }
 
             //BVH Settings
@@ -580,11 +935,23 @@ namespace yune {
                 }
                 ImGui::PushItemWidth(125);
 
+                //Adaptive tiles pick the block grid themselves every frame.
+                bool blocks_locked = renderer.adaptive_tiles && !renderer_start;
+                if(blocks_locked)
+                {
+                    ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+                    ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+                }
                 if(ImGui::DragInt("##Render Kernel BlocksX", &renderer.blocks.x, 0.2, 1, 100, "Blocks in X: %d"))
                     renderer.updateKernelWGSize();
                 ImGui::SameLine();
                 if(ImGui::DragInt("##Render Kernel BlocksY", &renderer.blocks.y, 0.2, 1, 100, "Blocks in Y: %d"))
                     renderer.updateKernelWGSize();
+                if(blocks_locked)
+                {
+                    ImGui::PopItemFlag();
+                    ImGui::PopStyleVar();
+                }
                 ImGui::SameLine();
                 showHelpMarker("You can divide the Image in blocks to allow the same rendering kernel to launch multiple times for a single frame. "
                                "This decreases overall fps but also decreases execution time for 1 kernel instance which can be useful to avoid laggy GUI. Default 2x2=4");
@@ -617,6 +984,77 @@ namespace yune {
                 ImGui::SameLine();
                 showHelpMarker("Local Workgroup Size for the Post-Processing Kernel in X and Y. Set to 0 to let OpenCL find a size automatically.");
 
+                if(cl_manager.getFeatureArg("spp-per-launch") >= 0 || renderer.cpu_backend)
+                {
+                    ImGui::DragInt("##SppPerLaunch", &renderer.spp_per_launch, 0.2, 1, 1024, "Samples/Launch: %d");
+                    ImGui::SameLine();
+                    showHelpMarker("Number of samples per pixel a single kernel launch takes before writing the accumulated image once. "
+                                   "Higher values cut launch overhead and image bandwidth for offline renders but make each launch longer.");
+                }
+
+                if(cl_manager.getFeatureArg("wavefront") >= 0)
+                {
+                    ImGui::DragInt("##MaxBounces", &renderer.max_bounces, 0.2, 1, 64, "Max Bounces: %d");
+                    ImGui::SameLine();
+                    showHelpMarker("Maximum path length for wavefront kernels. Every bounce launches the extend, shade and connect stages once per block.");
+                }
+
+                if(cl_manager.getFeatureArg("ray-counters") >= 0)
+                {
+                    ImGui::DragInt("##CounterInterval", &renderer.counter_interval, 0.1, 1, 600, "Counter Interval: %d");
+                    ImGui::SameLine();
+                    showHelpMarker("Frames between two samples of the ray counters. Counters are cleared before a sampled frame and read back "
+                                   "asynchronously after it, so the other frames don't wait on them.");
+                }
+
+                if(cl_manager.getFeatureArg("persistent-threads") >= 0)
+                {
+                    ImGui::DragInt("##GroupsPerCU", &renderer.persistent_groups_per_cu, 0.1, 1, 32, "Groups/CU: %d");
+                    ImGui::SameLine();
+                    showHelpMarker("Work-groups launched per compute unit by persistent-threads kernels. They keep taking pixels of the tile from "
+                                   "a global counter until it's done, so a few groups per unit are enough to hide latency. Applied on Start.");
+                }
+
+                ImGui::Checkbox("Adaptive Tiles", &renderer.adaptive_tiles);
+                ImGui::SameLine();
+                showHelpMarker("Resize the block grid every frame so that a single kernel launch takes roughly the target time. Keeps the GUI responsive "
+                               "and launches under the driver's watchdog limit without starving the device with tiny launches. Replaces the Blocks in X and Y set above.");
+
+                ImGui::DragFloat("##TargetMsPerTile", &renderer.target_ms_per_tile, 0.1, 1, 100, "Target ms/tile: %.1f");
+                ImGui::SameLine();
+                ImGui::DragInt("##TilesInFlight", &renderer.tiles_in_flight, 0.1, 1, 8, "Tiles in flight: %d");
+                ImGui::SameLine();
+                showHelpMarker("Number of blocks queued on the device at once. More than 1 hides the gap between a block completing and the next one being launched.");
+
+                ImGui::Checkbox("Half Precision Targets", &renderer.half_targets);
+                ImGui::SameLine();
+                showHelpMarker("Store the images of the denoising passes and of preview frames as half floats, halving their memory traffic. The "
+                               "accumulation stays float so sample counts and high sample averages stay exact, and the display images are 8-bit "
+                               "already. Applied on Start.");
+
+                if(ImGui::Checkbox("Multi-Device Rendering", &multi_device))
+                {
+                    if(!cl_manager.setupMultiDevice(multi_device))
+                        multi_device = false;
+                    update_image_buffer = update_vertex_buffer = update_mat_buffer = true;
+                    update_bvh_buffer = !renderer.render_scene.bvh.gpu_node_list.empty();
+                }
+                ImGui::SameLine();
+                showHelpMarker("Split each frame between all OpenCL devices available on the system. Blocks are distributed according to the speed of each device. "
+                               "The device sharing the OpenGL context composites the final image. Needs more than 1 block.");
+
+                if(ImGui::Checkbox("CPU Backend", &renderer.cpu_backend))
+                {
+                    renderer.cpu_backend |= !cl_available;
+                    update_image_buffer = update_vertex_buffer = update_mat_buffer = true;
+                    update_bvh_buffer = !renderer.render_scene.bvh.gpu_node_list.empty();
+                }
+                ImGui::SameLine();
+                ImGui::DragInt("##CPUThreads", &renderer.cpu_threads, 0.1, 0, 256, "CPU Threads: %d");
+                ImGui::SameLine();
+                showHelpMarker("Path trace the loaded OBJ scene on the CPU instead of the loaded kernels. It's a port of udpt.cl using the same BVH and random numbers, "
+                               "useful as a reference image or when no OpenCL device is available. Set threads to 0 to use every hardware thread.");
+
                 ImGui::SetCursorPosX(ImGui::GetWindowWidth()/2.0 - ImGui::CalcTextSize("Reset Kernel Settings").x/2.0);
                 if(ImGui::Button("Reset Kernel Settings"))
                     renderer.updateKernelWGSize(true);
@@ -24,6 +24,7 @@
  ******************************************************************************/
 
 #include "Scene.h"
+#include "Tracer.h"
 #include "glm/vec3.hpp"
 
 #include <exception>
@@ -132,6 +133,7 @@ namespace yune
 
     void Scene::loadModel(std::string filepath, std::string filename)
     {
+        YUNE_TRACE_SCOPE("scene", "Load Model");
         clearValues();
         std::string mat_fn = getMatFileName(filepath);
         std::string mat_fp = filepath;
@@ -0,0 +1,175 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace yune
+{
+    TileScheduler::TileScheduler()
+    {
+        tile_order_grid = glm::ivec2(0,0);
+    }
+
+    void TileScheduler::setup(size_t devices)
+    {
+        ms_per_block.assign(devices, 0.0f);
+        share.clear();
+    }
+
+    void TileScheduler::reset()
+    {
+        ms_per_block.clear();
+        share.clear();
+    }
+
+    void TileScheduler::schedule(glm::ivec2 grid, std::vector<int>& primary, std::vector<std::vector<int>>& helpers)
+    {
+        int total_blocks = grid.x * grid.y;
+        size_t num_helpers = helpers.size();
+        primary.clear();
+
+        /* Issue tiles in a spiral starting from the center of the screen. Neighbouring tiles hit mostly the same part of the BVH so
+         * consecutive launches stay cache-friendly, and the region the user is most likely looking at converges first. The order only
+         * changes when the grid does.
+         */
+        if(tile_order_grid != grid || (int) tile_order.size() != total_blocks)
+        {
+            tile_order.resize(total_blocks);
+            for(int i = 0; i < total_blocks; i++)
+                tile_order[i] = i;
+
+            float cx = (grid.x - 1) / 2.0f;
+            float cy = (grid.y - 1) / 2.0f;
+            int bx = grid.x;
+            std::stable_sort(tile_order.begin(), tile_order.end(), [cx, cy, bx](int a, int b)
+            {
+                float ax = a % bx - cx, ay = a / bx - cy;
+                float bx_ = b % bx - cx, by_ = b / bx - cy;
+                float ring_a = std::max(std::abs(ax), std::abs(ay));
+                float ring_b = std::max(std::abs(bx_), std::abs(by_));
+                if(ring_a != ring_b)
+                    return ring_a < ring_b;
+                return std::atan2(ay, ax) < std::atan2(by_, bx_);
+            });
+            tile_order_grid = grid;
+        }
+
+        /* Split the blocks proportional to the measured throughput (blocks per ms) of every device. Devices with no measurement
+         * yet are assumed to be as fast as the primary device. The primary device always keeps atleast one block.
+         */
+        std::vector<int> counts(num_helpers + 1, 0);
+        if(num_helpers > 0 && total_blocks > 1)
+        {
+            std::vector<float> rates(num_helpers + 1);
+            float sum_rates = 0;
+            for(size_t i = 0; i < rates.size(); i++)
+            {
+                float ms = ms_per_block[i] > 0 ? ms_per_block[i] : ms_per_block[0];
+                rates[i] = ms > 0 ? 1.0f/ms : 1.0f;
+                sum_rates += rates[i];
+            }
+
+            int assigned = 0;
+            for(size_t i = 1; i < rates.size(); i++)
+            {
+                counts[i] = std::min((int) (total_blocks * rates[i]/sum_rates), total_blocks - 1 - assigned);
+                assigned += counts[i];
+            }
+            counts[0] = total_blocks - assigned;
+        }
+        else
+            counts[0] = total_blocks;
+
+        int block = 0;
+        for(; block < counts[0]; block++)
+            primary.push_back(tile_order[block]);
+
+        share.assign(num_helpers + 1, 0.0f);
+        share[0] = (float) counts[0] / total_blocks;
+        for(size_t i = 0; i < num_helpers; i++)
+        {
+            helpers[i].clear();
+            for(int j = 0; j < counts[i+1]; j++, block++)
+                helpers[i].push_back(tile_order[block]);
+            share[i+1] = (float) counts[i+1] / total_blocks;
+        }
+    }
+
+    glm::ivec2 TileScheduler::adaptGrid(glm::ivec2 grid, float ms_per_tile, float target_ms, int width, int height)
+    {
+        /* Scale the number of tiles so that one launch takes roughly target_ms. Short launches waste time in launch overhead and
+         * polling while long ones make the GUI laggy and can trip the driver watchdog (TDR) on displays attached to the same GPU.
+         * Only react when the average is well off the target so the grid doesn't oscillate between frames.
+         */
+        float ratio = ms_per_tile / std::max(target_ms, 0.1f);
+        if(ratio > 0.75f && ratio < 1.33f)
+            return grid;
+
+        float old_tiles = grid.x * grid.y;
+        float new_tiles = std::max(old_tiles * ratio, 1.0f);
+
+        // Keep tiles roughly square so neighbouring pixels in a tile stay coherent.
+        glm::ivec2 new_grid;
+        new_grid.x = std::round(std::sqrt(new_tiles * width / height));
+        new_grid.x = std::min(std::max(new_grid.x, 1), 100);
+        new_grid.y = std::ceil(new_tiles / new_grid.x);
+        new_grid.y = std::min(std::max(new_grid.y, 1), 100);
+        if(new_grid == grid)
+            return grid;
+
+        for(float& ms : ms_per_block)
+            ms *= old_tiles / (new_grid.x * new_grid.y);
+        return new_grid;
+    }
+
+    void TileScheduler::measure(size_t device, float ms_per_tile)
+    {
+        if(device >= ms_per_block.size() || ms_per_tile <= 0)
+            return;
+        float& avg = ms_per_block[device];
+        avg = avg > 0 ? 0.8f * avg + 0.2f * ms_per_tile : ms_per_tile;
+    }
+
+    const std::vector<float>& TileScheduler::getShare() const
+    {
+        return share;
+    }
+
+    void TileScheduler::getBlockRegion(glm::ivec2 grid, int width, int height, int block, size_t origin[3], size_t region[3])
+    {
+        int block_w = std::ceil((float)width/grid.x);
+        int block_h = std::ceil((float)height/grid.y);
+
+        origin[0] = block_w * (block % grid.x);
+        origin[1] = block_h * (block / grid.x);
+        origin[2] = 0;
+        region[0] = std::max(std::min(block_w, width - (int) origin[0]), 0);
+        region[1] = std::max(std::min(block_h, height - (int) origin[1]), 0);
+        region[2] = 1;
+    }
+}
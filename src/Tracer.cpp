@@ -0,0 +1,150 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace yune
+{
+    std::atomic<bool> Tracer::enabled(false);
+    std::mutex Tracer::mutex;
+    std::vector<Tracer::Event> Tracer::events;
+    size_t Tracer::next_event = 0;
+    double Tracer::device_offset = 0;
+    bool Tracer::calibrated = false;
+
+    Tracer::Scope::Scope(const char* cat, const char* name) : cat(cat), name(name)
+    {
+        start = Tracer::isEnabled() ? Tracer::now() : -1.0;
+    }
+
+    Tracer::Scope::~Scope()
+    {
+        if(start >= 0 && Tracer::isEnabled())
+            Tracer::record(cat, name, start, Tracer::now() - start, 1);
+    }
+
+    double Tracer::now()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void Tracer::setEnabled(bool enable, size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(enable && !enabled)
+        {
+            events.assign(std::max(capacity, (size_t) 1), Event());
+            next_event = 0;
+            calibrated = false;
+        }
+        enabled = enable;
+    }
+
+    bool Tracer::isCalibrated()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return calibrated;
+    }
+
+    void Tracer::calibrate(cl_command_queue queue)
+    {
+        cl_event marker;
+        if(clEnqueueMarkerWithWaitList(queue, 0, NULL, &marker) != CL_SUCCESS)
+            return;
+        clFinish(queue);
+        double host = now();
+
+        cl_ulong device_end = 0;
+        cl_int err = clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &device_end, NULL);
+        clReleaseEvent(marker);
+        if(err != CL_SUCCESS)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        device_offset = host - device_end / 1000.0;
+        calibrated = true;
+    }
+
+    void Tracer::deviceEvent(const char* cat, const char* name, cl_event event)
+    {
+        if(!isEnabled() || !isCalibrated())
+            return;
+
+        cl_ulong start = 0, end = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+        record(cat, name, start / 1000.0 + device_offset, (end - start) / 1000.0, 2);
+    }
+
+    void Tracer::record(const char* cat, const char* name, double start, double duration, int pid)
+    {
+        size_t tid = pid == 1 ? std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000 : 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(events.empty())
+            return;
+        Event& e = events[next_event % events.size()];
+        e.cat = cat;
+        e.name = name;
+        e.start = start;
+        e.duration = duration;
+        e.pid = pid;
+        e.tid = tid;
+        next_event++;
+    }
+
+    bool Tracer::dump(const std::string& filename, const std::string& device_name)
+    {
+        std::ofstream file(filename);
+        if(!file)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+             << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Host\"}},\n"
+             << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"";
+        for(char c : device_name)
+            if(c != '"' && c != '\\')
+                file << c;
+        file << "\"}}";
+
+        size_t count = std::min(next_event, events.size());
+        for(size_t i = next_event - count; i < next_event; i++)
+        {
+            const Event& e = events[i % events.size()];
+            file << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.cat << "\",\"ph\":\"X\",\"ts\":" << std::fixed << e.start
+                 << ",\"dur\":" << e.duration << ",\"pid\":" << e.pid << ",\"tid\":" << e.tid << "}";
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+}
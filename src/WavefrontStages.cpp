@@ -0,0 +1,194 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "WavefrontStages.h"
+
+#include <algorithm>
+
+namespace yune
+{
+    WavefrontStages::WavefrontStages(CLManager& cl_manager) : cl_manager(cl_manager)
+    {
+        count_event = NULL;
+    }
+
+    bool WavefrontStages::setup(const Scene& scene, int width, int height, glm::ivec2 blocks, const size_t gws[2], int max_bounces, bool gi_check, cl_uint seed)
+    {
+        // One path per pixel of a tile. The buffers are only recreated when the tile size or the bounce limit changes.
+        max_bounces = std::max(max_bounces, 1);
+        if(!cl_manager.setupWavefrontBuffers(gws[0] * gws[1], max_bounces))
+            return false;
+
+        cl_int err = 0;
+        cl_int img_width = width;
+        cl_int img_height = height;
+        cl_int bx = blocks.x, by = blocks.y;
+        cl_int max_paths = cl_manager.wf_num_paths;
+        cl_int bounces = max_bounces;
+        cl_int check = gi_check;
+        cl_int scene_size = scene.vert_data.size();
+        cl_int bvh_size = scene.bvh.gpu_node_list.size();
+        cl_mem* vert_buffer = cl_manager.vert_buffer ? &cl_manager.vert_buffer : NULL;
+        cl_mem* mat_buffer = cl_manager.mat_buffer ? &cl_manager.mat_buffer : NULL;
+        cl_mem* bvh_buffer = cl_manager.bvh_buffer ? &cl_manager.bvh_buffer : NULL;
+
+        cl_kernel kernel = cl_manager.wf_kernels[CLManager::WF_GENERATE];
+        err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &cl_manager.path_buffer);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &cl_manager.ray_queue_buffer);
+        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &cl_manager.queue_counter_buffer);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &cl_manager.camera_buffer);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_int), &img_width);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_int), &img_height);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_uint), &seed);
+        err |= clSetKernelArg(kernel, 8, sizeof(cl_int), &bx);
+        err |= clSetKernelArg(kernel, 9, sizeof(cl_int), &by);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        kernel = cl_manager.wf_kernels[CLManager::WF_EXTEND];
+        err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &cl_manager.path_buffer);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &cl_manager.ray_queue_buffer);
+        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &cl_manager.material_queue_buffer);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &cl_manager.queue_counter_buffer);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_int), &max_paths);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_int), &scene_size);
+        err |= clSetKernelArg(kernel, 7, sizeof(cl_mem), vert_buffer);
+        err |= clSetKernelArg(kernel, 8, sizeof(cl_mem), mat_buffer);
+        err |= clSetKernelArg(kernel, 9, sizeof(cl_int), &bvh_size);
+        err |= clSetKernelArg(kernel, 10, sizeof(cl_mem), bvh_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        kernel = cl_manager.wf_kernels[CLManager::WF_SHADE_DIFFUSE];
+        err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &cl_manager.path_buffer);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &cl_manager.ray_queue_buffer);
+        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &cl_manager.material_queue_buffer);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &cl_manager.shadow_queue_buffer);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &cl_manager.queue_counter_buffer);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_int), &max_paths);
+        err |= clSetKernelArg(kernel, 7, sizeof(cl_int), &bounces);
+        err |= clSetKernelArg(kernel, 8, sizeof(cl_int), &check);
+        err |= clSetKernelArg(kernel, 9, sizeof(cl_mem), vert_buffer);
+        err |= clSetKernelArg(kernel, 10, sizeof(cl_mem), mat_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        kernel = cl_manager.wf_kernels[CLManager::WF_SHADE_SPECULAR];
+        err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &cl_manager.path_buffer);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &cl_manager.ray_queue_buffer);
+        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &cl_manager.material_queue_buffer);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &cl_manager.queue_counter_buffer);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_int), &max_paths);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_int), &bounces);
+        err |= clSetKernelArg(kernel, 7, sizeof(cl_int), &check);
+        err |= clSetKernelArg(kernel, 8, sizeof(cl_mem), vert_buffer);
+        err |= clSetKernelArg(kernel, 9, sizeof(cl_mem), mat_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        kernel = cl_manager.wf_kernels[CLManager::WF_CONNECT];
+        err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &cl_manager.path_buffer);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &cl_manager.shadow_queue_buffer);
+        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &cl_manager.queue_counter_buffer);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_int), &scene_size);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), vert_buffer);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_int), &bvh_size);
+        err |= clSetKernelArg(kernel, 7, sizeof(cl_mem), bvh_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        err = clSetKernelArg(cl_manager.rend_kernel, cl_manager.getFeatureArg("wavefront"), sizeof(cl_mem), &cl_manager.path_buffer);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        return true;
+    }
+
+    void WavefrontStages::enqueue(cl_int block, const size_t gws[2], const size_t lws[2], std::vector<cl_event>& events)
+    {
+        cl_int err = 0;
+        cl_uint zero = 0;
+        if(lws[0] == 0 || lws[1] == 0)
+            lws = NULL;
+
+        // Queue lengths of an earlier tile come in without waiting. Only one read is in flight at a time.
+        size_t counter_count = 4 * (cl_manager.wf_max_bounces + 1);
+        if(count_event)
+        {
+            cl_int status;
+            clGetEventInfo(count_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if(status == CL_COMPLETE && queue_counts.size() == counter_count)
+                queue_estimate = queue_counts;
+            if(status <= CL_COMPLETE)
+            {
+                clReleaseEvent(count_event);
+                count_event = NULL;
+            }
+        }
+        if(queue_estimate.size() != counter_count)
+            queue_estimate.assign(counter_count, cl_manager.wf_num_paths);
+
+        // Every bounce has it's own set of queue counters so they are all reset once per tile.
+        err = clEnqueueFillBuffer(cl_manager.comm_queue, cl_manager.queue_counter_buffer, &zero, sizeof(cl_uint), 0, sizeof(cl_uint) * 4 * (cl_manager.wf_max_bounces + 1), 0, NULL, NULL);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+
+        cl_event event;
+        err = clSetKernelArg(cl_manager.wf_kernels[CLManager::WF_GENERATE], 7, sizeof(cl_int), &block);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.wf_kernels[CLManager::WF_GENERATE], 2, NULL, gws, lws, 0, NULL, &event);
+        CLManager::checkError(err, __FILE__, __LINE__ -1);
+        events.push_back(event);
+
+        /* Queue lengths are only known on the device. Reading them back between stages would stall the queue, so every stage is
+         * sized from the length of the same queue in an earlier tile with some headroom, but never less than a few groups per compute
+         * unit. The stages loop over whatever is queued, a launch that turns out too small only takes longer.
+         */
+        size_t full_gws = (cl_manager.wf_num_paths + 63) / 64 * 64;
+        size_t min_gws = std::min((size_t) 64 * 4 * std::max(cl_manager.target_device.compute_units, (cl_uint) 1), full_gws);
+        const int bounce_arg[CLManager::WF_KERNEL_COUNT] = {-1, 4, 5, 4, 3};
+        for(cl_int bounce = 0; bounce < cl_manager.wf_max_bounces; bounce++)
+        {
+            for(int k = CLManager::WF_EXTEND; k < CLManager::WF_KERNEL_COUNT; k++)
+            {
+                size_t estimate = queue_estimate[4 * bounce + k - CLManager::WF_EXTEND];
+                size_t wf_gws = std::min(std::max((estimate + estimate / 4 + 63) / 64 * 64, min_gws), full_gws);
+                err = clSetKernelArg(cl_manager.wf_kernels[k], bounce_arg[k], sizeof(cl_int), &bounce);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                err = clEnqueueNDRangeKernel(cl_manager.comm_queue, cl_manager.wf_kernels[k], 1, NULL, &wf_gws, NULL, 0, NULL, &event);
+                CLManager::checkError(err, __FILE__, __LINE__ -1);
+                events.push_back(event);
+            }
+        }
+
+        if(!count_event)
+        {
+            queue_counts.resize(counter_count);
+            err = clEnqueueReadBuffer(cl_manager.comm_queue, cl_manager.queue_counter_buffer, CL_FALSE, 0, counter_count * sizeof(cl_uint), queue_counts.data(),
+                                      0, NULL, &count_event);
+            CLManager::checkError(err, __FILE__, __LINE__ -1);
+        }
+    }
+
+    void WavefrontStages::release()
+    {
+        if(count_event)
+            clReleaseEvent(count_event);
+        count_event = NULL;
+        queue_estimate.clear();
+    }
+}
@@ -63,6 +63,48 @@ __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
 //The rand parameter contains a 32 bit random number on each iteration. In order to use different seeds for every pixel, you can use the wang hash algorithm
 // to generate uncorrelated seed values from pixel IDs. You can check the given implementation for details on how to produce random numbers.
 
+//Optional features are enabled with a "#yune-preproc feature <name>" line in the header at the top of this file. Each feature appends it's
+//arguments after block_y, in the order the directives appear, and defines a YUNE_<NAME> macro (dashes become underscores) for #ifdef'ing them.
+//  spp-per-launch      int spp_per_launch      Number of samples to take per pixel in one launch. Weight the accumulated color with it
+//                                              and store the total sample count in the alpha channel.
+//  wavefront           __global PathState*     Path states traced by the stage kernels "generate", "extend", "shade_diffuse",
+//                                              "shade_specular" and "connect" which the file must also define. The rendering kernel
+//                                              only accumulates them. See kernels/wavefront/udpt-wavefront.cl for their arguments.
+//  persistent-threads  __global volatile int*  Counter reset to 0 before every launch. The kernel is launched in 1D with only enough
+//                                              work-groups to fill the device. Each group takes a batch of get_local_size(0) pixels
+//                                              of the block with atomic_add until the block is exhausted. See kernels/legacy/udpt.cl.
+//  ray-counters        __global volatile uint* 20 counters cleared before a sampled frame: 0 rays traced, 1 BVH nodes visited,
+//                                              2 ray-triangle tests, 3 shadow rays, 4-19 camera paths by length (1 to 16+).
+//                                              Tally in private memory and atomic_add once per work-item. If the device supports
+//                                              cl_khr_int64_base_atomics the program is built with YUNE_RAY_COUNTERS_64 and the
+//                                              counters are ulong, to be incremented with atom_add. 32 bit counters are read back
+//                                              and cleared after every tile of the frame and summed on the host, so a single tile
+//                                              must stay below 2^32 of each event.
+//  cost-heatmap        __write_only image2d_t  Per-pixel cost of the launch per sample: x BVH nodes visited, y ray-triangle tests,
+//                                              z rays traced. Shown color-mapped instead of the image when the heatmap view is on.
+//  adaptive-sampling   __global float4* moments, __global const int* active_pixels, __global const int* active_count
+//                                              Per pixel running means of luminance (x) and squared luminance (y) over z samples,
+//                                              which the kernel must keep up to date. Before every frame the host lists the pixels
+//                                              whose relative error is above the threshold in active_pixels (as y * width + x) and
+//                                              copies the others to outputImage. Block b covers list entries [b * tile pixels,
+//                                              (b+1) * tile pixels) clamped to *active_count, instead of a rectangle of the image.
+//  feature-buffers     __global float4* albedo, __global float4* normal_depth, int write_features
+//                                              Per pixel (y * width + x) first-hit albedo and normal (xyz) with the hit distance
+//                                              in normal_depth.w. Written at least if write_features is 1, which is the case on
+//                                              reset and on the frame resuming a checkpoint. Read by the denoiser before the
+//                                              post-processing kernel. Misses should have a large distance.
+//  temporal-reprojection __constant Camera* prev_cam, __global const float* prev_depth, __global float* depth, int reproject,
+//                        int max_history       On reset, store the first-hit distance of every pixel center in depth. If reproject
+//                                              is 1 the camera moved, so project the hit into prev_cam, check it against
+//                                              prev_depth and blend with inputImage there, capping it's sample count at max_history.
+//                                              kernels/legacy/udpt.cl rejects history whose stored distance differs by more than
+//                                              DISOCCLUSION_TOLERANCE (5%) from the distance to the hit.
+//  fused-tonemap       __write_only image2d_t display_image, int write_display, float lum_white
+//                                              If write_display is 1, also write the accumulated color of every pixel rendered,
+//                                              tonemapped with Reinhard's operator at white point lum_white and gamma corrected, to
+//                                              the RGBA8 display_image. The post-processing kernel is then skipped for the frame. Only
+//                                              used with kernels/post-proc/tonemap.cl. See writeDisplay() in kernels/legacy/udpt.cl.
+
 __kernel void pathtracer(__write_only image2d_t outputImage, __read_only image2d_t inputImage, __constant Camera* main_cam, 
                          int scene_size, __global Triangle* vert_data, __global Material* mat_data, int bvh_size, __global BVHNodeGPU* bvh,
                          int GI_CHECK, int reset, uint rand, int block, int block_x, int block_y)
@@ -0,0 +1,238 @@
+/******************************************************************************
+ *  This file is part of Yune".
+ *
+ *  Copyright (C) 2018 by Umair Ahmed and Syed Moiz Hussain.
+ *
+ *  "Yune" is a personal project and an educational raytracer/pathtracer. It's aimed at young
+ *  researchers trying to implement raytracing/pathtracing but don't want to mess with boilerplate code.
+ *  It provides all basic functionality to open a window, save images, etc. Since it's GPU based, you only need to modify
+ *  the kernel file and see your program in action. For details, check <https://github.com/gallickgunner/Yune>
+ *
+ *  "Yune" is a free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  "Yune" is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Reference consumer of the frames Yune publishes to shared memory (Misc Settings > Publish Frames). It follows the ring, reads every
+ * frame in place and prints what it received once a second. It doubles as a throughput test of the ring with --bench, which publishes
+ * synthetic frames from a second thread of this process as fast as it can while reading them like a separate viewer would.
+ *
+ *  Build:  g++ -O2 -std=c++11 -Iinclude tools/frame_consumer.cpp src/FramePublisher.cpp -o frame_consumer -pthread -lrt
+ *          cl /O2 /EHsc /Iinclude tools\frame_consumer.cpp src\FramePublisher.cpp
+ *
+ *  Usage:  frame_consumer [name] [--pfm file]      Follow the ring, optionally writing the newest frame to a .pfm image every second.
+ *          frame_consumer --bench [frames] [width height]
+ */
+
+#include "FramePublisher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace yune;
+
+namespace
+{
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Reads every pixel once, which is about the least a viewer does with a frame.
+    double meanLuminance(const float* pixels, size_t num_pixels)
+    {
+        double sum = 0;
+        for(size_t i = 0; i < num_pixels; i++)
+            sum += 0.2126 * pixels[4*i] + 0.7152 * pixels[4*i + 1] + 0.0722 * pixels[4*i + 2];
+        return num_pixels ? sum / num_pixels : 0;
+    }
+
+    // Portable float map. Rows are stored bottom first, like the frames are.
+    bool writePFM(const std::string& filename, const float* pixels, int width, int height)
+    {
+        FILE* file = std::fopen(filename.c_str(), "wb");
+        if(!file)
+            return false;
+        std::fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+        for(size_t i = 0; i < (size_t) width * height; i++)
+            std::fwrite(pixels + 4*i, sizeof(float), 3, file);
+        return std::fclose(file) == 0;
+    }
+
+    int follow(const std::string& name, const std::string& pfm_fn)
+    {
+        FrameSubscriber subscriber;
+        std::cout << "Waiting for \"" << name << "\"..." << std::endl;
+        while(true)
+        {
+            while(!subscriber.open(name))
+                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+            const FrameRing* ring = subscriber.getRing();
+            size_t num_pixels = (size_t) ring->width * ring->height;
+            std::cout << "Opened " << ring->width << "x" << ring->height << " ring with " << ring->slot_count << " slots." << std::endl;
+
+            uint64_t last = 0;
+            unsigned long received = 0, dropped = 0;
+            double last_report = now(), luminance = 0;
+            bool write_pfm = !pfm_fn.empty();
+            while(!subscriber.isClosed())
+            {
+                uint64_t sequence = 0;
+                const float* pixels = subscriber.latest(last, sequence);
+                if(!pixels)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+
+                double lum = meanLuminance(pixels, num_pixels);
+                bool pfm_ok = write_pfm ? writePFM(pfm_fn, pixels, ring->width, ring->height) : true;
+                unsigned long long samples = subscriber.getSlot(sequence)->samples;
+
+                // Whatever was read is only trusted if the publisher didn't come around to the slot meanwhile. The frame is counted as
+                // dropped along with the others skipped once a valid one is read.
+                if(!subscriber.isValid(sequence))
+                    continue;
+                if(last && sequence > last + 1)
+                    dropped += sequence - last - 1;
+                last = sequence;
+                received++;
+                luminance = lum;
+                if(write_pfm && pfm_ok)
+                    write_pfm = false;
+
+                if(now() - last_report >= 1.0)
+                {
+                    double mb = received * num_pixels * 4 * sizeof(float) / 1e6;
+                    std::printf("frame %llu  spp %llu  mean luminance %.4f  %lu frames/s  %lu dropped  %.1f MB/s\n", (unsigned long long) sequence,
+                                samples, luminance, received, dropped, mb / (now() - last_report));
+                    std::fflush(stdout);
+                    received = dropped = 0;
+                    last_report = now();
+                    write_pfm = !pfm_fn.empty();
+                }
+            }
+            std::cout << "Ring closed, waiting for a new one..." << std::endl;
+            subscriber.close();
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int bench(int frames, int width, int height)
+    {
+        std::string name = "yune_frames_bench";
+        FramePublisher publisher;
+        if(!publisher.open(name, width, height))
+        {
+            std::cout << publisher.getError() << std::endl;
+            return EXIT_FAILURE;
+        }
+        FrameSubscriber subscriber;
+        if(!subscriber.open(name))
+        {
+            std::cout << "Couldn't map the ring that was just created." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        size_t num_pixels = (size_t) width * height;
+        std::vector<float> frame(num_pixels * 4, 0.5f);
+        double publish_seconds = 0;
+
+        /* The first and last pixel of every row carry a stamp of the frame, so a read that overlaps the publisher rewriting the slot
+         * sees stamps of two frames. Stamps repeat after 2^24 frames, where floats stop holding every integer.
+         */
+        auto stamp = [](uint64_t sequence){ return (float) ((sequence - 1) % (1 << 24)); };
+        std::thread writer([&]()
+        {
+            double start = now();
+            for(int i = 0; i < frames; i++)
+            {
+                for(int y = 0; y < height; y++)
+                    frame[(size_t) y * width * 4] = frame[((size_t) y * width + width - 1) * 4] = stamp(i + 1);
+                publisher.publish(frame.data(), i + 1);
+            }
+            publish_seconds = now() - start;
+        });
+
+        // Read until the last frame was seen, it stays in it's slot once the writer is done. Torn frames must never pass validation.
+        uint64_t last = 0;
+        unsigned long received = 0, dropped = 0, torn = 0;
+        std::vector<float> stamps(2 * height);
+        double start = now();
+        while(last < (uint64_t) frames)
+        {
+            uint64_t sequence = 0;
+            const float* pixels = subscriber.latest(last, sequence);
+            if(!pixels)
+                continue;
+            for(int y = 0; y < height; y++)
+            {
+                stamps[2 * y] = pixels[(size_t) y * width * 4];
+                stamps[2 * y + 1] = pixels[((size_t) y * width + width - 1) * 4];
+            }
+            meanLuminance(pixels, num_pixels);
+            unsigned long long samples = subscriber.getSlot(sequence)->samples;
+
+            // A frame overwritten while it was read is dropped, and counted as such by the gap to the next valid one. Frames published
+            // before the first one read count too, so received and dropped add up to frames.
+            if(!subscriber.isValid(sequence))
+                continue;
+            bool intact = samples == sequence;
+            for(float s : stamps)
+                intact &= s == stamp(sequence);
+            if(!intact)
+                torn++;
+            if(sequence > last + 1)
+                dropped += sequence - last - 1;
+            last = sequence;
+            received++;
+        }
+        double read_seconds = now() - start;
+        writer.join();
+
+        double frame_mb = num_pixels * 4 * sizeof(float) / 1e6;
+        std::printf("%d frames of %dx%d (%.1f MB each)\n", frames, width, height, frame_mb);
+        std::printf("publish : %.1f frames/s  %.2f GB/s\n", frames / publish_seconds, frames * frame_mb / 1000 / publish_seconds);
+        std::printf("consume : %lu frames read in place (%.1f frames/s, %.2f GB/s), %lu dropped, %lu torn\n", received, received / read_seconds,
+                    received * frame_mb / 1000 / read_seconds, dropped, torn);
+        return torn == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string name = "yune_frames", pfm_fn;
+    if(argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+    {
+        int frames = argc > 2 ? std::atoi(argv[2]) : 500;
+        int width = argc > 4 ? std::atoi(argv[3]) : 1920;
+        int height = argc > 4 ? std::atoi(argv[4]) : 1080;
+        return bench(std::max(frames, 1), std::max(width, 1), std::max(height, 1));
+    }
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--pfm") == 0 && i + 1 < argc)
+            pfm_fn = argv[++i];
+        else
+            name = argv[i];
+    }
+    return follow(name, pfm_fn);
+}